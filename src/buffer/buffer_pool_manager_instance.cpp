@@ -48,7 +48,7 @@ BufferPoolManagerInstance::~BufferPoolManagerInstance() {
 }
 
 bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
-  // Make sure you call DiskManager::WritePage!
+  // Make sure you call DiskManager::WritePage! Once written out, the page's rec_lsn_ must be reset to INVALID_LSN.
   return false;
 }
 
@@ -87,6 +87,18 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
 
 bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) { return false; }
 
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManagerInstance::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_page_table;
+  std::scoped_lock latch(latch_);
+  for (const auto &[page_id, frame_id] : page_table_) {
+    Page *page = &pages_[frame_id];
+    if (page->is_dirty_ && page->rec_lsn_ != INVALID_LSN) {
+      dirty_page_table.emplace_back(page_id, page->rec_lsn_);
+    }
+  }
+  return dirty_page_table;
+}
+
 page_id_t BufferPoolManagerInstance::AllocatePage() {
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
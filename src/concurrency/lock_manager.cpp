@@ -15,28 +15,772 @@
 #include <utility>
 #include <vector>
 
+#include "concurrency/transaction_manager.h"
+
 namespace bustub {
 
+LockManager::LockManager(DeadlockPolicy policy) : policy_(policy) {
+  if (policy_ != DeadlockPolicy::DETECTION) {
+    return;
+  }
+  detector_running_ = true;
+  detector_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> latch(detector_latch_);
+    while (!detector_cv_.wait_for(latch, cycle_detection_interval, [this] { return !detector_running_; })) {
+      latch.unlock();
+      DetectCycles();
+      latch.lock();
+    }
+  });
+}
+
+LockManager::~LockManager() {
+  if (detector_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::scoped_lock latch(detector_latch_);
+    detector_running_ = false;
+  }
+  detector_cv_.notify_one();
+  detector_thread_->join();
+  delete detector_thread_;
+}
+
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
-  txn->GetSharedLockSet()->emplace(rid);
+  if (!CheckLockable(txn, LockMode::SHARED)) {
+    return false;
+  }
+  // snapshot and optimistic transactions read committed versions, a shared lock would only get in the way of writers
+  if (txn->ReadsWithoutLocks()) {
+    return true;
+  }
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!TryLockSharedFast(txn, rid) && !Acquire(txn, LockTarget::Row(rid), LockMode::SHARED)) {
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  txn->GetSharedLockSet()->Insert(rid);
   return true;
 }
 
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
-  txn->GetExclusiveLockSet()->emplace(rid);
+  if (!CheckLockable(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!Acquire(txn, LockTarget::Row(rid), LockMode::EXCLUSIVE)) {
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  txn->GetExclusiveLockSet()->Insert(rid);
   return true;
 }
 
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->emplace(rid);
+  if (!CheckLockable(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!txn->IsSharedLocked(rid) && txn->ReadsWithoutLocks()) {
+    return LockExclusive(txn, rid);
+  }
+  bool upgraded = Upgrade(txn, LockTarget::Row(rid), LockMode::EXCLUSIVE, true);
+  txn->GetSharedLockSet()->Erase(rid);
+  if (!upgraded) {
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  txn->GetExclusiveLockSet()->Insert(rid);
   return true;
 }
 
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->erase(rid);
+  LockMode lock_mode;
+  if (!ReleaseRow(txn, rid, &lock_mode)) {
+    return false;
+  }
+  txn->GetSharedLockSet()->Erase(rid);
+  txn->GetExclusiveLockSet()->Erase(rid);
+  OnUnlock(txn, lock_mode);
+  return true;
+}
+
+bool LockManager::LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid) {
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto table_modes = txn->GetTableLockModes();
+  auto held = table_modes->find(oid);
+  if (held == table_modes->end()) {
+    (*table_modes)[oid] = LockOrUpgrade(txn, LockTarget::Table(oid), lock_mode, nullptr);
+  } else if (!Covers(held->second, lock_mode)) {
+    LockMode held_mode = held->second;
+    (*table_modes)[oid] = LockOrUpgrade(txn, LockTarget::Table(oid), lock_mode, &held_mode);
+  }
+  return true;
+}
+
+bool LockManager::UnlockTable(Transaction *txn, table_oid_t oid) {
+  LockMode lock_mode;
+  if (!Release(txn, LockTarget::Table(oid), &lock_mode)) {
+    return false;
+  }
+  txn->GetTableLockModes()->erase(oid);
+  OnUnlock(txn, lock_mode);
+  return true;
+}
+
+bool LockManager::LockPage(Transaction *txn, LockMode lock_mode, table_oid_t oid, page_id_t page_id) {
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto table_modes = txn->GetTableLockModes();
+  auto table = table_modes->find(oid);
+  if (table != table_modes->end() && ParentCovers(table->second, lock_mode)) {
+    return true;
+  }
+  if (!LockTable(txn, IntentionFor(lock_mode), oid)) {
+    return false;
+  }
+
+  auto page_modes = txn->GetPageLockModes();
+  auto held = page_modes->find(page_id);
+  if (held == page_modes->end()) {
+    (*page_modes)[page_id] = LockOrUpgrade(txn, LockTarget::Page(page_id), lock_mode, nullptr);
+    (*txn->GetPageLocksByTable())[oid].emplace(page_id);
+  } else if (!Covers(held->second, lock_mode)) {
+    LockMode held_mode = held->second;
+    (*page_modes)[page_id] = LockOrUpgrade(txn, LockTarget::Page(page_id), lock_mode, &held_mode);
+  }
+  return true;
+}
+
+bool LockManager::UnlockPage(Transaction *txn, table_oid_t oid, page_id_t page_id) {
+  LockMode lock_mode;
+  if (!Release(txn, LockTarget::Page(page_id), &lock_mode)) {
+    return false;
+  }
+  txn->GetPageLockModes()->erase(page_id);
+  (*txn->GetPageLocksByTable())[oid].erase(page_id);
+  OnUnlock(txn, lock_mode);
+  return true;
+}
+
+bool LockManager::LockRow(Transaction *txn, LockMode lock_mode, table_oid_t oid, const RID &rid) {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::EXCLUSIVE,
+                "rows can only be locked in shared or exclusive mode");
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto table_modes = txn->GetTableLockModes();
+  auto table = table_modes->find(oid);
+  if (table != table_modes->end() && ParentCovers(table->second, lock_mode)) {
+    return true;
+  }
+  auto page_modes = txn->GetPageLockModes();
+  auto page = page_modes->find(rid.GetPageId());
+  if (page != page_modes->end() && ParentCovers(page->second, lock_mode)) {
+    return true;
+  }
+  if (!LockPage(txn, IntentionFor(lock_mode), oid, rid.GetPageId())) {
+    return false;
+  }
+
+  bool locked;
+  if (lock_mode == LockMode::SHARED) {
+    locked = LockShared(txn, rid);
+  } else if (txn->IsSharedLocked(rid)) {
+    locked = LockUpgrade(txn, rid);
+  } else {
+    locked = LockExclusive(txn, rid);
+  }
+  if (!locked) {
+    return false;
+  }
+  auto &rows = (*txn->GetRowLocksByTable())[oid];
+  if (rows.Insert(rid) && rows.Size() % LOCK_ESCALATION_THRESHOLD == 0) {
+    Escalate(txn, oid);
+  }
+  return true;
+}
+
+bool LockManager::UnlockRow(Transaction *txn, table_oid_t oid, const RID &rid) {
+  if (!Unlock(txn, rid)) {
+    return false;
+  }
+  (*txn->GetRowLocksByTable())[oid].Erase(rid);
   return true;
 }
 
+bool LockManager::LockKey(Transaction *txn, LockMode lock_mode, int64_t key_id, bool wait) {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::EXCLUSIVE,
+                "keys can only be locked in shared or exclusive mode");
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto key_modes = txn->GetKeyLockModes();
+  auto held = key_modes->find(key_id);
+  if (held != key_modes->end() && Covers(held->second, lock_mode)) {
+    return true;
+  }
+  if (held == key_modes->end()) {
+    if (!Acquire(txn, LockTarget::Key(key_id), lock_mode, wait)) {
+      if (!wait) {
+        return false;
+      }
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    }
+  } else if (!Upgrade(txn, LockTarget::Key(key_id), lock_mode, wait)) {
+    if (!wait) {
+      return false;
+    }
+    // the shared lock held before the upgrade is gone as well
+    key_modes->erase(held);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  (*key_modes)[key_id] = lock_mode;
+  return true;
+}
+
+bool LockManager::CheckKey(Transaction *txn, LockMode lock_mode, int64_t key_id, bool wait) {
+  if (!CheckLockable(txn, lock_mode)) {
+    return false;
+  }
+  auto key_modes = txn->GetKeyLockModes();
+  auto held = key_modes->find(key_id);
+  if (held != key_modes->end()) {
+    // a weaker lock of txn on the key stays until commit anyway, upgrading it is simpler than stepping around it
+    return Covers(held->second, lock_mode) || LockKey(txn, lock_mode, key_id, wait);
+  }
+  LockTarget target = LockTarget::Key(key_id);
+  if (!Acquire(txn, target, lock_mode, wait)) {
+    if (!wait) {
+      return false;
+    }
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  LockMode released;
+  Release(txn, target, &released);
+  return true;
+}
+
+bool LockManager::UnlockKey(Transaction *txn, int64_t key_id) {
+  LockMode lock_mode;
+  if (!Release(txn, LockTarget::Key(key_id), &lock_mode)) {
+    return false;
+  }
+  txn->GetKeyLockModes()->erase(key_id);
+  OnUnlock(txn, lock_mode);
+  return true;
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  waits_for_[t1].insert(t2);
+  acyclic_.clear();
+}
+
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  auto edges = waits_for_.find(t1);
+  if (edges == waits_for_.end()) {
+    return;
+  }
+  edges->second.erase(t2);
+  if (edges->second.empty()) {
+    waits_for_.erase(edges);
+  }
+}
+
+bool LockManager::HasCycle(txn_id_t *txn_id) {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  std::vector<txn_id_t> path;
+  for (const auto &[txn, edges] : waits_for_) {
+    if (FindCycle(txn, &path, txn_id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  std::vector<std::pair<txn_id_t, txn_id_t>> edge_list;
+  for (const auto &[t1, edges] : waits_for_) {
+    for (txn_id_t t2 : edges) {
+      edge_list.emplace_back(t1, t2);
+    }
+  }
+  return edge_list;
+}
+
+void LockManager::DetectCycles() {
+  {
+    std::scoped_lock graph_latch(waits_for_latch_);
+    waits_for_.clear();
+    acyclic_.clear();
+    start_ts_.clear();
+  }
+  // a request waits for every incompatible request ahead of it, see IsGrantable
+  std::unordered_map<txn_id_t, LockTarget> waiting_for;
+  for (LockTablePartition &partition : partitions_) {
+    std::scoped_lock latch(partition.latch_);
+    for (const auto &[target, queue] : partition.lock_table_) {
+      const auto &requests = queue.request_queue_;
+      for (auto waiting = requests.begin(); waiting != requests.end(); ++waiting) {
+        if (waiting->granted_) {
+          continue;
+        }
+        TransactionRef waiter = TransactionManager::GetTransaction(waiting->txn_id_);
+        if (waiter == nullptr || waiter->GetState() == TransactionState::ABORTED) {
+          continue;
+        }
+        waiting_for.insert_or_assign(waiting->txn_id_, target);
+        {
+          std::scoped_lock graph_latch(waits_for_latch_);
+          start_ts_.insert_or_assign(waiting->txn_id_, waiting->start_ts_);
+        }
+        for (auto ahead = requests.begin(); ahead != waiting; ++ahead) {
+          if (!Compatible(ahead->lock_mode_, waiting->lock_mode_)) {
+            AddEdge(waiting->txn_id_, ahead->txn_id_);
+          }
+        }
+      }
+    }
+  }
+
+  // only the edges of a node disappear when it is aborted, so the acyclic nodes found so far stay acyclic
+  txn_id_t victim;
+  while (HasCycle(&victim)) {
+    RemoveNode(victim);
+    AbortWaiting(victim, waiting_for.at(victim));
+  }
+}
+
+bool LockManager::FindCycle(txn_id_t txn, std::vector<txn_id_t> *path, txn_id_t *youngest) {
+  auto cycle = std::find(path->begin(), path->end(), txn);
+  if (cycle != path->end()) {
+    auto start_ts = [&](txn_id_t node) {
+      auto ts = start_ts_.find(node);
+      return ts == start_ts_.end() ? static_cast<timestamp_t>(node) : ts->second;
+    };
+    *youngest =
+        *std::max_element(cycle, path->end(), [&](txn_id_t a, txn_id_t b) { return start_ts(a) < start_ts(b); });
+    return true;
+  }
+  if (acyclic_.count(txn) > 0) {
+    return false;
+  }
+  path->push_back(txn);
+  auto edges = waits_for_.find(txn);
+  if (edges != waits_for_.end()) {
+    for (txn_id_t next : edges->second) {
+      if (FindCycle(next, path, youngest)) {
+        return true;
+      }
+    }
+  }
+  path->pop_back();
+  acyclic_.insert(txn);
+  return false;
+}
+
+void LockManager::RemoveNode(txn_id_t txn) {
+  std::scoped_lock graph_latch(waits_for_latch_);
+  waits_for_.erase(txn);
+  for (auto edges = waits_for_.begin(); edges != waits_for_.end();) {
+    edges->second.erase(txn);
+    edges = edges->second.empty() ? waits_for_.erase(edges) : std::next(edges);
+  }
+}
+
+void LockManager::AbortWaiting(txn_id_t txn, const LockTarget &target) {
+  LockTablePartition *partition = GetPartition(target);
+  std::scoped_lock latch(partition->latch_);
+  auto queue = partition->lock_table_.find(target);
+  if (queue == partition->lock_table_.end()) {
+    return;
+  }
+  // the graph is built one partition at a time, the victim may have been granted since
+  const auto &requests = queue->second.request_queue_;
+  if (std::none_of(requests.begin(), requests.end(),
+                   [&](const LockRequest &r) { return r.txn_id_ == txn && !r.granted_; })) {
+    return;
+  }
+  TransactionRef victim = TransactionManager::GetTransaction(txn);
+  if (victim != nullptr) {
+    victim->SetState(TransactionState::ABORTED);
+  }
+  queue->second.cv_.notify_all();
+}
+
+bool LockManager::CheckLockable(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
+  }
+  // READ_UNCOMMITTED never reads under a lock, so it may only take modes without a shared part
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED &&
+      (lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_SHARED ||
+       lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE)) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+  }
+  return true;
+}
+
+bool LockManager::Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool wait) {
+  LockTablePartition *partition = GetPartition(target);
+  std::unique_lock latch(partition->latch_);
+  LockRequestQueue &queue = *GetQueue(partition, target);
+  auto request =
+      queue.request_queue_.emplace(queue.request_queue_.end(), txn->GetTransactionId(), txn->GetStartTs(), lock_mode);
+  if (!wait) {
+    if (IsGrantable(queue, request)) {
+      request->granted_ = true;
+      return true;
+    }
+    queue.request_queue_.erase(request);
+    EraseQueue(partition, target);
+    return false;
+  }
+  if (policy_ == DeadlockPolicy::WOUND_WAIT) {
+    Wound(&latch, &queue, txn, lock_mode);
+  }
+  if (WaitForGrant(&latch, &queue, request, txn, target)) {
+    return true;
+  }
+  EraseQueue(partition, target);
+  return false;
+}
+
+LockMode LockManager::LockOrUpgrade(Transaction *txn, const LockTarget &target, LockMode lock_mode,
+                                    const LockMode *held) {
+  if (held == nullptr) {
+    if (!Acquire(txn, target, lock_mode)) {
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    }
+    return lock_mode;
+  }
+  LockMode upgraded = Combine(*held, lock_mode);
+  if (!Upgrade(txn, target, upgraded, true)) {
+    // the lock held before the upgrade is gone as well
+    if (target.level_ == LockTarget::Level::TABLE) {
+      txn->GetTableLockModes()->erase(static_cast<table_oid_t>(target.id_));
+    } else {
+      txn->GetPageLockModes()->erase(static_cast<page_id_t>(target.id_));
+    }
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  return upgraded;
+}
+
+bool LockManager::Upgrade(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool wait) {
+  LockTablePartition *partition = GetPartition(target);
+  std::unique_lock latch(partition->latch_);
+  LockRequestQueue &queue = *GetQueue(partition, target);
+  auto &requests = queue.request_queue_;
+  auto request = std::find_if(requests.begin(), requests.end(),
+                              [&](const LockRequest &r) { return r.txn_id_ == txn->GetTransactionId(); });
+  BUSTUB_ASSERT(request != requests.end() && request->granted_, "upgrading a lock that is not held");
+
+  if (!wait) {
+    // only upgrade in place when nobody is waiting and every other holder is compatible with the new mode
+    if (queue.upgrading_ != INVALID_TXN_ID ||
+        std::any_of(requests.begin(), requests.end(), [&](const LockRequest &r) {
+          return r.txn_id_ != txn->GetTransactionId() && (!r.granted_ || !Compatible(r.lock_mode_, lock_mode));
+        })) {
+      return false;
+    }
+    request->lock_mode_ = lock_mode;
+    return true;
+  }
+
+  if (queue.upgrading_ != INVALID_TXN_ID) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::UPGRADE_CONFLICT);
+  }
+  // an older transaction waiting here would end up waiting behind this younger one's upgrade
+  if (policy_ == DeadlockPolicy::WOUND_WAIT && std::any_of(requests.begin(), requests.end(), [&](const LockRequest &r) {
+        return !r.granted_ && r.txn_id_ < txn->GetTransactionId();
+      })) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+
+  // the upgrade goes ahead of every waiting request, it only has to wait for the other holders
+  requests.erase(request);
+  auto first_waiting =
+      std::find_if(requests.begin(), requests.end(), [](const LockRequest &r) { return !r.granted_; });
+  request = requests.emplace(first_waiting, txn->GetTransactionId(), txn->GetStartTs(), lock_mode);
+  queue.upgrading_ = txn->GetTransactionId();
+  if (policy_ == DeadlockPolicy::WOUND_WAIT) {
+    Wound(&latch, &queue, txn, lock_mode);
+  }
+  bool granted = WaitForGrant(&latch, &queue, request, txn, target);
+  queue.upgrading_ = INVALID_TXN_ID;
+  if (!granted) {
+    EraseQueue(partition, target);
+  }
+  return granted;
+}
+
+bool LockManager::Release(Transaction *txn, const LockTarget &target, LockMode *lock_mode) {
+  LockTablePartition *partition = GetPartition(target);
+  std::scoped_lock latch(partition->latch_);
+  auto queue = partition->lock_table_.find(target);
+  if (queue == partition->lock_table_.end()) {
+    return false;
+  }
+  auto &requests = queue->second.request_queue_;
+  auto request = std::find_if(requests.begin(), requests.end(),
+                              [&](const LockRequest &r) { return r.txn_id_ == txn->GetTransactionId(); });
+  if (request == requests.end()) {
+    return false;
+  }
+  *lock_mode = request->lock_mode_;
+  requests.erase(request);
+  if (requests.empty()) {
+    EraseQueue(partition, target);
+  } else {
+    queue->second.cv_.notify_all();
+  }
+  return true;
+}
+
+LockManager::LockRequestQueue *LockManager::GetQueue(LockTablePartition *partition, const LockTarget &target) {
+  auto [queue, created] = partition->lock_table_.try_emplace(target);
+  if (!created || target.level_ != LockTarget::Level::ROW) {
+    return &queue->second;
+  }
+  RID rid(target.id_);
+  std::atomic<uint64_t> &lock_word = GetLockWord(rid);
+  if ((lock_word.fetch_add(LOCK_WORD_QUEUE_ONE) & LOCK_WORD_READER_MASK) == 0) {
+    return &queue->second;
+  }
+  // No fast shared lock can be taken on the word any more, collect the ones already held on this row. A running
+  // transaction cannot finish while its shard of the transaction map is latched.
+  TransactionManager::ForEachTransaction([&](Transaction *txn) {
+    std::scoped_lock fast_latch(*txn->GetFastLockLatch());
+    if (txn->GetFastSharedLockSet()->Erase(rid)) {
+      queue->second.request_queue_.emplace_back(txn->GetTransactionId(), txn->GetStartTs(), LockMode::SHARED).granted_ =
+          true;
+      lock_word.fetch_sub(1);
+    }
+  });
+  return &queue->second;
+}
+
+void LockManager::EraseQueue(LockTablePartition *partition, const LockTarget &target) {
+  auto queue = partition->lock_table_.find(target);
+  if (queue == partition->lock_table_.end() || !queue->second.request_queue_.empty()) {
+    return;
+  }
+  partition->lock_table_.erase(queue);
+  if (target.level_ == LockTarget::Level::ROW) {
+    GetLockWord(RID(target.id_)).fetch_sub(LOCK_WORD_QUEUE_ONE);
+  }
+}
+
+bool LockManager::TryLockSharedFast(Transaction *txn, const RID &rid) {
+  std::atomic<uint64_t> &lock_word = GetLockWord(rid);
+  // the latch only orders this against another transaction moving the fast locks of txn into the lock table
+  std::scoped_lock fast_latch(*txn->GetFastLockLatch());
+  uint64_t word = lock_word.load();
+  do {
+    if (word >= LOCK_WORD_QUEUE_ONE) {
+      return false;
+    }
+  } while (!lock_word.compare_exchange_weak(word, word + 1));
+  txn->GetFastSharedLockSet()->Insert(rid);
+  return true;
+}
+
+bool LockManager::ReleaseRow(Transaction *txn, const RID &rid, LockMode *lock_mode) {
+  {
+    std::scoped_lock fast_latch(*txn->GetFastLockLatch());
+    if (txn->GetFastSharedLockSet()->Erase(rid)) {
+      GetLockWord(rid).fetch_sub(1);
+      *lock_mode = LockMode::SHARED;
+      return true;
+    }
+  }
+  return Release(txn, LockTarget::Row(rid), lock_mode);
+}
+
+void LockManager::OnUnlock(Transaction *txn, LockMode lock_mode) {
+  // intention locks never end the growing phase, READ_COMMITTED releases shared locks early without ending it either
+  bool shared = lock_mode == LockMode::SHARED || lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE;
+  if (txn->GetState() == TransactionState::GROWING &&
+      (lock_mode == LockMode::EXCLUSIVE || (shared && txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ))) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+}
+
+void LockManager::Escalate(Transaction *txn, table_oid_t oid) {
+  auto &rows = (*txn->GetRowLocksByTable())[oid];
+  bool exclusive = std::any_of(rows.begin(), rows.end(), [&](const RID &rid) { return txn->IsExclusiveLocked(rid); });
+  LockMode escalated = Combine(txn->GetTableLockModes()->at(oid), exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED);
+  // escalation is an optimization, it never waits for the other holders of the table
+  if (!Upgrade(txn, LockTarget::Table(oid), escalated, false)) {
+    return;
+  }
+  (*txn->GetTableLockModes())[oid] = escalated;
+
+  // the table lock now covers every row and page below it, releasing them does not end the growing phase
+  LockMode released;
+  for (const RID &rid : rows) {
+    ReleaseRow(txn, rid, &released);
+    txn->GetSharedLockSet()->Erase(rid);
+    txn->GetExclusiveLockSet()->Erase(rid);
+  }
+  rows.Clear();
+  auto &pages = (*txn->GetPageLocksByTable())[oid];
+  for (page_id_t page_id : pages) {
+    Release(txn, LockTarget::Page(page_id), &released);
+    txn->GetPageLockModes()->erase(page_id);
+  }
+  pages.clear();
+}
+
+void LockManager::Wound(std::unique_lock<std::mutex> *latch, LockRequestQueue *queue, Transaction *txn,
+                        LockMode lock_mode) {
+  std::vector<txn_id_t> victims;
+  for (const LockRequest &request : queue->request_queue_) {
+    if (request.start_ts_ > txn->GetStartTs() && !Compatible(lock_mode, request.lock_mode_)) {
+      // a granted lock stays until the victim's abort releases it, a waiting victim leaves the queue when it wakes up
+      TransactionRef victim = TransactionManager::GetTransaction(request.txn_id_);
+      if (victim == nullptr) {
+        continue;
+      }
+      if (victim->GetState() == TransactionState::GROWING || victim->GetState() == TransactionState::SHRINKING) {
+        victim->SetState(TransactionState::ABORTED);
+        victims.push_back(request.txn_id_);
+      }
+    }
+  }
+  if (victims.empty()) {
+    return;
+  }
+  queue->cv_.notify_all();
+
+  // a victim holding a lock here may be blocked on a target of another partition
+  std::vector<LockTarget> waiting_targets;
+  {
+    std::scoped_lock waiting_latch(waiting_latch_);
+    for (txn_id_t victim : victims) {
+      auto waiting = waiting_targets_.find(victim);
+      if (waiting != waiting_targets_.end()) {
+        waiting_targets.push_back(waiting->second);
+      }
+    }
+  }
+  if (waiting_targets.empty()) {
+    return;
+  }
+  latch->unlock();
+  for (const LockTarget &target : waiting_targets) {
+    LockTablePartition *partition = GetPartition(target);
+    std::scoped_lock partition_latch(partition->latch_);
+    auto waiting_queue = partition->lock_table_.find(target);
+    if (waiting_queue != partition->lock_table_.end()) {
+      waiting_queue->second.cv_.notify_all();
+    }
+  }
+  latch->lock();
+}
+
+bool LockManager::WaitForGrant(std::unique_lock<std::mutex> *latch, LockRequestQueue *queue,
+                               std::list<LockRequest>::iterator request, Transaction *txn, const LockTarget &target) {
+  auto ready = [&] { return txn->GetState() == TransactionState::ABORTED || IsGrantable(*queue, request); };
+  if (!ready()) {
+    {
+      std::scoped_lock waiting_latch(waiting_latch_);
+      waiting_targets_.insert_or_assign(txn->GetTransactionId(), target);
+    }
+    queue->cv_.wait(*latch, ready);
+    std::scoped_lock waiting_latch(waiting_latch_);
+    waiting_targets_.erase(txn->GetTransactionId());
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    queue->request_queue_.erase(request);
+    queue->cv_.notify_all();
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+bool LockManager::IsGrantable(const LockRequestQueue &queue, std::list<LockRequest>::const_iterator request) {
+  for (auto it = queue.request_queue_.begin(); it != request; ++it) {
+    if (!Compatible(it->lock_mode_, request->lock_mode_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LockManager::Compatible(LockMode a, LockMode b) {
+  switch (a) {
+    case LockMode::INTENTION_SHARED:
+      return b != LockMode::EXCLUSIVE;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return b == LockMode::INTENTION_SHARED || b == LockMode::INTENTION_EXCLUSIVE;
+    case LockMode::SHARED:
+      return b == LockMode::INTENTION_SHARED || b == LockMode::SHARED;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return b == LockMode::INTENTION_SHARED;
+    case LockMode::EXCLUSIVE:
+      return false;
+  }
+  return false;
+}
+
+bool LockManager::Covers(LockMode held, LockMode requested) {
+  switch (held) {
+    case LockMode::EXCLUSIVE:
+      return true;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return requested != LockMode::EXCLUSIVE;
+    case LockMode::SHARED:
+      return requested == LockMode::SHARED || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return requested == LockMode::INTENTION_EXCLUSIVE || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_SHARED:
+      return requested == LockMode::INTENTION_SHARED;
+  }
+  return false;
+}
+
+LockMode LockManager::Combine(LockMode a, LockMode b) {
+  if (Covers(a, b)) {
+    return a;
+  }
+  if (Covers(b, a)) {
+    return b;
+  }
+  // SHARED and INTENTION_EXCLUSIVE are the only modes neither of which covers the other
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+LockMode LockManager::IntentionFor(LockMode lock_mode) {
+  return lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_SHARED ? LockMode::INTENTION_SHARED
+                                                                                  : LockMode::INTENTION_EXCLUSIVE;
+}
+
+bool LockManager::ParentCovers(LockMode parent, LockMode child) {
+  if (parent == LockMode::EXCLUSIVE) {
+    return true;
+  }
+  return (parent == LockMode::SHARED || parent == LockMode::SHARED_INTENTION_EXCLUSIVE) &&
+         (child == LockMode::SHARED || child == LockMode::INTENTION_SHARED);
+}
+
 }  // namespace bustub
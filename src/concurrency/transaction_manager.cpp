@@ -12,31 +12,72 @@
 
 #include "concurrency/transaction_manager.h"
 
+#include <algorithm>
+#include <mutex>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "catalog/catalog.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
+std::array<TransactionManager::TxnMapShard, TXN_MAP_SHARD_NUM> TransactionManager::txn_map = {};
+std::atomic<uint64_t> TransactionManager::next_instance_id = 0;
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+TransactionManager::~TransactionManager() {
+  for (TableHeap *table : versioned_tables_) {
+    table->txn_manager_ = nullptr;
+  }
+}
 
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
   if (txn == nullptr) {
-    txn = new Transaction(next_txn_id_++, isolation_level);
+    txn = new Transaction(NextTxnId(), isolation_level);
+  }
+  // Announce the transaction in the slot of its thread, waiting out a checkpoint that blocks transactions.
+  global_txn_latch_.Enter(txn->GetThreadId());
+
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    txn->SetBeginLSN(lsn);
+  }
+
+  {
+    TxnMapShard *shard = GetTxnMapShard(txn->GetTransactionId());
+    std::unique_lock shard_latch(shard->latch_);
+    // taking the snapshot under the shard latch keeps GetWatermark() from missing it
+    txn->SetReadTs(last_commit_ts_);
+    shard->txns_[txn->GetTransactionId()] = txn;
   }
-  txn_map_mutex.lock();
-  txn_map[txn->GetTransactionId()] = txn;
-  txn_map_mutex.unlock();
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+txn_id_t TransactionManager::NextTxnId() {
+  struct IdBlock {
+    uint64_t owner_;
+    txn_id_t next_;
+    txn_id_t end_;
+  };
+  thread_local IdBlock block{0, 0, 0};
+  if (block.owner_ != instance_id_ || block.next_ == block.end_) {
+    block.owner_ = instance_id_;
+    block.next_ = next_txn_id_.fetch_add(TXN_ID_BLOCK_SIZE);
+    block.end_ = block.next_ + TXN_ID_BLOCK_SIZE;
+  }
+  return block.next_++;
+}
+
+bool TransactionManager::Commit(Transaction *txn) {
+  if (!CommitVersions(txn)) {
+    // The transaction read something a concurrent commit overwrote, it is rolled back like any other abort.
+    Abort(txn);
+    return false;
+  }
   txn->SetState(TransactionState::COMMITTED);
 
   // Perform all deletes before we commit.
@@ -52,16 +93,39 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
-  // Release all the locks.
+  // The transaction is durable once its commit record is.
+  lsn_t commit_lsn = INVALID_LSN;
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    commit_lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(commit_lsn);
+  }
+
+  // Early lock release: with the commit record in the log, the locks are released before it is flushed. A transaction
+  // that goes on to read or overwrite the writes of this one appends its own commit record later, so the flush that
+  // acknowledges it makes this commit durable first.
   ReleaseLocks(txn);
+  PublishCommit(txn);
+  if (commit_lsn != INVALID_LSN) {
+    log_manager_->Flush(commit_lsn);
+  }
+  EraseTransaction(txn);
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  global_txn_latch_.Exit(txn->GetThreadId());
+  if (++finished_count_ % MVCC_GC_INTERVAL == 0) {
+    CollectGarbage();
+  }
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
+  std::vector<std::pair<TableHeap *, RID>> written;
+  for (const auto &item : *table_write_set) {
+    written.emplace_back(item.table_, item.rid_);
+  }
   while (!table_write_set->empty()) {
     auto &item = table_write_set->back();
     auto table = item.table_;
@@ -84,8 +148,8 @@ void TransactionManager::Abort(Transaction *txn) {
     // Metadata identifying the table that should be deleted from.
     TableInfo *table_info = catalog->GetTable(item.table_oid_);
     IndexInfo *index_info = catalog->GetIndex(item.index_oid_);
-    auto new_key = item.tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
-                                            index_info->index_->GetKeyAttrs());
+    auto new_key = item.tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetCoveredSchema()),
+                                            index_info->index_->GetCoveredAttrs());
     if (item.wtype_ == WType::DELETE) {
       index_info->index_->InsertEntry(new_key, item.rid_, txn);
     } else if (item.wtype_ == WType::INSERT) {
@@ -93,23 +157,152 @@ void TransactionManager::Abort(Transaction *txn) {
     } else if (item.wtype_ == WType::UPDATE) {
       // Delete the new key and insert the old key
       index_info->index_->DeleteEntry(new_key, item.rid_, txn);
-      auto old_key = item.old_tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetKeySchema()),
-                                                  index_info->index_->GetKeyAttrs());
+      auto old_key = item.old_tuple_.KeyFromTuple(table_info->schema_, *(index_info->index_->GetCoveredSchema()),
+                                                  index_info->index_->GetCoveredAttrs());
       index_info->index_->InsertEntry(old_key, item.rid_, txn);
     }
     index_write_set->pop_back();
   }
   table_write_set->clear();
   index_write_set->clear();
+  // The versions of the transaction are dropped once the page holds the image they saved again.
+  for (const auto &[table, rid] : written) {
+    table->AbortVersion(rid, txn);
+  }
+
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+  }
 
   // Release all the locks.
   ReleaseLocks(txn);
+  EraseTransaction(txn);
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  global_txn_latch_.Exit(txn->GetThreadId());
+  if (++finished_count_ % MVCC_GC_INTERVAL == 0) {
+    CollectGarbage();
+  }
+}
+
+bool TransactionManager::CommitVersions(Transaction *txn) {
+  auto write_set = txn->GetWriteSet();
+  bool optimistic = txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC;
+  if (write_set->empty() && !optimistic) {
+    return true;
+  }
+  std::scoped_lock commit_latch(commit_latch_);
+  if (optimistic && !Validate(txn)) {
+    return false;
+  }
+  if (write_set->empty()) {
+    return true;
+  }
+  timestamp_t commit_ts = ++stamped_commit_ts_;
+  CommittedWrites committed{commit_ts, {}, {}};
+  for (const auto &item : *write_set) {
+    item.table_->CommitVersion(item.rid_, txn, commit_ts);
+    if (item.table_->txn_manager_ == nullptr) {
+      item.table_->txn_manager_ = this;
+      versioned_tables_.insert(item.table_);
+    }
+    committed.rids_.emplace_back(item.table_, item.rid_);
+    if (item.wtype_ == WType::INSERT) {
+      committed.inserted_tables_.insert(item.table_);
+    }
+  }
+  committed_writes_.push_back(std::move(committed));
+  txn->SetCommitTs(commit_ts);
+  return true;
+}
+
+void TransactionManager::CollectGarbage() {
+  std::unique_lock gc_latch(gc_latch_, std::try_to_lock);
+  if (!gc_latch.owns_lock()) {
+    return;
+  }
+  timestamp_t watermark = GetWatermark();
+  std::vector<TableHeap *> tables;
+  {
+    std::scoped_lock commit_latch(commit_latch_);
+    while (!committed_writes_.empty() && committed_writes_.front().commit_ts_ <= watermark) {
+      committed_writes_.pop_front();
+    }
+    tables.assign(versioned_tables_.begin(), versioned_tables_.end());
+  }
+  // the tables are swept without commit_latch_, gc_latch_ keeps them from being destroyed
+  for (TableHeap *table : tables) {
+    table->CollectGarbage(watermark);
+  }
+}
+
+void TransactionManager::ForgetTable(TableHeap *table) {
+  std::scoped_lock latch(gc_latch_, commit_latch_);
+  versioned_tables_.erase(table);
+}
+
+size_t TransactionManager::CommittedWriteCount() {
+  std::scoped_lock commit_latch(commit_latch_);
+  return committed_writes_.size();
+}
+
+void TransactionManager::PublishCommit(Transaction *txn) {
+  if (txn->GetCommitTs() == INVALID_TS) {
+    return;
+  }
+  std::scoped_lock publish_latch(publish_latch_);
+  logged_commits_.insert(txn->GetCommitTs());
+  // new snapshots see a commit only once every earlier one is visible too
+  while (!logged_commits_.empty() && *logged_commits_.begin() == last_commit_ts_ + 1) {
+    last_commit_ts_ = *logged_commits_.begin();
+    logged_commits_.erase(logged_commits_.begin());
+  }
+}
+
+bool TransactionManager::Validate(Transaction *txn) {
+  auto read_set = txn->GetReadSet();
+  auto scan_set = txn->GetScanSet();
+  // only the commits after txn began can have changed what it read, they are at the back
+  for (auto committed = committed_writes_.rbegin();
+       committed != committed_writes_.rend() && committed->commit_ts_ > txn->GetReadTs(); ++committed) {
+    for (const auto &[table, rid] : committed->rids_) {
+      auto rids = read_set->find(table);
+      if (rids != read_set->end() && rids->second.count(rid) != 0) {
+        return false;
+      }
+    }
+    for (TableHeap *table : committed->inserted_tables_) {
+      if (scan_set->count(table) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+timestamp_t TransactionManager::GetWatermark() {
+  // A transaction missed by the shard walk registered after its shard was visited, so it read last_commit_ts_ after
+  // the watermark started out from it.
+  timestamp_t watermark = last_commit_ts_;
+  ForEachTransaction([&](Transaction *txn) {
+    if (txn->ReadsWithoutLocks()) {
+      watermark = std::min(watermark, txn->GetReadTs());
+    }
+  });
+  return watermark;
+}
+
+std::vector<ActiveTxnEntry> TransactionManager::GetActiveTransactionTable() {
+  std::vector<ActiveTxnEntry> active_txns;
+  ForEachTransaction([&](Transaction *txn) {
+    active_txns.push_back({txn->GetTransactionId(), txn->GetBeginLSN(), txn->GetPrevLSN()});
+  });
+  return active_txns;
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+void TransactionManager::BlockAllTransactions() { global_txn_latch_.Block(); }
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+void TransactionManager::ResumeTransactions() { global_txn_latch_.Resume(); }
 
 }  // namespace bustub
@@ -0,0 +1,759 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.cpp
+//
+// Identification: src/container/art/adaptive_radix_tree.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "container/art/adaptive_radix_tree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>  // NOLINT
+
+#include "common/rid.h"
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+/** The counts of children below which a node is replaced by the next smaller size, with room to spare. */
+static constexpr uint16_t NODE16_MIN_COUNT = 3;
+static constexpr uint16_t NODE48_MIN_COUNT = 12;
+static constexpr uint16_t NODE256_MIN_COUNT = 37;
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ART_TYPE::AdaptiveRadixTree(const KeyComparator &comparator)
+    : key_length_(std::min(comparator.ComparedSize(), sizeof(KeyType))), root_(new Node256()) {}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ART_TYPE::~AdaptiveRadixTree() {
+  FreeSubtree(root_);
+  reclaimer_.ReclaimAll([](Node *child) { FreeSubtree(child); });
+}
+
+/*****************************************************************************
+ * OPERATIONS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::Insert(const KeyType &key, const ValueType &value) {
+  bool inserted = false;
+  {
+    EpochGuard guard(&reclaimer_);
+    while (!TryInsert(key, value, &inserted)) {
+    }
+  }
+  Reclaim();
+  return inserted;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::Remove(const KeyType &key) {
+  bool removed = false;
+  {
+    EpochGuard guard(&reclaimer_);
+    while (!TryRemove(key, &removed)) {
+    }
+  }
+  Reclaim();
+  return removed;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result) {
+  EpochGuard guard(&reclaimer_);
+  bool found = false;
+  while (!TryGetValue(key, result, &found)) {
+  }
+  return found;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::ScanRange(const KeyType &low, const KeyType &high, size_t max_count,
+                         std::vector<std::pair<KeyType, ValueType>> *result) {
+  EpochGuard guard(&reclaimer_);
+  auto first = static_cast<std::ptrdiff_t>(result->size());
+  bool more = false;
+  // a restart reads the whole range again, which only ever holds a batch
+  while (!TryScan(root_, 0, Bytes(low), Bytes(high), true, true, first + max_count, result, &more)) {
+    result->erase(result->begin() + first, result->end());
+    more = false;
+  }
+  return more;
+}
+
+/*
+ * Descend along the key, and add its leaf where the path ends: into a node with
+ * room for it, into a grown copy of a full node, or into a new node that splits
+ * the prefix of a node or the path to a leaf where the new key branches off.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::TryInsert(const KeyType &key, const ValueType &value, bool *inserted) {
+  const uint8_t *bytes = Bytes(key);
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    uint32_t prefix_length = std::min<uint32_t>(node->prefix_length_, key_length_ - depth - 1);
+    uint32_t match = PrefixMatch(node, bytes, depth);
+    if (match < prefix_length) {
+      // the key branches off within the prefix; the root has none, so node has a parent
+      if (!Upgrade(parent, parent_version)) {
+        return false;
+      }
+      if (!Upgrade(node, version)) {
+        WriteUnlock(parent);
+        return false;
+      }
+      Node4 *split = NewNode4(node->prefix_, match);
+      AddChild(split, node->prefix_[match], node);
+      AddChild(split, bytes[depth + match], AsChild(new Leaf{key, value}));
+      // node keeps the part of its prefix past the byte split branches on
+      memmove(node->prefix_, node->prefix_ + match + 1, prefix_length - match - 1);
+      node->prefix_length_ = prefix_length - match - 1;
+      ChangeChild(parent, parent_byte, split);
+      WriteUnlock(node);
+      WriteUnlock(parent);
+      *inserted = true;
+      return true;
+    }
+    depth += prefix_length;
+    uint8_t byte = bytes[depth];
+    Node *child = FindChild(node, byte);
+    if (!Validate(node, version)) {
+      return false;
+    }
+
+    if (child == nullptr) {
+      if (IsFull(node)) {
+        if (!Upgrade(parent, parent_version)) {
+          return false;
+        }
+        if (!Upgrade(node, version)) {
+          WriteUnlock(parent);
+          return false;
+        }
+        Node *grown = Resize(node, node->type_ == NodeType::NODE4 ? NodeType::NODE16
+                                   : node->type_ == NodeType::NODE16 ? NodeType::NODE48
+                                                                      : NodeType::NODE256);
+        AddChild(grown, byte, AsChild(new Leaf{key, value}));
+        ChangeChild(parent, parent_byte, grown);
+        WriteUnlockObsolete(node);
+        WriteUnlock(parent);
+        reclaimer_.Retire(node);
+      } else {
+        if (!Upgrade(node, version)) {
+          return false;
+        }
+        if (parent != nullptr && !Validate(parent, parent_version)) {
+          WriteUnlock(node);
+          return false;
+        }
+        AddChild(node, byte, AsChild(new Leaf{key, value}));
+        WriteUnlock(node);
+      }
+      *inserted = true;
+      return true;
+    }
+    if (parent != nullptr && !Validate(parent, parent_version)) {
+      return false;
+    }
+
+    if (IsLeaf(child)) {
+      const uint8_t *leaf_bytes = Bytes(AsLeaf(child)->key_);
+      size_t branch = depth + 1;
+      while (branch < key_length_ && leaf_bytes[branch] == bytes[branch]) {
+        branch++;
+      }
+      if (branch == key_length_) {
+        *inserted = false;
+        return Validate(node, version);
+      }
+      if (!Upgrade(node, version)) {
+        return false;
+      }
+      // a new node takes the bytes both keys share past byte, and branches where they differ
+      Node4 *split = NewNode4(bytes + depth + 1, branch - depth - 1);
+      AddChild(split, leaf_bytes[branch], child);
+      AddChild(split, bytes[branch], AsChild(new Leaf{key, value}));
+      ChangeChild(node, byte, split);
+      WriteUnlock(node);
+      *inserted = true;
+      return true;
+    }
+
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    if (!ReadLock(node, &version)) {
+      return false;
+    }
+    depth++;
+  }
+}
+
+/*
+ * Descend along the key, and take its leaf out of the node it hangs from. A
+ * node left with a single child is replaced by that child, which takes over its
+ * prefix, and a sparse node by a copy of the next smaller size.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::TryRemove(const KeyType &key, bool *removed) {
+  const uint8_t *bytes = Bytes(key);
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    uint32_t prefix_length = std::min<uint32_t>(node->prefix_length_, key_length_ - depth - 1);
+    if (PrefixMatch(node, bytes, depth) < prefix_length) {
+      *removed = false;
+      return Validate(node, version);
+    }
+    depth += prefix_length;
+    uint8_t byte = bytes[depth];
+    Node *child = FindChild(node, byte);
+    if (!Validate(node, version)) {
+      return false;
+    }
+    if (child == nullptr) {
+      *removed = false;
+      return true;
+    }
+
+    if (IsLeaf(child)) {
+      if (memcmp(Bytes(AsLeaf(child)->key_), bytes, key_length_) != 0) {
+        *removed = false;
+        return Validate(node, version);
+      }
+      if (node != root_ && node->count_ == 2) {
+        // node is a Node4, and its other child takes its place
+        std::pair<uint8_t, Node *> children[2];
+        Children(node, 0, 255, children);
+        auto [other_byte, other] = children[0].first == byte ? children[1] : children[0];
+        uint64_t other_version = 0;
+        if (!IsLeaf(other) && !ReadLock(other, &other_version)) {
+          return false;
+        }
+        if (!Upgrade(parent, parent_version)) {
+          return false;
+        }
+        if (!Upgrade(node, version)) {
+          WriteUnlock(parent);
+          return false;
+        }
+        if (!IsLeaf(other)) {
+          if (!Upgrade(other, other_version)) {
+            WriteUnlock(node);
+            WriteUnlock(parent);
+            return false;
+          }
+          // the prefix of node, the byte node branched on, then the prefix of other
+          uint32_t length = node->prefix_length_;
+          memmove(other->prefix_ + length + 1, other->prefix_, other->prefix_length_);
+          memcpy(other->prefix_, node->prefix_, length);
+          other->prefix_[length] = other_byte;
+          other->prefix_length_ += length + 1;
+        }
+        ChangeChild(parent, parent_byte, other);
+        if (!IsLeaf(other)) {
+          WriteUnlock(other);
+        }
+        WriteUnlockObsolete(node);
+        WriteUnlock(parent);
+        reclaimer_.Retire(node);
+      } else if (node != root_ && IsSparse(node)) {
+        if (!Upgrade(parent, parent_version)) {
+          return false;
+        }
+        if (!Upgrade(node, version)) {
+          WriteUnlock(parent);
+          return false;
+        }
+        RemoveChild(node, byte);
+        Node *shrunk = Resize(node, node->type_ == NodeType::NODE256  ? NodeType::NODE48
+                                    : node->type_ == NodeType::NODE48 ? NodeType::NODE16
+                                                                      : NodeType::NODE4);
+        ChangeChild(parent, parent_byte, shrunk);
+        WriteUnlockObsolete(node);
+        WriteUnlock(parent);
+        reclaimer_.Retire(node);
+      } else {
+        if (!Upgrade(node, version)) {
+          return false;
+        }
+        if (parent != nullptr && !Validate(parent, parent_version)) {
+          WriteUnlock(node);
+          return false;
+        }
+        RemoveChild(node, byte);
+        WriteUnlock(node);
+      }
+      reclaimer_.Retire(child);
+      *removed = true;
+      return true;
+    }
+    if (parent != nullptr && !Validate(parent, parent_version)) {
+      return false;
+    }
+
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    if (!ReadLock(node, &version)) {
+      return false;
+    }
+    depth++;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::TryGetValue(const KeyType &key, std::vector<ValueType> *result, bool *found) {
+  const uint8_t *bytes = Bytes(key);
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    uint32_t prefix_length = std::min<uint32_t>(node->prefix_length_, key_length_ - depth - 1);
+    if (PrefixMatch(node, bytes, depth) < prefix_length) {
+      *found = false;
+      return Validate(node, version);
+    }
+    depth += prefix_length;
+    Node *child = FindChild(node, bytes[depth]);
+    if (!Validate(node, version)) {
+      return false;
+    }
+    if (child == nullptr) {
+      *found = false;
+      return true;
+    }
+    if (IsLeaf(child)) {
+      // leaves never change, and this one was in the tree when node was read
+      Leaf *leaf = AsLeaf(child);
+      *found = memcmp(Bytes(leaf->key_), bytes, key_length_) == 0;
+      if (*found) {
+        result->push_back(leaf->value_);
+      }
+      return true;
+    }
+    node = child;
+    if (!ReadLock(node, &version)) {
+      return false;
+    }
+    depth++;
+  }
+}
+
+/*
+ * Visit the children of node in key order, skipping those below low while the
+ * path is on low (its bytes so far equal those of low) and those above high
+ * while it is on high.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::TryScan(Node *node, size_t depth, const uint8_t *low, const uint8_t *high, bool on_low, bool on_high,
+                       size_t max_count, std::vector<std::pair<KeyType, ValueType>> *result, bool *more) {
+  uint64_t version;
+  if (!ReadLock(node, &version)) {
+    return false;
+  }
+  uint32_t prefix_length = std::min<uint32_t>(node->prefix_length_, key_length_ - depth - 1);
+  for (uint32_t i = 0; i < prefix_length && (on_low || on_high); i++) {
+    uint8_t byte = node->prefix_[i];
+    if ((on_low && byte < low[depth + i]) || (on_high && byte > high[depth + i])) {
+      // the whole subtree is out of range
+      return Validate(node, version);
+    }
+    on_low = on_low && byte == low[depth + i];
+    on_high = on_high && byte == high[depth + i];
+  }
+  depth += prefix_length;
+  std::pair<uint8_t, Node *> children[256];
+  size_t count = Children(node, on_low ? low[depth] : 0, on_high ? high[depth] : 255, children);
+  if (!Validate(node, version)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    auto [byte, child] = children[i];
+    if (result->size() >= max_count) {
+      *more = true;
+      return true;
+    }
+    if (IsLeaf(child)) {
+      Leaf *leaf = AsLeaf(child);
+      const uint8_t *leaf_bytes = Bytes(leaf->key_);
+      if (memcmp(leaf_bytes, low, key_length_) >= 0 && memcmp(leaf_bytes, high, key_length_) <= 0) {
+        result->emplace_back(leaf->key_, leaf->value_);
+      }
+      continue;
+    }
+    if (!TryScan(child, depth + 1, low, high, on_low && byte == low[depth], on_high && byte == high[depth], max_count,
+                 result, more)) {
+      return false;
+    }
+    if (*more) {
+      return true;
+    }
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t ART_TYPE::PrefixMatch(Node *node, const uint8_t *key, size_t depth) const {
+  // a node being changed may show any length, keep within the key until it is validated
+  uint32_t prefix_length = std::min<uint32_t>(node->prefix_length_, key_length_ - depth - 1);
+  uint32_t match = 0;
+  while (match < prefix_length && node->prefix_[match] == key[depth + match]) {
+    match++;
+  }
+  return match;
+}
+
+/*****************************************************************************
+ * OPTIMISTIC LOCK COUPLING
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::ReadLock(Node *node, uint64_t *version) {
+  uint64_t current = node->version_.load(std::memory_order_acquire);
+  while ((current & 0b10) != 0) {
+    std::this_thread::yield();
+    current = node->version_.load(std::memory_order_acquire);
+  }
+  if ((current & 0b1) != 0) {
+    return false;
+  }
+  *version = current;
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::Validate(Node *node, uint64_t version) {
+  // the reads of the node must not move past the version check
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return node->version_.load(std::memory_order_relaxed) == version;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::Upgrade(Node *node, uint64_t version) {
+  return node->version_.compare_exchange_strong(version, version + 0b10, std::memory_order_acquire);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::WriteUnlock(Node *node) {
+  node->version_.fetch_add(0b10, std::memory_order_release);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::WriteUnlockObsolete(Node *node) {
+  node->version_.fetch_add(0b11, std::memory_order_release);
+}
+
+/*****************************************************************************
+ * NODES
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint8_t *ART_TYPE::SortedKeys(Node *node) {
+  return node->type_ == NodeType::NODE4 ? static_cast<Node4 *>(node)->keys_ : static_cast<Node16 *>(node)->keys_;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+typename ART_TYPE::Node **ART_TYPE::SortedChildren(Node *node) {
+  return node->type_ == NodeType::NODE4 ? static_cast<Node4 *>(node)->children_
+                                        : static_cast<Node16 *>(node)->children_;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+typename ART_TYPE::Node *ART_TYPE::FindChild(Node *node, uint8_t byte) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+    case NodeType::NODE16: {
+      uint8_t *sorted_keys = SortedKeys(node);
+      Node **sorted_children = SortedChildren(node);
+      int capacity = node->type_ == NodeType::NODE4 ? 4 : 16;
+      int count = std::min<int>(node->count_, capacity);
+      for (int i = 0; i < count; i++) {
+        if (sorted_keys[i] == byte) {
+          return sorted_children[i];
+        }
+      }
+      return nullptr;
+    }
+    case NodeType::NODE48: {
+      auto *node48 = static_cast<Node48 *>(node);
+      uint8_t slot = node48->child_index_[byte];
+      return slot == 0 || slot > 48 ? nullptr : node48->children_[slot - 1];
+    }
+    case NodeType::NODE256:
+      return static_cast<Node256 *>(node)->children_[byte];
+  }
+  return nullptr;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+size_t ART_TYPE::Children(Node *node, int from, int to, std::pair<uint8_t, Node *> *children) {
+  size_t count = 0;
+  switch (node->type_) {
+    case NodeType::NODE4:
+    case NodeType::NODE16: {
+      uint8_t *sorted_keys = SortedKeys(node);
+      Node **sorted_children = SortedChildren(node);
+      int capacity = node->type_ == NodeType::NODE4 ? 4 : 16;
+      int size = std::min<int>(node->count_, capacity);
+      for (int i = 0; i < size; i++) {
+        if (sorted_keys[i] >= from && sorted_keys[i] <= to) {
+          children[count++] = {sorted_keys[i], sorted_children[i]};
+        }
+      }
+      break;
+    }
+    case NodeType::NODE48: {
+      auto *node48 = static_cast<Node48 *>(node);
+      for (int byte = from; byte <= to; byte++) {
+        uint8_t slot = node48->child_index_[byte];
+        if (slot != 0 && slot <= 48 && node48->children_[slot - 1] != nullptr) {
+          children[count++] = {static_cast<uint8_t>(byte), node48->children_[slot - 1]};
+        }
+      }
+      break;
+    }
+    case NodeType::NODE256: {
+      auto *node256 = static_cast<Node256 *>(node);
+      for (int byte = from; byte <= to; byte++) {
+        if (node256->children_[byte] != nullptr) {
+          children[count++] = {static_cast<uint8_t>(byte), node256->children_[byte]};
+        }
+      }
+      break;
+    }
+  }
+  return count;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::IsFull(const Node *node) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+      return node->count_ == 4;
+    case NodeType::NODE16:
+      return node->count_ == 16;
+    case NodeType::NODE48:
+      return node->count_ == 48;
+    case NodeType::NODE256:
+      return false;
+  }
+  return false;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_TYPE::IsSparse(const Node *node) {
+  // whether the node is sparse once a child is removed
+  switch (node->type_) {
+    case NodeType::NODE4:
+      return false;
+    case NodeType::NODE16:
+      return node->count_ <= NODE16_MIN_COUNT + 1;
+    case NodeType::NODE48:
+      return node->count_ <= NODE48_MIN_COUNT + 1;
+    case NodeType::NODE256:
+      return node->count_ <= NODE256_MIN_COUNT + 1;
+  }
+  return false;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::AddChild(Node *node, uint8_t byte, Node *child) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+    case NodeType::NODE16: {
+      uint8_t *sorted_keys = SortedKeys(node);
+      Node **sorted_children = SortedChildren(node);
+      int position = 0;
+      while (position < node->count_ && sorted_keys[position] < byte) {
+        position++;
+      }
+      int moved = node->count_ - position;
+      memmove(sorted_keys + position + 1, sorted_keys + position, moved);
+      memmove(sorted_children + position + 1, sorted_children + position, moved * sizeof(Node *));
+      sorted_keys[position] = byte;
+      sorted_children[position] = child;
+      break;
+    }
+    case NodeType::NODE48: {
+      auto *node48 = static_cast<Node48 *>(node);
+      uint8_t slot = 0;
+      while (node48->children_[slot] != nullptr) {
+        slot++;
+      }
+      node48->children_[slot] = child;
+      node48->child_index_[byte] = slot + 1;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = child;
+      break;
+  }
+  node->count_++;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::ChangeChild(Node *node, uint8_t byte, Node *child) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+    case NodeType::NODE16: {
+      uint8_t *sorted_keys = SortedKeys(node);
+      Node **sorted_children = SortedChildren(node);
+      for (int i = 0; i < node->count_; i++) {
+        if (sorted_keys[i] == byte) {
+          sorted_children[i] = child;
+          return;
+        }
+      }
+      break;
+    }
+    case NodeType::NODE48: {
+      auto *node48 = static_cast<Node48 *>(node);
+      node48->children_[node48->child_index_[byte] - 1] = child;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = child;
+      break;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::RemoveChild(Node *node, uint8_t byte) {
+  switch (node->type_) {
+    case NodeType::NODE4:
+    case NodeType::NODE16: {
+      uint8_t *sorted_keys = SortedKeys(node);
+      Node **sorted_children = SortedChildren(node);
+      int position = 0;
+      while (sorted_keys[position] != byte) {
+        position++;
+      }
+      int moved = node->count_ - position - 1;
+      memmove(sorted_keys + position, sorted_keys + position + 1, moved);
+      memmove(sorted_children + position, sorted_children + position + 1, moved * sizeof(Node *));
+      break;
+    }
+    case NodeType::NODE48: {
+      auto *node48 = static_cast<Node48 *>(node);
+      node48->children_[node48->child_index_[byte] - 1] = nullptr;
+      node48->child_index_[byte] = 0;
+      break;
+    }
+    case NodeType::NODE256:
+      static_cast<Node256 *>(node)->children_[byte] = nullptr;
+      break;
+  }
+  node->count_--;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+typename ART_TYPE::Node *ART_TYPE::Resize(Node *node, NodeType type) {
+  Node *resized;
+  switch (type) {
+    case NodeType::NODE4:
+      resized = new Node4(NodeType::NODE4);
+      break;
+    case NodeType::NODE16:
+      resized = new Node16(NodeType::NODE16);
+      break;
+    case NodeType::NODE48:
+      resized = new Node48();
+      break;
+    case NodeType::NODE256:
+    default:
+      resized = new Node256();
+      break;
+  }
+  resized->prefix_length_ = node->prefix_length_;
+  memcpy(resized->prefix_, node->prefix_, node->prefix_length_);
+  std::pair<uint8_t, Node *> children[256];
+  size_t count = Children(node, 0, 255, children);
+  for (size_t i = 0; i < count; i++) {
+    AddChild(resized, children[i].first, children[i].second);
+  }
+  return resized;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+typename ART_TYPE::Node4 *ART_TYPE::NewNode4(const uint8_t *prefix, uint32_t prefix_length) {
+  auto *node = new Node4(NodeType::NODE4);
+  node->prefix_length_ = prefix_length;
+  memcpy(node->prefix_, prefix, prefix_length);
+  return node;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::FreeNode(Node *node) {
+  if (IsLeaf(node)) {
+    delete AsLeaf(node);
+    return;
+  }
+  switch (node->type_) {
+    case NodeType::NODE4:
+      delete static_cast<Node4 *>(node);
+      break;
+    case NodeType::NODE16:
+      delete static_cast<Node16 *>(node);
+      break;
+    case NodeType::NODE48:
+      delete static_cast<Node48 *>(node);
+      break;
+    case NodeType::NODE256:
+      delete static_cast<Node256 *>(node);
+      break;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::FreeSubtree(Node *node) {
+  if (!IsLeaf(node) && (node->version_.load() & 0b1) == 0) {
+    // an obsolete node shares its children with the node that replaced it
+    std::pair<uint8_t, Node *> children[256];
+    size_t count = Children(node, 0, 255, children);
+    for (size_t i = 0; i < count; i++) {
+      FreeSubtree(children[i].second);
+    }
+  }
+  FreeNode(node);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_TYPE::Reclaim() {
+  reclaimer_.Reclaim([](Node *child) {
+    FreeNode(child);
+    return true;
+  });
+}
+
+template class AdaptiveRadixTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class AdaptiveRadixTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class AdaptiveRadixTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class AdaptiveRadixTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class AdaptiveRadixTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -24,11 +25,43 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  //  implement me!
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     LogManager *log_manager)
+    : index_name_(name),
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      log_manager_(log_manager) {
+  Page *dir_raw_page = buffer_pool_manager_->NewPage(&directory_page_id_);
+  page_id_t bucket_page_id;
+  Page *bucket_raw_page = buffer_pool_manager_->NewPage(&bucket_page_id);
+  if (dir_raw_page == nullptr || bucket_raw_page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no frame for the hash table directory");
+  }
+  auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(dir_raw_page->GetData());
+  dir_page->SetPageId(directory_page_id_);
+  dir_page->SetBucketPageId(0, bucket_page_id);
+  dir_page->SetLocalDepth(0, 0);
+
+  IndexLog log(log_manager_, nullptr);
+  log.Image(dir_raw_page, sizeof(HashTableDirectoryPage));
+  log.Image(bucket_raw_page, PAGE_SIZE);
+  log.Append(LogRecordType::INDEX_ROOT_CHANGE);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     page_id_t directory_page_id, LogManager *log_manager)
+    : index_name_(name),
+      directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      log_manager_(log_manager) {}
+
 /*****************************************************************************
  * HELPERS
  *****************************************************************************/
@@ -46,22 +79,37 @@ uint32_t HASH_TABLE_TYPE::Hash(KeyType key) {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline uint32_t HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) {
-  return 0;
+  return Hash(key) & dir_page->GetGlobalDepthMask();
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) {
-  return 0;
+  return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
-  return nullptr;
+  return reinterpret_cast<HashTableDirectoryPage *>(FetchPage(directory_page_id_)->GetData());
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) {
-  return nullptr;
+  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(FetchPage(bucket_page_id)->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+Page *HASH_TABLE_TYPE::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "all pages are pinned");
+  }
+  return page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+IndexDescriptor HASH_TABLE_TYPE::Descriptor() {
+  return IndexDescriptor{index_name_, directory_page_id_, GetKeyTypes(comparator_), HasNormalizedKeys(comparator_),
+                         ComparedKeySize(comparator_)};
 }
 
 /*****************************************************************************
@@ -69,7 +117,20 @@ HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_i
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  return false;
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *bucket_raw_page = FetchPage(bucket_page_id);
+  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_raw_page->GetData());
+
+  bucket_raw_page->RLatch();
+  bool found = bucket_page->GetValue(key, comparator_, result);
+  bucket_raw_page->RUnlatch();
+
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  return found;
 }
 
 /*****************************************************************************
@@ -77,12 +138,123 @@ bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *bucket_raw_page = FetchPage(bucket_page_id);
+  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_raw_page->GetData());
+
+  bucket_raw_page->WLatch();
+  bool full = bucket_page->IsFull();
+  bool inserted = false;
+  uint32_t slot;
+  if (!full && bucket_page->Insert(key, value, comparator_, &slot)) {
+    IndexLog log(log_manager_, transaction);
+    bucket_page->LogSlot(slot, bucket_raw_page, &log);
+    log.SetEntry(Descriptor(), std::string(reinterpret_cast<const char *>(&key), sizeof(KeyType)),
+                 std::string(reinterpret_cast<const char *>(&value), sizeof(ValueType)));
+    log.Append(LogRecordType::INDEX_INSERT);
+    inserted = true;
+  }
+  bucket_raw_page->WUnlatch();
+
+  buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  return full ? SplitInsert(transaction, key, value) : inserted;
 }
 
+/*
+ * Split the key's bucket until it has room, then insert. Each split is logged
+ * as its own record before the entry is.
+ */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+  table_latch_.WLock();
+  IndexLog log(log_manager_, transaction);
+  Page *dir_raw_page = FetchPage(directory_page_id_);
+  auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(dir_raw_page->GetData());
+  bool inserted = false;
+  while (true) {
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+    page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+    Page *bucket_raw_page = FetchPage(bucket_page_id);
+    auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_raw_page->GetData());
+    if (!bucket_page->IsFull()) {
+      uint32_t slot;
+      inserted = bucket_page->Insert(key, value, comparator_, &slot);
+      if (inserted) {
+        bucket_page->LogSlot(slot, bucket_raw_page, &log);
+        log.SetEntry(Descriptor(), std::string(reinterpret_cast<const char *>(&key), sizeof(KeyType)),
+                     std::string(reinterpret_cast<const char *>(&value), sizeof(ValueType)));
+        log.Append(LogRecordType::INDEX_INSERT);
+      }
+      buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+      break;
+    }
+    std::vector<ValueType> values;
+    bucket_page->GetValue(key, comparator_, &values);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    if (std::find(values.begin(), values.end(), value) != values.end() ||
+        !SplitBucket(dir_raw_page, bucket_idx, &log)) {
+      break;
+    }
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+  table_latch_.WUnlock();
+  return inserted;
+}
+
+/*
+ * The caller holds the table latch in write mode, so neither the directory nor
+ * the two buckets need page latches.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::SplitBucket(Page *dir_raw_page, uint32_t bucket_idx, IndexLog *log) {
+  auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(dir_raw_page->GetData());
+  uint32_t local_depth = dir_page->GetLocalDepth(bucket_idx);
+  if (local_depth == dir_page->GetGlobalDepth()) {
+    if (dir_page->Size() == DIRECTORY_ARRAY_SIZE) {
+      return false;
+    }
+    dir_page->IncrGlobalDepth();
+  }
+
+  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+  page_id_t image_page_id;
+  Page *image_raw_page = buffer_pool_manager_->NewPage(&image_page_id);
+  if (image_raw_page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "no frame for a new bucket");
+  }
+  // the pointers with the new local depth bit set move to the split image
+  for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+    if (dir_page->GetBucketPageId(idx) == bucket_page_id) {
+      dir_page->SetLocalDepth(idx, local_depth + 1);
+      if (((idx >> local_depth) & 1) == 1) {
+        dir_page->SetBucketPageId(idx, image_page_id);
+      }
+    }
+  }
+
+  Page *bucket_raw_page = FetchPage(bucket_page_id);
+  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_raw_page->GetData());
+  auto image_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(image_raw_page->GetData());
+  uint32_t image_idx = 0;
+  for (uint32_t idx = 0; idx < BUCKET_ARRAY_SIZE && bucket_page->IsOccupied(idx); idx++) {
+    if (bucket_page->IsReadable(idx) &&
+        static_cast<page_id_t>(KeyToPageId(bucket_page->KeyAt(idx), dir_page)) == image_page_id) {
+      image_page->InsertAt(image_idx++, bucket_page->KeyAt(idx), bucket_page->ValueAt(idx));
+      bucket_page->RemoveAt(idx);
+    }
+  }
+
+  log->Image(dir_raw_page, sizeof(HashTableDirectoryPage));
+  log->Image(bucket_raw_page, PAGE_SIZE);
+  log->Image(image_raw_page, PAGE_SIZE);
+  log->Append(LogRecordType::INDEX_SPLIT);
+  buffer_pool_manager_->UnpinPage(image_page_id, true);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  return true;
 }
 
 /*****************************************************************************
@@ -90,14 +262,73 @@ bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+  table_latch_.RLock();
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+  Page *bucket_raw_page = FetchPage(bucket_page_id);
+  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_raw_page->GetData());
+
+  bucket_raw_page->WLatch();
+  uint32_t slot;
+  bool removed = bucket_page->Remove(key, value, comparator_, &slot);
+  if (removed) {
+    IndexLog log(log_manager_, transaction);
+    bucket_page->LogSlot(slot, bucket_raw_page, &log);
+    log.SetEntry(Descriptor(), std::string(reinterpret_cast<const char *>(&key), sizeof(KeyType)),
+                 std::string(reinterpret_cast<const char *>(&value), sizeof(ValueType)));
+    log.Append(LogRecordType::INDEX_DELETE);
+  }
+  bool empty = removed && bucket_page->IsEmpty();
+  bucket_raw_page->WUnlatch();
+
+  buffer_pool_manager_->UnpinPage(bucket_page_id, removed);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+  if (empty) {
+    Merge(transaction, key, value);
+  }
+  return removed;
 }
 
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {}
+void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  table_latch_.WLock();
+  Page *dir_raw_page = FetchPage(directory_page_id_);
+  auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(dir_raw_page->GetData());
+  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+  uint32_t local_depth = dir_page->GetLocalDepth(bucket_idx);
+  uint32_t image_idx = dir_page->GetSplitImageIndex(bucket_idx);
+
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+  bool merge = bucket_page->IsEmpty() && local_depth > 0 && dir_page->GetLocalDepth(image_idx) == local_depth;
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+
+  if (merge) {
+    page_id_t image_page_id = dir_page->GetBucketPageId(image_idx);
+    for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+      page_id_t page_id = dir_page->GetBucketPageId(idx);
+      if (page_id == bucket_page_id || page_id == image_page_id) {
+        dir_page->SetBucketPageId(idx, image_page_id);
+        dir_page->SetLocalDepth(idx, local_depth - 1);
+      }
+    }
+    while (dir_page->CanShrink()) {
+      dir_page->DecrGlobalDepth();
+    }
+    IndexLog log(log_manager_, transaction);
+    log.Image(dir_raw_page, sizeof(HashTableDirectoryPage));
+    log.Append(LogRecordType::INDEX_MERGE);
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, merge);
+  if (merge) {
+    buffer_pool_manager_->DeletePage(bucket_page_id);
+  }
+  table_latch_.WUnlock();
+}
 
 /*****************************************************************************
  * GETGLOBALDEPTH - DO NOT TOUCH
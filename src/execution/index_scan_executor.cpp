@@ -11,12 +11,100 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include <algorithm>
+
+#include "execution/expressions/column_value_expression.h"
+#include "type/value_factory.h"
+
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
+
+void IndexScanExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+  Index *index = index_info_->index_.get();
+  Tuple low_key;
+  Tuple high_key;
+  if (!plan_->GetLowKey().empty()) {
+    low_key = Tuple(plan_->GetLowKey(), index->GetKeySchema());
+  }
+  if (!plan_->GetHighKey().empty()) {
+    high_key = Tuple(plan_->GetHighKey(), index->GetKeySchema());
+  }
+  IsolationLevel isolation_level = exec_ctx_->GetTransaction()->GetIsolationLevel();
+  index_only_ = index->StoresCoveredColumns() &&
+                (isolation_level == IsolationLevel::READ_UNCOMMITTED ||
+                 (isolation_level == IsolationLevel::REPEATABLE_READ && index->TakesKeyLocks())) &&
+                Covers(plan_->GetPredicate());
+  for (const Column &column : GetOutputSchema()->GetColumns()) {
+    index_only_ = index_only_ && Covers(column.GetExpr());
+  }
+  scan_ = index->ScanRange(plan_->GetLowKey().empty() ? nullptr : &low_key, plan_->IsLowInclusive(),
+                           plan_->GetHighKey().empty() ? nullptr : &high_key, plan_->IsHighInclusive(),
+                           exec_ctx_->GetTransaction());
+  rids_.clear();
+  entries_.clear();
+  next_rid_ = 0;
+}
+
+bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema *schema = &table_info_->schema_;
+  while (true) {
+    if (next_rid_ == rids_.size()) {
+      if (!(index_only_ ? scan_->NextEntries(&rids_, &entries_) : scan_->NextBatch(&rids_))) {
+        return false;
+      }
+      next_rid_ = 0;
+    }
+    RID table_rid = rids_[next_rid_];
+    Tuple table_tuple;
+    if (index_only_) {
+      TupleFromEntry(entries_[next_rid_++], &table_tuple);
+    } else if (!table_info_->table_->GetTuple(rids_[next_rid_++], &table_tuple, exec_ctx_->GetTransaction())) {
+      continue;
+    }
+    if (plan_->GetPredicate() != nullptr && !plan_->GetPredicate()->Evaluate(&table_tuple, schema).GetAs<bool>()) {
+      continue;
+    }
+    std::vector<Value> values;
+    for (const Column &column : GetOutputSchema()->GetColumns()) {
+      values.push_back(column.GetExpr()->Evaluate(&table_tuple, schema));
+    }
+    *tuple = Tuple(values, GetOutputSchema());
+    *rid = table_rid;
+    return true;
+  }
+}
 
-void IndexScanExecutor::Init() {}
+bool IndexScanExecutor::Covers(const AbstractExpression *expr) const {
+  if (expr == nullptr) {
+    return true;
+  }
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr); column != nullptr) {
+    const std::vector<uint32_t> &covered = index_info_->index_->GetCoveredAttrs();
+    return std::find(covered.begin(), covered.end(), column->GetColIdx()) != covered.end();
+  }
+  return std::all_of(expr->GetChildren().begin(), expr->GetChildren().end(),
+                     [this](const AbstractExpression *child) { return Covers(child); });
+}
 
-bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+void IndexScanExecutor::TupleFromEntry(const Tuple &entry, Tuple *tuple) const {
+  const Schema *schema = &table_info_->schema_;
+  Index *index = index_info_->index_.get();
+  const std::vector<uint32_t> &covered = index->GetCoveredAttrs();
+  std::vector<Value> values;
+  values.reserve(schema->GetColumnCount());
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    auto position = std::find(covered.begin(), covered.end(), i);
+    if (position == covered.end()) {
+      values.push_back(ValueFactory::GetNullValueByType(schema->GetColumn(i).GetType()));
+    } else {
+      values.push_back(entry.GetValue(index->GetCoveredSchema(), static_cast<uint32_t>(position - covered.begin())));
+    }
+  }
+  *tuple = Tuple(values, schema);
+}
 
 }  // namespace bustub
@@ -15,6 +15,8 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -87,6 +89,12 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /**
+   * Snapshots the dirty page table, used for fuzzy checkpointing.
+   * @return every dirty page that holds logged changes, paired with its recLSN
+   */
+  virtual std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
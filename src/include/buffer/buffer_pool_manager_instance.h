@@ -15,6 +15,8 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/lru_replacer.h"
@@ -58,6 +60,9 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
+  /** @return every dirty page that holds logged changes, paired with its recLSN */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() override;
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
@@ -21,6 +21,8 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/art_index.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
 #include "storage/table/table_heap.h"
@@ -34,6 +36,16 @@ using table_oid_t = uint32_t;
 using column_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
+/** The kinds of index the catalog can create. */
+enum class IndexType : uint8_t {
+  /** Extendible hash table, for point lookups only. */
+  EXTENDIBLE_HASH,
+  /** B+ tree on disk, which logs its changes and takes key locks. */
+  B_PLUS_TREE,
+  /** Adaptive radix tree in memory, lost on restart. */
+  ADAPTIVE_RADIX_TREE
+};
+
 /**
  * The TableInfo class maintains metadata about a table.
  */
@@ -126,12 +138,12 @@ class Catalog {
       return NULL_TABLE_INFO;
     }
 
-    // Construct the table heap
-    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
-
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
 
+    // Construct the table heap
+    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn, table_oid);
+
     // Construct the table information
     auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid);
     auto *tmp = meta.get();
@@ -185,13 +197,18 @@ class Catalog {
    * @param key_schema The schema of the key
    * @param key_attrs Key attributes
    * @param keysize Size of the key
-   * @param hash_function The hash function for the index
+   * @param hash_function The hash function for the index, used by hash indexes only
+   * @param index_type The kind of index to create
+   * @param is_unique Whether a key may have a single RID only
+   * @param included_attrs The table columns the index stores along with the key, which hash indexes do not support
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         std::size_t keysize, HashFunction<KeyType> hash_function) {
+                         std::size_t keysize, HashFunction<KeyType> hash_function,
+                         IndexType index_type = IndexType::EXTENDIBLE_HASH, bool is_unique = true,
+                         const std::vector<uint32_t> &included_attrs = {}) {
     // Reject the creation request for nonexistent table
     if (table_names_.find(table_name) == table_names_.end()) {
       return NULL_INDEX_INFO;
@@ -208,21 +225,40 @@ class Catalog {
     }
 
     // Construct index metdata
-    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs, is_unique, included_attrs);
 
     // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
+    std::unique_ptr<Index> index;
+    switch (index_type) {
+      case IndexType::B_PLUS_TREE:
+        index = std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
+                                                                                    log_manager_, lock_manager_);
+        break;
+      case IndexType::ADAPTIVE_RADIX_TREE:
+        index = std::make_unique<ArtIndex<KeyType, ValueType, KeyComparator>>(std::move(meta));
+        break;
+      case IndexType::EXTENDIBLE_HASH:
+      default:
+        index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+            std::move(meta), bpm_, hash_function, log_manager_);
+        break;
+    }
 
     // Populate the index with all tuples in table heap
     auto *table_meta = GetTable(table_name);
     auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
-    }
+    auto tuple = heap->Begin(txn);
+    index->BulkLoad(
+        [&](Tuple *key, RID *rid) {
+          if (tuple == heap->End()) {
+            return false;
+          }
+          *key = tuple->KeyFromTuple(schema, *index->GetCoveredSchema(), index->GetCoveredAttrs());
+          *rid = tuple->GetRid();
+          ++tuple;
+          return true;
+        },
+        txn);
 
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
@@ -325,7 +361,7 @@ class Catalog {
  private:
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
-  [[maybe_unused]] LogManager *log_manager_;
+  LogManager *log_manager_;
 
   /**
    * Map table identifier -> table metadata.
@@ -35,7 +35,7 @@ class BustubInstance {
     buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
 
     // txn related
-    lock_manager_ = new LockManager();
+    lock_manager_ = new LockManager(DeadlockPolicy::DETECTION);
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
 
     // checkpoints
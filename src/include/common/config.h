@@ -27,19 +27,40 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** The checkpoint background writer writes out a batch of dirty pages every CHECKPOINT_FLUSH_INTERVAL. */
+extern std::chrono::milliseconds checkpoint_flush_interval;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
+static constexpr int INVALID_TS = -1;                                         // invalid commit timestamp
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 4 * 1024 * 1024;                      // size of a log segment file in byte
+static constexpr int LOG_SEGMENT_HEADER_SIZE = 8;                             // header of a log segment in byte
+static constexpr int LOG_SEGMENT_SPARE_NUM = 2;                               // recycled log segments kept for reuse
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int RECOVERY_WORKER_NUM = 4;                                 // number of redo/undo worker threads
+static constexpr int CHECKPOINT_FLUSH_BATCH = 4;                              // dirty pages written per flush round
+static constexpr int LOCK_TABLE_PARTITION_NUM = 64;                           // independently latched lock table parts
+static constexpr int LOCK_ESCALATION_THRESHOLD = 1000;                        // row locks before a table lock escalates
+static constexpr int LOCK_WORD_NUM = 1024;                                    // lock words of the shared lock fast path
+static constexpr int LOCK_SET_ARENA_SIZE = 512;                               // inline bytes of a transaction lock set
+static constexpr int MVCC_GC_INTERVAL = 64;                                   // transactions between MVCC sweeps
+static constexpr int QUIESCENCE_SLOT_NUM = 64;                                // slots counting running transactions
+static constexpr int TXN_MAP_SHARD_NUM = 64;                                  // latched parts of the transaction map
+static constexpr int TXN_ID_BLOCK_SIZE = 64;                                  // transaction ids a thread takes at once
+static constexpr int SORT_BUFFER_SIZE = 64 * 1024 * 1024;                     // bytes an external sort keeps in memory
+static constexpr double INDEX_FILL_FACTOR = 0.9;                              // share of a page a bulk load fills
+static constexpr int ART_SCAN_BATCH_SIZE = 128;                               // entries an ART range scan reads at once
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
-using lsn_t = int32_t;         // log sequence number type
+using lsn_t = int64_t;         // log sequence number type
+using timestamp_t = int64_t;   // commit timestamp type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
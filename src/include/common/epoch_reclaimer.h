@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_reclaimer.h
+//
+// Identification: src/include/common/epoch_reclaimer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * EpochReclaimer frees what readers that take no latches may still be on, once none of them can be any more.
+ *
+ * Every operation that may reach a retired item runs under a Guard, which counts it in the slot of its thread, alone
+ * on a cache line like the slots of QuiescenceLatch, under the parity of the epoch it entered in. What was retired in
+ * epoch e - 1 is freed once no operation that entered in e - 1 runs any more, and the epoch moves on to e + 1, whose
+ * parity it leaves free; the operations of epoch e - 2 are over by then, since the epoch moved on to e. Nobody ever
+ * waits: a Reclaim() that finds operations of the old epoch still running leaves its items to a later one.
+ */
+template <typename T>
+class EpochReclaimer {
+  /** The operations running on the threads hashed to the slot, by the parity of the epoch they entered in. */
+  struct alignas(64) Slot {
+    std::atomic<int64_t> active_[2] = {};
+  };
+
+ public:
+  EpochReclaimer() = default;
+
+  DISALLOW_COPY_AND_MOVE(EpochReclaimer);
+
+  /**
+   * Keeps the items an operation may reach from being freed while it runs. Guards nest, and one may be released on
+   * another thread than the one that took it.
+   */
+  class Guard {
+   public:
+    /*
+     * The operation stores its count before it checks the epoch, and Reclaim() moves the epoch only after it read the
+     * counts, so either the operation sees the epoch move and enters again, or Reclaim() sees it running.
+     */
+    explicit Guard(EpochReclaimer *reclaimer)
+        : slot_(&reclaimer->slots_[std::hash<std::thread::id>{}(std::this_thread::get_id()) % QUIESCENCE_SLOT_NUM]) {
+      while (true) {
+        epoch_ = reclaimer->epoch_.load();
+        slot_->active_[epoch_ & 1].fetch_add(1);
+        if (reclaimer->epoch_.load() == epoch_) {
+          return;
+        }
+        slot_->active_[epoch_ & 1].fetch_sub(1);
+      }
+    }
+
+    ~Guard() { slot_->active_[epoch_ & 1].fetch_sub(1, std::memory_order_release); }
+
+    DISALLOW_COPY_AND_MOVE(Guard);
+
+   private:
+    Slot *slot_;
+    uint64_t epoch_;
+  };
+
+  /** Hand over item, which no operation starting from now can reach, to be freed once no running one can either. */
+  void Retire(T item) {
+    std::scoped_lock latch(retired_latch_);
+    retired_[epoch_.load() & 1].push_back(std::move(item));
+  }
+
+  /**
+   * Free what was retired two epochs ago if no operation of that epoch runs any more, and move on an epoch.
+   * @param free_item frees an item, or returns false to keep it until a later round
+   */
+  void Reclaim(const std::function<bool(const T &item)> &free_item) {
+    std::unique_lock latch(retired_latch_, std::try_to_lock);
+    if (!latch.owns_lock()) {
+      return;
+    }
+    uint64_t epoch = epoch_.load();
+    if (retired_[0].empty() && retired_[1].empty()) {
+      return;
+    }
+    for (const Slot &slot : slots_) {
+      if (slot.active_[(epoch + 1) & 1].load() != 0) {
+        return;
+      }
+    }
+    std::vector<T> &old = retired_[(epoch + 1) & 1];
+    for (T &item : old) {
+      if (!free_item(item)) {
+        retired_[epoch & 1].push_back(std::move(item));
+      }
+    }
+    old.clear();
+    epoch_.store(epoch + 1);
+  }
+
+  /**
+   * Free every item retired and not freed yet. No operation may run any more.
+   * @param free_item frees an item
+   */
+  void ReclaimAll(const std::function<void(const T &item)> &free_item) {
+    std::scoped_lock latch(retired_latch_);
+    for (auto &retired : retired_) {
+      for (const T &item : retired) {
+        free_item(item);
+      }
+      retired.clear();
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> epoch_{0};
+  std::array<Slot, QUIESCENCE_SLOT_NUM> slots_;
+  /** Protects retired_ and the moves of epoch_. */
+  std::mutex retired_latch_;
+  /** The items retired, by the parity of the epoch they were retired in. */
+  std::vector<T> retired_[2];
+};
+
+}  // namespace bustub
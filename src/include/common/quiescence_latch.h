@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// quiescence_latch.h
+//
+// Identification: src/include/common/quiescence_latch.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <functional>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * QuiescenceLatch lets many short critical sections run while a rare blocker waits for all of them to drain, like the
+ * shared and exclusive modes of a reader-writer latch, but without a shared cache line on the shared side.
+ *
+ * Each thread announces its critical sections in its own slot, a counter on a cache line of its own. Entering bumps the
+ * slot and checks the blocked flag. A blocker raises the flag and then waits until every slot reads zero. The two sides
+ * store before they load, so either the entering thread sees the flag and backs off, or the blocker sees its slot and
+ * waits for it. While nobody blocks, entering and exiting only touch the thread's own slot.
+ */
+class QuiescenceLatch {
+ public:
+  QuiescenceLatch() = default;
+
+  DISALLOW_COPY_AND_MOVE(QuiescenceLatch);
+
+  /**
+   * Enters a critical section, waiting while the latch is blocked.
+   * @param owner the thread the critical section is announced for, Exit() must be called with the same one
+   */
+  void Enter(std::thread::id owner) {
+    std::atomic<uint32_t> &slot = GetSlot(owner);
+    while (true) {
+      slot.fetch_add(1);
+      if (!blocked_.load()) {
+        return;
+      }
+      // back off so that the blocker can drain, and come back once it is done
+      slot.fetch_sub(1);
+      std::unique_lock latch(wait_latch_);
+      wait_cv_.wait(latch, [&] { return !blocked_.load(); });
+    }
+  }
+
+  /** Exits a critical section entered for owner. */
+  void Exit(std::thread::id owner) { GetSlot(owner).fetch_sub(1, std::memory_order_release); }
+
+  /** Blocks new critical sections and waits until the running ones have exited. */
+  void Block() {
+    blocker_latch_.lock();
+    blocked_.store(true);
+    for (const Slot &slot : slots_) {
+      while (slot.count_.load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /** Lets critical sections enter again. Must be called by the thread that called Block(). */
+  void Resume() {
+    {
+      std::scoped_lock latch(wait_latch_);
+      blocked_.store(false);
+    }
+    wait_cv_.notify_all();
+    blocker_latch_.unlock();
+  }
+
+ private:
+  /** A counter of running critical sections, alone on its cache line. */
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> count_{0};
+  };
+
+  std::atomic<uint32_t> &GetSlot(std::thread::id owner) {
+    return slots_[std::hash<std::thread::id>{}(owner) % QUIESCENCE_SLOT_NUM].count_;
+  }
+
+  std::array<Slot, QUIESCENCE_SLOT_NUM> slots_;
+  /** Written only by blockers, so it stays shared in every cache while nobody blocks. */
+  alignas(64) std::atomic<bool> blocked_{false};
+  /** Held from Block() to Resume(), lets one blocker in at a time. */
+  std::mutex blocker_latch_;
+  std::mutex wait_latch_;
+  std::condition_variable wait_cv_;
+};
+
+}  // namespace bustub
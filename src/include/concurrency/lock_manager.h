@@ -13,11 +13,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -29,17 +35,50 @@ namespace bustub {
 
 class TransactionManager;
 
+/** How the lock manager keeps transactions from waiting for each other forever. */
+enum class DeadlockPolicy {
+  /** Prevent deadlocks: a request wounds (aborts) every younger conflicting transaction and waits for older ones. */
+  WOUND_WAIT,
+  /** Let requests wait, and abort the youngest transaction of every cycle in the waits-for graph in the background. */
+  DETECTION
+};
+
 /**
- * LockManager handles transactions asking for locks on records.
+ * LockManager handles transactions asking for locks on tables, pages, records and index keys.
+ *
+ * Locks are hierarchical (multi-granularity): a table or page can be locked in any LockMode, and locking a page or row
+ * through LockPage/LockRow first takes the matching intention lock on its ancestors. A transaction holding many row
+ * locks on a table has them escalated to a single table lock once it crosses LOCK_ESCALATION_THRESHOLD.
+ *
+ * Shared row locks have a fast path that skips the lock table. Every row hashes to one of LOCK_WORD_NUM atomic lock
+ * words, which count the fast shared locks on its rows and the lock table queues of its rows. A shared lock is taken
+ * with a single compare-and-swap on the word as long as no row of the word has a queue. The first request creating a
+ * queue for a row moves the fast shared locks on that row into the new queue as granted requests, so that every
+ * conflict is resolved in the lock table and deadlock handling sees every holder.
+ *
+ * The lock table is split into LOCK_TABLE_PARTITION_NUM partitions, each with its own latch. A lock target always
+ * hashes to the same partition, so transactions locking disjoint records rarely contend on a latch. No operation ever
+ * holds more than one partition latch.
+ *
+ * Index keys are locked for key-range (next-key) locking, see BPlusTreeIndex. A lock on a key also covers the gap
+ * between it and the previous key of the index, so a reader holding the key of every entry it scanned, plus the first
+ * key past its range, keeps writers from inserting phantoms into the range. Key locks are SHARED or EXCLUSIVE and sit
+ * outside the table hierarchy.
+ *
+ * Deadlocks are handled according to the DeadlockPolicy. Under WOUND_WAIT a request wounds (aborts) every younger
+ * transaction holding or waiting for a conflicting lock, and waits for older ones. Under DETECTION a background thread
+ * builds the waits-for graph every cycle_detection_interval and aborts the youngest transaction of each cycle. Age is
+ * the start timestamp of a transaction, see Transaction::GetStartTs().
  */
 class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
-
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    LockRequest(txn_id_t txn_id, timestamp_t start_ts, LockMode lock_mode)
+        : txn_id_(txn_id), start_ts_(start_ts), lock_mode_(lock_mode), granted_(false) {}
 
     txn_id_t txn_id_;
+    // start timestamp of the transaction, which orders it for deadlock handling
+    timestamp_t start_ts_;
     LockMode lock_mode_;
     bool granted_;
   };
@@ -47,19 +86,47 @@ class LockManager {
   class LockRequestQueue {
    public:
     std::list<LockRequest> request_queue_;
-    // for notifying blocked transactions on this rid
+    // for notifying blocked transactions on this target
     std::condition_variable cv_;
     // txn_id of an upgrading transaction (if any)
     txn_id_t upgrading_ = INVALID_TXN_ID;
   };
 
+  /** A lockable object: a table, a page, a row or an index key, identified by its oid, page id, RID or key id. */
+  struct LockTarget {
+    enum class Level : uint8_t { TABLE, PAGE, ROW, KEY };
+
+    static LockTarget Table(table_oid_t oid) { return {Level::TABLE, oid}; }
+    static LockTarget Page(page_id_t page_id) { return {Level::PAGE, page_id}; }
+    static LockTarget Row(const RID &rid) { return {Level::ROW, rid.Get()}; }
+    static LockTarget Key(int64_t key_id) { return {Level::KEY, key_id}; }
+
+    bool operator==(const LockTarget &other) const { return level_ == other.level_ && id_ == other.id_; }
+
+    Level level_;
+    int64_t id_;
+  };
+
+  struct LockTargetHash {
+    size_t operator()(const LockTarget &target) const {
+      return std::hash<int64_t>()(target.id_) * 4 + static_cast<size_t>(target.level_);
+    }
+  };
+
+  /** A slice of the lock table, guarded by its own latch. */
+  struct LockTablePartition {
+    std::mutex latch_;
+    std::unordered_map<LockTarget, LockRequestQueue, LockTargetHash> lock_table_;
+  };
+
  public:
   /**
-   * Creates a new lock manager configured for the deadlock prevention policy.
+   * Creates a new lock manager, starting the cycle detection thread for DeadlockPolicy::DETECTION.
    */
-  LockManager() = default;
+  explicit LockManager(DeadlockPolicy policy = DeadlockPolicy::WOUND_WAIT);
 
-  ~LockManager() = default;
+  /** Stops and joins the cycle detection thread, if any. */
+  ~LockManager();
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
@@ -71,7 +138,8 @@ class LockManager {
    */
 
   /**
-   * Acquire a lock on RID in shared mode. See [LOCK_NOTE] in header file.
+   * Acquire a lock on RID in shared mode. See [LOCK_NOTE] in header file. Snapshot isolation and optimistic
+   * transactions read without locks, for them this succeeds without taking one.
    * @param txn the transaction requesting the shared lock
    * @param rid the RID to be locked in shared mode
    * @return true if the lock is granted, false otherwise
@@ -90,7 +158,7 @@ class LockManager {
    * Upgrade a lock from a shared lock to an exclusive lock.
    * @param txn the transaction requesting the lock upgrade
    * @param rid the RID that should already be locked in shared mode by the
-   * requesting transaction
+   * requesting transaction, unless it reads without locks
    * @return true if the upgrade is successful, false otherwise
    */
   bool LockUpgrade(Transaction *txn, const RID &rid);
@@ -104,11 +172,251 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on a table. A table already locked in a weaker mode is upgraded to the combination of both modes,
+   * e.g. SHARED and INTENTION_EXCLUSIVE become SHARED_INTENTION_EXCLUSIVE. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode the mode to lock the table in
+   * @param oid the table to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid);
+
+  /**
+   * Release a table lock. The transaction should have released the page and row locks below it first.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockTable(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Acquire a lock on a page of a table, taking the matching intention lock on the table first. Nothing is locked if
+   * the table lock already covers the page. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode the mode to lock the page in
+   * @param oid the table the page belongs to
+   * @param page_id the page to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockPage(Transaction *txn, LockMode lock_mode, table_oid_t oid, page_id_t page_id);
+
+  /**
+   * Release a page lock. The transaction should have released the row locks below it first.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockPage(Transaction *txn, table_oid_t oid, page_id_t page_id);
+
+  /**
+   * Acquire a SHARED or EXCLUSIVE lock on a row of a table, taking the matching intention locks on its table and page
+   * first. Nothing is locked if a table or page lock already covers the row. May escalate the row locks of the table
+   * into a table lock. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode SHARED or EXCLUSIVE
+   * @param oid the table the row belongs to
+   * @param rid the row to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockRow(Transaction *txn, LockMode lock_mode, table_oid_t oid, const RID &rid);
+
+  /**
+   * Release a row lock taken through LockRow.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockRow(Transaction *txn, table_oid_t oid, const RID &rid);
+
+  /**
+   * Acquire a SHARED or EXCLUSIVE lock on an index key, held until the transaction ends. The lock covers the key and
+   * the gap below it. A key already locked in shared mode is upgraded. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode SHARED or EXCLUSIVE
+   * @param key_id the key, as identified by its index
+   * @param wait false to give up instead of waiting if the lock is not free
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockKey(Transaction *txn, LockMode lock_mode, int64_t key_id, bool wait = true);
+
+  /**
+   * Instant-duration key lock: waits until txn could lock key_id in lock_mode, without keeping the lock. An insert
+   * checks the key above the new one this way, making sure no reader holds the gap it splits.
+   * @param wait false to give up instead of waiting if the lock is not free
+   * @return true if the lock could be granted, false otherwise
+   */
+  bool CheckKey(Transaction *txn, LockMode lock_mode, int64_t key_id, bool wait = true);
+
+  /**
+   * Release a key lock taken through LockKey.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockKey(Transaction *txn, int64_t key_id);
+
+  /*** Waits-for graph API ***/
+
+  /** Adds an edge from t1 to t2, i.e. t1 waits for t2. */
+  void AddEdge(txn_id_t t1, txn_id_t t2);
+
+  /** Removes the edge from t1 to t2, if any. */
+  void RemoveEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Looks for a cycle in the waits-for graph. Nodes proven not to reach a cycle are skipped by later calls until an
+   * edge is added, so that breaking several cycles one after another explores the graph only once.
+   * @param[out] txn_id the youngest transaction of the cycle found, by start timestamp if DetectCycles() found the nodes
+   * in the lock table, and by id otherwise
+   * @return true if the graph has a cycle
+   */
+  bool HasCycle(txn_id_t *txn_id);
+
+  /** @return the edges of the waits-for graph */
+  std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
+
+  /**
+   * Rebuilds the waits-for graph from the lock table and breaks every cycle in it by aborting its youngest transaction
+   * and waking it up. Runs every cycle_detection_interval under DeadlockPolicy::DETECTION.
+   */
+  void DetectCycles();
+
  private:
-  std::mutex latch_;
+  /** @return the partition of the lock table that target belongs to */
+  LockTablePartition *GetPartition(const LockTarget &target) {
+    return &partitions_[LockTargetHash()(target) % LOCK_TABLE_PARTITION_NUM];
+  }
+
+  /** @return the lock word that rid hashes to */
+  std::atomic<uint64_t> &GetLockWord(const RID &rid) {
+    return lock_words_[(static_cast<uint64_t>(rid.Get()) * 0x9E3779B97F4A7C15ULL >> 32) % LOCK_WORD_NUM];
+  }
+
+  /**
+   * Returns the queue of target, creating it if needed. Creating the queue of a row blocks the fast path on its lock
+   * word and moves the fast shared locks on the row into the queue.
+   */
+  LockRequestQueue *GetQueue(LockTablePartition *partition, const LockTarget &target);
+
+  /** Erases the queue of target once it is empty, reopening the fast path on the lock word of a row. */
+  void EraseQueue(LockTablePartition *partition, const LockTarget &target);
+
+  /** @return true if a shared lock on rid was granted through its lock word */
+  bool TryLockSharedFast(Transaction *txn, const RID &rid);
+
+  /** Releases the lock of txn on rid, whether it was granted through the fast path or the lock table. */
+  bool ReleaseRow(Transaction *txn, const RID &rid, LockMode *lock_mode);
+
+  /**
+   * Checks the preconditions shared by all lock requests. Aborts the transaction and throws if it may not lock.
+   * @return false if the transaction is already aborted
+   */
+  bool CheckLockable(Transaction *txn, LockMode lock_mode);
+
+  /**
+   * Appends a request for target, wounds younger conflicting transactions and blocks until it is granted. Without
+   * wait, the request is only granted if it can be right away, and nobody is wounded.
+   */
+  bool Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool wait = true);
+
+  /**
+   * Locks target in lock_mode, or upgrades the lock txn already holds on it in mode *held. Throws if txn is aborted.
+   * @param held the mode txn holds target in, nullptr if it holds no lock on target
+   * @return the mode txn holds target in afterwards
+   */
+  LockMode LockOrUpgrade(Transaction *txn, const LockTarget &target, LockMode lock_mode, const LockMode *held);
+
+  /**
+   * Replaces the granted lock of txn on target by one in lock_mode. A waiting upgrade goes ahead of every waiting
+   * request and blocks until the other holders are compatible; the old lock is lost if the transaction is aborted
+   * meanwhile. A non-waiting upgrade only happens if it can be granted right away.
+   * @return true if the lock was upgraded
+   */
+  bool Upgrade(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool wait);
+
+  /**
+   * Removes the granted request of txn on target and wakes up the waiters, without any transaction state change.
+   * @param[out] lock_mode the mode of the released lock
+   * @return false if txn held no lock on target
+   */
+  bool Release(Transaction *txn, const LockTarget &target, LockMode *lock_mode);
+
+  /** Moves txn to SHRINKING if releasing a lock in lock_mode ends its growing phase. */
+  static void OnUnlock(Transaction *txn, LockMode lock_mode);
+
+  /** Escalates the row locks of txn on table oid into a single table lock, if the table lock can be upgraded now. */
+  void Escalate(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Aborts every younger transaction whose request in queue conflicts with lock_mode and wakes the victims up. The
+   * partition latch is dropped while victims blocked in other partitions are woken.
+   */
+  void Wound(std::unique_lock<std::mutex> *latch, LockRequestQueue *queue, Transaction *txn, LockMode lock_mode);
+
+  /**
+   * Blocks on the queue until request is granted or its transaction is aborted. An aborted request is removed.
+   * @return true if the request was granted
+   */
+  bool WaitForGrant(std::unique_lock<std::mutex> *latch, LockRequestQueue *queue,
+                    std::list<LockRequest>::iterator request, Transaction *txn, const LockTarget &target);
+
+  /** @return true if request is compatible with every request ahead of it, granted or not */
+  static bool IsGrantable(const LockRequestQueue &queue, std::list<LockRequest>::const_iterator request);
+
+  /** @return true if locks in modes a and b can be held on the same target by different transactions */
+  static bool Compatible(LockMode a, LockMode b);
+
+  /** @return true if holding a lock in mode held grants everything a lock in mode requested would */
+  static bool Covers(LockMode held, LockMode requested);
+
+  /** @return the weakest mode covering both a and b */
+  static LockMode Combine(LockMode a, LockMode b);
+
+  /** @return the intention mode to hold on the parent of an object locked in lock_mode */
+  static LockMode IntentionFor(LockMode lock_mode);
+
+  /** @return true if a lock in mode parent implicitly locks all of its children in mode child */
+  static bool ParentCovers(LockMode parent, LockMode child);
+
+  /**
+   * Depth-first search for a cycle reachable from txn.
+   * @param path the transactions on the way to txn
+   * @param[out] youngest the youngest transaction id of the cycle found
+   */
+  bool FindCycle(txn_id_t txn, std::vector<txn_id_t> *path, txn_id_t *youngest);
+
+  /** Removes every edge from or to txn. */
+  void RemoveNode(txn_id_t txn);
+
+  /** Aborts txn if it still waits for target, and wakes it up. */
+  void AbortWaiting(txn_id_t txn, const LockTarget &target);
+
+  DeadlockPolicy policy_;
+
+  /**
+   * Lock words of the shared lock fast path: the low 32 bits count fast shared locks, the high 32 bits count lock table
+   * queues of rows hashing to the word.
+   */
+  std::array<std::atomic<uint64_t>, LOCK_WORD_NUM> lock_words_{};
+  static constexpr uint64_t LOCK_WORD_READER_MASK = 0xFFFFFFFFULL;
+  static constexpr uint64_t LOCK_WORD_QUEUE_ONE = 1ULL << 32;
+
+  /** Lock table for lock requests, partitioned by lock target. */
+  std::array<LockTablePartition, LOCK_TABLE_PARTITION_NUM> partitions_;
+
+  /** Guards waiting_targets_. Taken after a partition latch, never before one. */
+  std::mutex waiting_latch_;
+  /** The target each blocked transaction waits for, so that wounding it can wake it up. */
+  std::unordered_map<txn_id_t, LockTarget> waiting_targets_;
+
+  /** Guards waits_for_, acyclic_ and start_ts_. Taken after a partition latch, never before one. */
+  std::mutex waits_for_latch_;
+  /** Waits-for graph, ordered so that cycles are searched deterministically. */
+  std::map<txn_id_t, std::set<txn_id_t>> waits_for_;
+  /** Nodes known not to reach any cycle of waits_for_. */
+  std::unordered_set<txn_id_t> acyclic_;
+  /** The start timestamp of every waiting transaction DetectCycles() found. */
+  std::unordered_map<txn_id_t, timestamp_t> start_ts_;
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
+  std::thread *detector_thread_{nullptr};
+  bool detector_running_{false};
+  /** Protects detector_running_. */
+  std::mutex detector_latch_;
+  /** Wakes the cycle detection thread when it is stopped. */
+  std::condition_variable detector_cv_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_set.h
+//
+// Identification: src/include/concurrency/lock_set.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+/**
+ * LockSet is a set of records locked by a transaction. The records are kept packed in a vector, in no particular order,
+ * and an open-addressing table of their positions finds them, so that locking and unlocking a record take constant time
+ * whatever the number of locks held, and no node is allocated per record. The storage comes from a pool that reuses
+ * the blocks the vectors give back as they grow, on top of an inline buffer of LOCK_SET_ARENA_SIZE bytes, so a
+ * transaction holding few locks never touches the heap for them.
+ */
+class LockSet {
+ public:
+  LockSet() : arena_(buffer_.data(), buffer_.size()), pool_(&arena_), rids_(&pool_), slots_(&pool_) {}
+
+  DISALLOW_COPY_AND_MOVE(LockSet);
+
+  /** @return true if rid was inserted, false if it already was in the set */
+  bool Insert(const RID &rid) {
+    // at most half of the slots are used, which keeps probe sequences short
+    if ((rids_.size() + 1) * 2 > slots_.size()) {
+      Rehash(std::max<size_t>(MIN_SLOT_NUM, slots_.size() * 2));
+    }
+    size_t slot = Probe(rid);
+    if (slots_[slot] != EMPTY_SLOT) {
+      return false;
+    }
+    slots_[slot] = static_cast<uint32_t>(rids_.size());
+    rids_.push_back(rid);
+    return true;
+  }
+
+  /** @return true if rid was erased, false if it was not in the set */
+  bool Erase(const RID &rid) {
+    if (rids_.empty()) {
+      return false;
+    }
+    size_t slot = Probe(rid);
+    if (slots_[slot] == EMPTY_SLOT) {
+      return false;
+    }
+    // the last record moves into the place of the erased one
+    uint32_t pos = slots_[slot];
+    if (pos + 1 != rids_.size()) {
+      slots_[Probe(rids_.back())] = pos;
+      rids_[pos] = rids_.back();
+    }
+    rids_.pop_back();
+    // shift back the records after the hole that may not be found past it any more
+    size_t mask = slots_.size() - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; slots_[next] != EMPTY_SLOT; next = (next + 1) & mask) {
+      size_t home = Home(rids_[slots_[next]]);
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        slots_[hole] = slots_[next];
+        hole = next;
+      }
+    }
+    slots_[hole] = EMPTY_SLOT;
+    return true;
+  }
+
+  /** @return true if rid is in the set */
+  bool Contains(const RID &rid) const { return !rids_.empty() && slots_[Probe(rid)] != EMPTY_SLOT; }
+
+  /** @return the number of records in the set */
+  size_t Size() const { return rids_.size(); }
+
+  /** @return true if the set is empty */
+  bool Empty() const { return rids_.empty(); }
+
+  /** Removes every record. The set keeps its memory for later inserts. */
+  void Clear() {
+    rids_.clear();
+    std::fill(slots_.begin(), slots_.end(), EMPTY_SLOT);
+  }
+
+  std::pmr::vector<RID>::const_iterator begin() const { return rids_.begin(); }  // NOLINT
+  std::pmr::vector<RID>::const_iterator end() const { return rids_.end(); }      // NOLINT
+
+ private:
+  static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+  static constexpr size_t MIN_SLOT_NUM = 16;
+
+  /** The slot rid is looked up from. RIDs differ mostly in their high bits, which the multiplication spreads. */
+  size_t Home(const RID &rid) const {
+    return ((static_cast<uint64_t>(rid.Get()) * 0x9E3779B97F4A7C15ULL) >> 32) & (slots_.size() - 1);
+  }
+
+  /** @return the slot holding the position of rid, or the empty slot where it would go */
+  size_t Probe(const RID &rid) const {
+    size_t mask = slots_.size() - 1;
+    size_t slot = Home(rid);
+    while (slots_[slot] != EMPTY_SLOT && !(rids_[slots_[slot]] == rid)) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  /** Rebuilds the table with slot_num slots, a power of two. */
+  void Rehash(size_t slot_num) {
+    slots_.assign(slot_num, EMPTY_SLOT);
+    for (size_t pos = 0; pos < rids_.size(); pos++) {
+      slots_[Probe(rids_[pos])] = static_cast<uint32_t>(pos);
+    }
+  }
+
+  /** Inline storage the arena hands out first, before falling back to the heap. */
+  std::array<std::byte, LOCK_SET_ARENA_SIZE> buffer_;
+  std::pmr::monotonic_buffer_resource arena_;
+  /** Hands the blocks given back to it out again, instead of taking more from the arena. */
+  std::pmr::unsynchronized_pool_resource pool_;
+  /** The records. Declared after the resources so that it is destroyed first. */
+  std::pmr::vector<RID> rids_;
+  /** The positions of the records in rids_, by the hash of the record, EMPTY_SLOT where there is none. */
+  std::pmr::vector<uint32_t> slots_;
+};
+
+}  // namespace bustub
@@ -15,11 +15,14 @@
 #include <atomic>
 #include <deque>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 
 #include "common/config.h"
+#include "concurrency/lock_set.h"
 #include "common/logger.h"
 #include "storage/page/page.h"
 #include "storage/table/tuple.h"
@@ -44,9 +47,17 @@ namespace bustub {
 enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
- * Transaction isolation level.
+ * Transaction isolation level. The first three are enforced with locks. SNAPSHOT_ISOLATION reads the versions committed
+ * before the transaction began without locking, and aborts on a write to a tuple changed since then. OPTIMISTIC reads
+ * the latest committed versions without locking, and is validated at commit against the writes committed since it
+ * began, which makes it serializable.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT_ISOLATION, OPTIMISTIC };
+
+/**
+ * Lock modes for multi-granularity locking. Tables and pages can be locked in any mode, rows only SHARED or EXCLUSIVE.
+ */
+enum class LockMode { SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE };
 
 /**
  * Type of write operation.
@@ -147,15 +158,28 @@ class TransactionAbortException : public std::exception {
  * Transaction tracks information related to a transaction.
  */
 class Transaction {
+  friend class TransactionManager;
+  friend class TransactionRef;
+
  public:
   explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
       : state_(TransactionState::GROWING),
         isolation_level_(isolation_level),
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
+        start_ts_(next_start_ts++),
         prev_lsn_(INVALID_LSN),
-        shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        begin_lsn_(INVALID_LSN),
+        shared_lock_set_{new LockSet},
+        exclusive_lock_set_{new LockSet},
+        fast_shared_lock_set_{new LockSet},
+        table_lock_modes_{new std::unordered_map<table_oid_t, LockMode>},
+        page_lock_modes_{new std::unordered_map<page_id_t, LockMode>},
+        page_locks_by_table_{new std::unordered_map<table_oid_t, std::unordered_set<page_id_t>>},
+        row_locks_by_table_{new std::unordered_map<table_oid_t, LockSet>},
+        key_lock_modes_{new std::unordered_map<int64_t, LockMode>},
+        read_set_{new std::unordered_map<TableHeap *, std::unordered_set<RID>>},
+        scan_set_{new std::unordered_set<TableHeap *>} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
@@ -173,9 +197,20 @@ class Transaction {
   /** @return the id of this transaction */
   inline txn_id_t GetTransactionId() const { return txn_id_; }
 
+  /**
+   * @return the order the transaction was created in, a lower start timestamp is an older transaction. Deadlock
+   * handling goes by it rather than by the id, since ids are handed out in blocks per thread.
+   */
+  inline timestamp_t GetStartTs() const { return start_ts_; }
+
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
+  /** @return true if the transaction reads committed versions from the version store instead of locking tuples */
+  inline bool ReadsWithoutLocks() const {
+    return isolation_level_ == IsolationLevel::SNAPSHOT_ISOLATION || isolation_level_ == IsolationLevel::OPTIMISTIC;
+  }
+
   /** @return the list of table write records of this transaction */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
@@ -217,25 +252,73 @@ class Transaction {
   inline void AddIntoDeletedPageSet(page_id_t page_id) { deleted_page_set_->insert(page_id); }
 
   /** @return the set of resources under a shared lock */
-  inline std::shared_ptr<std::unordered_set<RID>> GetSharedLockSet() { return shared_lock_set_; }
+  inline std::shared_ptr<LockSet> GetSharedLockSet() { return shared_lock_set_; }
 
   /** @return the set of resources under an exclusive lock */
-  inline std::shared_ptr<std::unordered_set<RID>> GetExclusiveLockSet() { return exclusive_lock_set_; }
+  inline std::shared_ptr<LockSet> GetExclusiveLockSet() { return exclusive_lock_set_; }
+
+  /** @return the subset of the shared lock set taken through the lock manager's fast path */
+  inline std::shared_ptr<LockSet> GetFastSharedLockSet() { return fast_shared_lock_set_; }
+
+  /** @return the latch guarding the fast shared lock set */
+  inline std::mutex *GetFastLockLatch() { return &fast_lock_latch_; }
+
+  /** @return the mode each table is locked in */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> GetTableLockModes() { return table_lock_modes_; }
+
+  /** @return the mode each page is locked in */
+  inline std::shared_ptr<std::unordered_map<page_id_t, LockMode>> GetPageLockModes() { return page_lock_modes_; }
+
+  /** @return the locked pages of each table */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<page_id_t>>> GetPageLocksByTable() {
+    return page_locks_by_table_;
+  }
+
+  /** @return the rows of each table locked through LockManager::LockRow */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockSet>> GetRowLocksByTable() {
+    return row_locks_by_table_;
+  }
+
+  /** @return the mode each index key is locked in, see LockManager::LockKey */
+  inline std::shared_ptr<std::unordered_map<int64_t, LockMode>> GetKeyLockModes() { return key_lock_modes_; }
+
+  /** @return the tuples of each table read by an optimistic transaction */
+  inline std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> GetReadSet() { return read_set_; }
+
+  /** @return the tables scanned by an optimistic transaction, which conflict with any concurrent insert */
+  inline std::shared_ptr<std::unordered_set<TableHeap *>> GetScanSet() { return scan_set_; }
 
   /** @return true if rid is shared locked by this transaction */
-  bool IsSharedLocked(const RID &rid) { return shared_lock_set_->find(rid) != shared_lock_set_->end(); }
+  bool IsSharedLocked(const RID &rid) { return shared_lock_set_->Contains(rid); }
 
   /** @return true if rid is exclusively locked by this transaction */
-  bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end(); }
+  bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->Contains(rid); }
+
+  /**
+   * @return true if rid of table oid is locked in lock_mode (SHARED or EXCLUSIVE) or stronger, by a lock on the row
+   * itself or by one on its page or table
+   */
+  bool IsRowLocked(table_oid_t oid, const RID &rid, LockMode lock_mode) {
+    auto covers = [lock_mode](LockMode held) {
+      return held == LockMode::EXCLUSIVE ||
+             (lock_mode == LockMode::SHARED &&
+              (held == LockMode::SHARED || held == LockMode::SHARED_INTENTION_EXCLUSIVE));
+    };
+    auto table = table_lock_modes_->find(oid);
+    auto page = page_lock_modes_->find(rid.GetPageId());
+    return IsExclusiveLocked(rid) || (lock_mode == LockMode::SHARED && IsSharedLocked(rid)) ||
+           (table != table_lock_modes_->end() && covers(table->second)) ||
+           (page != page_lock_modes_->end() && covers(page->second));
+  }
 
   /** @return the current state of the transaction */
-  inline TransactionState GetState() { return state_; }
+  inline TransactionState GetState() { return state_.load(); }
 
   /**
    * Set the state of the transaction.
    * @param state new state
    */
-  inline void SetState(TransactionState state) { state_ = state; }
+  inline void SetState(TransactionState state) { state_.store(state); }
 
   /** @return the previous LSN */
   inline lsn_t GetPrevLSN() { return prev_lsn_; }
@@ -246,15 +329,41 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the BEGIN record */
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  /**
+   * Set the LSN of the BEGIN record.
+   * @param begin_lsn new begin lsn
+   */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
+  /** @return the commit timestamp of the snapshot the transaction reads */
+  inline timestamp_t GetReadTs() const { return read_ts_; }
+
+  /** Set the commit timestamp of the snapshot the transaction reads. */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  /** @return the commit timestamp of the transaction, INVALID_TS until it commits */
+  inline timestamp_t GetCommitTs() const { return commit_ts_; }
+
+  /** Set the commit timestamp of the transaction. */
+  inline void SetCommitTs(timestamp_t commit_ts) { commit_ts_ = commit_ts; }
+
  private:
-  /** The current transaction state. */
-  TransactionState state_;
+  /** The current transaction state. Other transactions abort this one by setting it, e.g. when wounding it. */
+  std::atomic<TransactionState> state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
   txn_id_t txn_id_;
+  /** The order the transaction was created in. */
+  timestamp_t start_ts_;
+  inline static std::atomic<timestamp_t> next_start_ts{0};
+  /** The TransactionRefs to this transaction, which keep it from being handed back to its owner to be freed. */
+  std::atomic<int32_t> ref_count_{0};
 
   /** The undo set of table tuples. */
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
@@ -262,6 +371,12 @@ class Transaction {
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** The LSN of the BEGIN record, undo of the transaction needs the log from here on. */
+  lsn_t begin_lsn_;
+  /** MVCC: the transaction sees the versions committed at or before read_ts_. */
+  timestamp_t read_ts_{0};
+  /** MVCC: the timestamp the writes of the transaction were committed at. */
+  timestamp_t commit_ts_{INVALID_TS};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
@@ -269,9 +384,30 @@ class Transaction {
   std::shared_ptr<std::unordered_set<page_id_t>> deleted_page_set_;
 
   /** LockManager: the set of shared-locked tuples held by this transaction. */
-  std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
+  std::shared_ptr<LockSet> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
-  std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  std::shared_ptr<LockSet> exclusive_lock_set_;
+  /**
+   * LockManager: the shared locks that hold a reader count in a lock word rather than a request in the lock table.
+   * Other transactions move them into the lock table under fast_lock_latch_ when a conflicting request shows up.
+   */
+  std::shared_ptr<LockSet> fast_shared_lock_set_;
+  std::mutex fast_lock_latch_;
+  /** LockManager: the mode of every table lock held by this transaction. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_modes_;
+  /** LockManager: the mode of every page lock held by this transaction. */
+  std::shared_ptr<std::unordered_map<page_id_t, LockMode>> page_lock_modes_;
+  /** LockManager: the page locks below each table, released when the table lock is escalated. */
+  std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<page_id_t>>> page_locks_by_table_;
+  /** LockManager: the row locks below each table, released when the table lock is escalated. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockSet>> row_locks_by_table_;
+  /** LockManager: the mode of every index key lock held by this transaction. */
+  std::shared_ptr<std::unordered_map<int64_t, LockMode>> key_lock_modes_;
+
+  /** OCC: the tuples read, validated at commit. */
+  std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> read_set_;
+  /** OCC: the tables scanned, validated at commit against inserts. */
+  std::shared_ptr<std::unordered_set<TableHeap *>> scan_set_;
 };
 
 }  // namespace bustub
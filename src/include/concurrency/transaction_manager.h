@@ -12,12 +12,22 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <set>
 #include <shared_mutex>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "common/quiescence_latch.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
 #include "recovery/log_manager.h"
@@ -25,6 +35,38 @@
 namespace bustub {
 class LockManager;
 
+/**
+ * A reference to a running transaction, found by TransactionManager::GetTransaction(), or to none. The transaction may
+ * finish while it is referenced, but Commit() and Abort() only hand it back to its owner, who frees it, once the last
+ * reference to it is gone.
+ */
+class TransactionRef {
+ public:
+  TransactionRef() = default;
+
+  explicit TransactionRef(Transaction *txn) : txn_(txn) {
+    if (txn_ != nullptr) {
+      txn_->ref_count_++;
+    }
+  }
+
+  ~TransactionRef() {
+    if (txn_ != nullptr) {
+      txn_->ref_count_--;
+    }
+  }
+
+  DISALLOW_COPY_AND_MOVE(TransactionRef);
+
+  inline Transaction *operator->() const { return txn_; }
+  inline Transaction *Get() const { return txn_; }
+  inline bool operator==(std::nullptr_t) const { return txn_ == nullptr; }
+  inline bool operator!=(std::nullptr_t) const { return txn_ != nullptr; }
+
+ private:
+  Transaction *txn_{nullptr};
+};
+
 /**
  * TransactionManager keeps track of all the transactions running in the system.
  */
@@ -33,7 +75,8 @@ class TransactionManager {
   explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr)
       : lock_manager_(lock_manager), log_manager_(log_manager) {}
 
-  ~TransactionManager() = default;
+  /** Tells the tables it still sweeps that it is gone. */
+  ~TransactionManager();
 
   /**
    * Begins a new transaction.
@@ -44,10 +87,11 @@ class TransactionManager {
   Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
 
   /**
-   * Commits a transaction.
+   * Commits a transaction. An optimistic transaction is validated first, and aborted if it fails.
    * @param txn the transaction to commit
+   * @return false if the transaction was aborted instead
    */
-  void Commit(Transaction *txn);
+  bool Commit(Transaction *txn);
 
   /**
    * Aborts a transaction
@@ -59,31 +103,111 @@ class TransactionManager {
    * Global list of running transactions
    */
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /** A part of the transaction map, holding the transactions whose id falls into it. */
+  struct alignas(64) TxnMapShard {
+    std::shared_mutex latch_;
+    std::unordered_map<txn_id_t, Transaction *> txns_;
+  };
 
   /**
-   * Locates and returns the transaction with the given transaction ID.
-   * @param txn_id the id of the transaction to be found, it must exist!
-   * @return the transaction with the given transaction id
+   * The transaction map is a global list of all the running transactions in the system. It is sharded by transaction
+   * id, so that transactions beginning and ending on different threads rarely meet on a latch.
    */
-  static Transaction *GetTransaction(txn_id_t txn_id) {
-    TransactionManager::txn_map_mutex.lock_shared();
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
-    assert(res != nullptr);
-    TransactionManager::txn_map_mutex.unlock_shared();
-    return res;
+  static std::array<TxnMapShard, TXN_MAP_SHARD_NUM> txn_map;
+
+  /** @return the shard of the transaction map that holds txn_id */
+  static TxnMapShard *GetTxnMapShard(txn_id_t txn_id) { return &txn_map[txn_id % TXN_MAP_SHARD_NUM]; }
+
+  /**
+   * Locates the running transaction with the given transaction ID. It is not freed while the returned reference lives.
+   * @param txn_id the id of the transaction to be found
+   * @return a reference to the transaction, or to none if it is not running (anymore)
+   */
+  static TransactionRef GetTransaction(txn_id_t txn_id) {
+    TxnMapShard *shard = GetTxnMapShard(txn_id);
+    std::shared_lock shard_latch(shard->latch_);
+    auto txn = shard->txns_.find(txn_id);
+    return TransactionRef(txn == shard->txns_.end() ? nullptr : txn->second);
   }
 
+  /**
+   * Calls visit on every running transaction, one shard at a time. A visited transaction cannot finish before visit
+   * returns, but the transactions of different shards are not seen at the same instant.
+   */
+  static void ForEachTransaction(const std::function<void(Transaction *)> &visit) {
+    for (TxnMapShard &shard : txn_map) {
+      std::shared_lock shard_latch(shard.latch_);
+      for (const auto &[txn_id, txn] : shard.txns_) {
+        visit(txn);
+      }
+    }
+  }
+
+  /**
+   * Snapshots the active transaction table without blocking transactions, used for fuzzy checkpointing.
+   * @return an entry for every running transaction
+   */
+  std::vector<ActiveTxnEntry> GetActiveTransactionTable();
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
   void ResumeTransactions();
 
+  /**
+   * @return the oldest read timestamp of any running snapshot isolation or optimistic transaction, or the newest commit
+   * timestamp if there is none. Versions that ended at or before it are garbage, and so are the commits at or before it
+   * kept for validation.
+   */
+  timestamp_t GetWatermark();
+
+  /**
+   * Stops sweeping the versions of table, called when it is destroyed.
+   * @param table a table a commit left versions in
+   */
+  void ForgetTable(TableHeap *table);
+
+  /** @return the number of commits kept for validation */
+  size_t CommittedWriteCount();
+
  private:
+  /** The tuples written by a committed transaction, kept while an optimistic transaction may have to validate. */
+  struct CommittedWrites {
+    timestamp_t commit_ts_;
+    std::vector<std::pair<TableHeap *, RID>> rids_;
+    /** The tables the transaction inserted into, which conflict with a scan. */
+    std::unordered_set<TableHeap *> inserted_tables_;
+  };
+
+  /**
+   * Validates an optimistic transaction, then stamps the writes of a committing transaction with the next commit
+   * timestamp. Snapshots do not see any of them before PublishCommit().
+   * @return false if the transaction failed validation
+   */
+  bool CommitVersions(Transaction *txn);
+
+  /**
+   * Drops the versions no snapshot can see anymore from every table a commit left versions in, and the committed writes
+   * no optimistic transaction has to validate against anymore. Runs every MVCC_GC_INTERVAL finished transactions,
+   * whether they wrote anything or not, and is skipped while another sweep is running.
+   */
+  void CollectGarbage();
+
+  /**
+   * Makes the versions stamped by a committed transaction visible to new snapshots, once its commit record is in the
+   * log. Commits are published in commit timestamp order, so a snapshot never sees a commit whose predecessors it
+   * misses, and never depends on a commit that is not logged yet.
+   */
+  void PublishCommit(Transaction *txn);
+
+  /**
+   * Backward validation: checks that no transaction that committed after txn began wrote a tuple txn read, or inserted
+   * into a table txn scanned. Must be called under commit_latch_.
+   * @return true if txn may commit
+   */
+  bool Validate(Transaction *txn);
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -99,14 +223,75 @@ class TransactionManager {
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    txn->GetRowLocksByTable()->clear();
+    auto key_lock_modes = *txn->GetKeyLockModes();
+    for (const auto &[key_id, lock_mode] : key_lock_modes) {
+      lock_manager_->UnlockKey(txn, key_id);
+    }
+    // the locks of a level are released before the intention locks above them
+    auto page_locks_by_table = *txn->GetPageLocksByTable();
+    for (const auto &[oid, page_ids] : page_locks_by_table) {
+      for (auto page_id : page_ids) {
+        lock_manager_->UnlockPage(txn, oid, page_id);
+      }
+    }
+    txn->GetPageLocksByTable()->clear();
+    auto table_lock_modes = *txn->GetTableLockModes();
+    for (const auto &[oid, lock_mode] : table_lock_modes) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
+  }
+
+  /**
+   * Removes a finished transaction from the map of running transactions, and waits for the references to it to go.
+   * @param txn the committed or aborted transaction
+   */
+  void EraseTransaction(Transaction *txn) {
+    TxnMapShard *shard = GetTxnMapShard(txn->GetTransactionId());
+    {
+      std::unique_lock shard_latch(shard->latch_);
+      shard->txns_.erase(txn->GetTransactionId());
+    }
+    // no new reference can be taken, and the existing ones are only held for a lookup
+    while (txn->ref_count_ > 0) {
+      std::this_thread::yield();
+    }
   }
 
+  /**
+   * @return a new transaction id. Each thread takes TXN_ID_BLOCK_SIZE ids at once and hands them out itself, so ids
+   * only grow within a thread.
+   */
+  txn_id_t NextTxnId();
+
+  /** Tells the id blocks of different transaction managers apart in a thread. */
+  static std::atomic<uint64_t> next_instance_id;
+  const uint64_t instance_id_{next_instance_id++};
+  /** The first id of the next block of ids. */
   std::atomic<txn_id_t> next_txn_id_{0};
+  /** The timestamp of the latest published commit, new snapshots read as of it. */
+  std::atomic<timestamp_t> last_commit_ts_{0};
+  /** Serializes the validation and stamping of commits. */
+  std::mutex commit_latch_;
+  /** The timestamp of the latest stamped commit, guarded by commit_latch_. */
+  timestamp_t stamped_commit_ts_{0};
+  /** Guards the publishing of commits. */
+  std::mutex publish_latch_;
+  /** Stamped and logged commits waiting for an earlier commit to be published, guarded by publish_latch_. */
+  std::set<timestamp_t> logged_commits_;
+  /** Counts committed and aborted transactions, to start a sweep every MVCC_GC_INTERVAL of them. */
+  std::atomic<uint64_t> finished_count_{0};
+  /** The writes of recent commits by increasing commit timestamp, guarded by commit_latch_. */
+  std::deque<CommittedWrites> committed_writes_;
+  /** The tables a commit left versions in, guarded by commit_latch_. */
+  std::unordered_set<TableHeap *> versioned_tables_;
+  /** Held while sweeping, so that a swept table is not destroyed meanwhile. Taken before commit_latch_. */
+  std::mutex gc_latch_;
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /** The global transaction latch is used for checkpointing, running transactions are counted per thread. */
+  QuiescenceLatch global_txn_latch_;
 };
 
 }  // namespace bustub
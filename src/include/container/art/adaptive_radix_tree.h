@@ -0,0 +1,179 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.h
+//
+// Identification: src/include/container/art/adaptive_radix_tree.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/epoch_reclaimer.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+#define ART_TYPE AdaptiveRadixTree<KeyType, ValueType, KeyComparator>
+
+/**
+ * In-memory adaptive radix tree (ART) over normalized keys (see GenericKey::SetFromKey()). The tree reads a key as the
+ * string of its first KeyComparator::ComparedSize() bytes, and orders keys the way the comparator does. Keys are
+ * unique and all of the same length, so no key is the prefix of another: every key ends at a leaf of its own, which
+ * holds the whole key, bytes past the compared ones included, and its value. Leaves never change once made.
+ *
+ * Inner nodes branch on one key byte. They come in four sizes, for up to 4, 16, 48 and 256 children, and are replaced
+ * by the next size when full or by the previous one when sparse. Each inner node stores the whole prefix its children
+ * share, so a chain of single-child nodes is never built; keys are short enough for that. A node left with a single
+ * child is cut out of the tree. The root is a node for 256 children and is never replaced.
+ *
+ * Concurrency follows optimistic lock coupling. Every inner node has a version, which writers bump when they unlock
+ * it. Readers take no locks: they read a node, check that its version is unchanged, and start over if it changed.
+ * Writers take the same path and upgrade to a lock only on the one or two nodes they change. A replaced node is marked
+ * obsolete, so that readers still on it start over. It is freed, like a removed leaf, once every operation that may
+ * have reached it has ended (see EpochReclaimer).
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class AdaptiveRadixTree {
+ public:
+  /** @param comparator the comparator of the keys, whose ComparedSize() is the length of the keys in the tree */
+  explicit AdaptiveRadixTree(const KeyComparator &comparator);
+
+  ~AdaptiveRadixTree();
+
+  DISALLOW_COPY_AND_MOVE(AdaptiveRadixTree);
+
+  /**
+   * Insert a key and its value.
+   * @return false if the key is in the tree already
+   */
+  bool Insert(const KeyType &key, const ValueType &value);
+
+  /**
+   * Remove a key and its value.
+   * @return false if the key is not in the tree
+   */
+  bool Remove(const KeyType &key);
+
+  /**
+   * Append the value of key to result.
+   * @return false if the key is not in the tree
+   */
+  bool GetValue(const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Append the entries of the keys in [low, high] to result, in key order, up to max_count of them.
+   * @return true if the scan stopped at max_count, and there may be more
+   */
+  bool ScanRange(const KeyType &low, const KeyType &high, size_t max_count,
+                 std::vector<std::pair<KeyType, ValueType>> *result);
+
+ private:
+  enum class NodeType : uint8_t { NODE4, NODE16, NODE48, NODE256 };
+
+  /** An inner node. Its children are nodes, or leaves tagged with the low pointer bit (see IsLeaf()). */
+  struct Node {
+    explicit Node(NodeType type) : type_(type) {}
+
+    /** Bumped by 0b100 on every change; bit 0b10 is set while the node is locked, bit 0b1 once it is obsolete. */
+    std::atomic<uint64_t> version_{0b100};
+    NodeType type_;
+    uint16_t count_{0};
+    uint32_t prefix_length_{0};
+    /** The key bytes every child shares, past those of the ancestors. */
+    uint8_t prefix_[sizeof(KeyType)];
+  };
+
+  /** Up to 4 (16) children, with their key bytes in increasing order. */
+  template <size_t Capacity>
+  struct SortedNode : public Node {
+    explicit SortedNode(NodeType type) : Node(type) {}
+
+    uint8_t keys_[Capacity];
+    Node *children_[Capacity];
+  };
+  using Node4 = SortedNode<4>;
+  using Node16 = SortedNode<16>;
+
+  /** Up to 48 children, in the slots a byte-indexed array points to, plus one. */
+  struct Node48 : public Node {
+    Node48() : Node(NodeType::NODE48) {}
+
+    uint8_t child_index_[256] = {};
+    Node *children_[48] = {};
+  };
+
+  struct Node256 : public Node {
+    Node256() : Node(NodeType::NODE256) {}
+
+    Node *children_[256] = {};
+  };
+
+  struct Leaf {
+    KeyType key_;
+    ValueType value_;
+  };
+
+  /** Keeps the nodes and leaves an operation may reach from being freed while it runs. */
+  using EpochGuard = typename EpochReclaimer<Node *>::Guard;
+
+  static bool IsLeaf(const Node *child) { return (reinterpret_cast<uintptr_t>(child) & 1) != 0; }
+  static Leaf *AsLeaf(Node *child) { return reinterpret_cast<Leaf *>(reinterpret_cast<uintptr_t>(child) & ~1); }
+  static Node *AsChild(Leaf *leaf) { return reinterpret_cast<Node *>(reinterpret_cast<uintptr_t>(leaf) | 1); }
+  static const uint8_t *Bytes(const KeyType &key) { return reinterpret_cast<const uint8_t *>(&key); }
+
+  /* Optimistic lock coupling; each of these returns false if the operation has to start over. */
+  static bool ReadLock(Node *node, uint64_t *version);
+  static bool Validate(Node *node, uint64_t version);
+  static bool Upgrade(Node *node, uint64_t version);
+  static void WriteUnlock(Node *node);
+  static void WriteUnlockObsolete(Node *node);
+
+  /* Node contents; only FindChild() and Children() may run on a node that is not locked. */
+  static uint8_t *SortedKeys(Node *node);
+  static Node **SortedChildren(Node *node);
+  static Node *FindChild(Node *node, uint8_t byte);
+  static size_t Children(Node *node, int from, int to, std::pair<uint8_t, Node *> *children);
+  static bool IsFull(const Node *node);
+  static bool IsSparse(const Node *node);
+  static void AddChild(Node *node, uint8_t byte, Node *child);
+  static void ChangeChild(Node *node, uint8_t byte, Node *child);
+  static void RemoveChild(Node *node, uint8_t byte);
+  static Node *Resize(Node *node, NodeType type);
+  static Node4 *NewNode4(const uint8_t *prefix, uint32_t prefix_length);
+  static void FreeNode(Node *node);
+  static void FreeSubtree(Node *node);
+
+  /** @return the length of the prefix node shares with key from depth on */
+  uint32_t PrefixMatch(Node *node, const uint8_t *key, size_t depth) const;
+
+  /* One attempt of an operation: false if it has to start over, else its result goes to the out parameter. */
+  bool TryInsert(const KeyType &key, const ValueType &value, bool *inserted);
+  bool TryRemove(const KeyType &key, bool *removed);
+  bool TryGetValue(const KeyType &key, std::vector<ValueType> *result, bool *found);
+  bool TryScan(Node *node, size_t depth, const uint8_t *low, const uint8_t *high, bool on_low, bool on_high,
+               size_t max_count, std::vector<std::pair<KeyType, ValueType>> *result, bool *more);
+
+  /** Free the nodes and leaves unlinked two epochs ago if no operation that may have reached them runs any more. */
+  void Reclaim();
+
+  /** The length of the keys, in bytes. */
+  const size_t key_length_;
+  Node256 *root_;
+
+  /** Unlinked nodes and leaves, waiting for the operations that may be on them to end. */
+  EpochReclaimer<Node *> reclaimer_;
+};
+
+}  // namespace bustub
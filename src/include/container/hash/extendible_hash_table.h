@@ -19,6 +19,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
+#include "recovery/index_log.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
 
@@ -30,6 +31,9 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * With a log manager, bucket entries are logged as INDEX_INSERT / INDEX_DELETE records of the transaction, and bucket
+ * splits and merges as redo-only records carrying the directory and bucket images.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +44,24 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param log_manager if not null, page changes are written ahead to this log
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               LogManager *log_manager = nullptr);
+
+  /**
+   * Opens an existing ExtendibleHashTable, e.g. after a restart.
+   *
+   * @param directory_page_id the directory page of the table
+   */
+  ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                      HashFunction<KeyType> hash_fn, page_id_t directory_page_id, LogManager *log_manager = nullptr);
+
+  /**
+   * @return the page id of the directory page, which identifies the table
+   */
+  page_id_t GetDirectoryPageId() const { return directory_page_id_; }
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -136,6 +155,23 @@ class ExtendibleHashTable {
    */
   HASH_TABLE_BUCKET_TYPE *FetchBucketPage(page_id_t bucket_page_id);
 
+  /**
+   * Fetches a page, throwing if the buffer pool has no frame for it.
+   */
+  Page *FetchPage(page_id_t page_id);
+
+  /**
+   * Splits the bucket at bucket_idx, growing the directory if needed, and logs the split.
+   *
+   * @return false if the directory is already at its maximum size
+   */
+  bool SplitBucket(Page *dir_raw_page, uint32_t bucket_idx, IndexLog *log);
+
+  /**
+   * @return the descriptor of this table for index log records
+   */
+  IndexDescriptor Descriptor();
+
   /**
    * Performs insertion with an optional bucket splitting.
    *
@@ -162,6 +198,7 @@ class ExtendibleHashTable {
   void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
 
   // member variables
+  std::string index_name_;
   page_id_t directory_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
@@ -169,6 +206,7 @@ class ExtendibleHashTable {
   // Readers includes inserts and removes, writers are splits and merges
   ReaderWriterLatch table_latch_;
   HashFunction<KeyType> hash_fn_;
+  LogManager *log_manager_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "common/rid.h"
@@ -24,6 +25,12 @@ namespace bustub {
 
 /**
  * IndexScanExecutor executes an index scan over a table.
+ *
+ * When the index stores every column the plan reads (see Index::StoresCoveredColumns()), the scan is index-only: it
+ * evaluates the plan on the entries of the index and never visits the table heap. That takes a transaction that
+ * needs nothing from the heap but the tuple itself: one reading uncommitted data, or a REPEATABLE_READ one on an index
+ * that takes key locks (see Index::TakesKeyLocks()), which keep it from seeing phantoms and uncommitted entries. The
+ * others still read every tuple from the heap, for its row lock or its visible version.
  */
 
 class IndexScanExecutor : public AbstractExecutor {
@@ -42,7 +49,23 @@ class IndexScanExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /** @return true if expr only reads columns the index covers */
+  bool Covers(const AbstractExpression *expr) const;
+
+  /** Set tuple to the table tuple of an index entry, with the columns the entry does not cover NULL. */
+  void TupleFromEntry(const Tuple &entry, Tuple *tuple) const;
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The index being scanned, and the table it indexes. */
+  IndexInfo *index_info_{nullptr};
+  TableInfo *table_info_{nullptr};
+  std::unique_ptr<IndexRangeScan> scan_;
+  /** The batch of RIDs the scan is on, and the next one to fetch. */
+  std::vector<RID> rids_;
+  size_t next_rid_{0};
+  /** Whether the scan reads the entries of rids_ instead of the table heap. */
+  bool index_only_{false};
+  std::vector<Tuple> entries_;
 };
 }  // namespace bustub
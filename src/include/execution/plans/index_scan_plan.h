@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "catalog/catalog.h"
 #include "execution/expressions/abstract_expression.h"
 #include "execution/plans/abstract_plan.h"
@@ -19,6 +22,12 @@
 namespace bustub {
 /**
  * IndexScanPlanNode identifies a table that should be scanned with an optional predicate.
+ *
+ * The scan may be limited to a range of keys, e.g. for `BETWEEN low AND high` on the key, with a bound given as the
+ * values of the key columns. A bound without values leaves the range open on its side.
+ *
+ * If the index stores every column the predicate and the output schema read, the scan is answered from the index
+ * alone, see IndexScanExecutor.
  */
 class IndexScanPlanNode : public AbstractPlanNode {
  public:
@@ -28,9 +37,21 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
    * @param table_oid the identifier of table to be scanned
+   * @param low_key the least key to scan, empty for no lower bound
+   * @param low_inclusive whether low_key itself is scanned
+   * @param high_key the greatest key to scan, empty for no upper bound
+   * @param high_inclusive whether high_key itself is scanned
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    std::vector<Value> low_key = {}, bool low_inclusive = true, std::vector<Value> high_key = {},
+                    bool high_inclusive = true)
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        low_key_(std::move(low_key)),
+        low_inclusive_(low_inclusive),
+        high_key_(std::move(high_key)),
+        high_inclusive_(high_inclusive) {}
 
   PlanType GetType() const override { return PlanType::IndexScan; }
 
@@ -40,11 +61,28 @@ class IndexScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   index_oid_t GetIndexOid() const { return index_oid_; }
 
+  /** @return the values of the least key to scan, empty for no lower bound */
+  const std::vector<Value> &GetLowKey() const { return low_key_; }
+
+  /** @return whether the low key itself is scanned */
+  bool IsLowInclusive() const { return low_inclusive_; }
+
+  /** @return the values of the greatest key to scan, empty for no upper bound */
+  const std::vector<Value> &GetHighKey() const { return high_key_; }
+
+  /** @return whether the high key itself is scanned */
+  bool IsHighInclusive() const { return high_inclusive_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
+  /** The bounds of the keys to scan. */
+  std::vector<Value> low_key_;
+  bool low_inclusive_;
+  std::vector<Value> high_key_;
+  bool high_inclusive_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,11 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,7 +24,9 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager creates ARIES-style fuzzy checkpoints. Transactions keep running while a checkpoint logs the
+ * active transaction table and the dirty page table; dirty pages are written out gradually by a background writer.
+ * Recovery starts reading the log at the smallest recLSN (or BEGIN of an active transaction) of the last checkpoint.
  */
 class CheckpointManager {
  public:
@@ -27,17 +34,44 @@ class CheckpointManager {
                     BufferPoolManager *buffer_pool_manager)
       : transaction_manager_(transaction_manager),
         log_manager_(log_manager),
-        buffer_pool_manager_(buffer_pool_manager) {}
+        buffer_pool_manager_(buffer_pool_manager),
+        writer_thread_(nullptr) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager() { StopBackgroundWriter(); }
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
+  /** Start a thread that writes out a batch of dirty pages every checkpoint_flush_interval. */
+  void RunBackgroundWriter();
+
+  /** Stop and join the background writer. */
+  void StopBackgroundWriter();
+
+  /**
+   * Write out the dirty pages with the oldest recLSNs, following the WAL protocol.
+   * @param max_pages the maximum number of pages to write out
+   */
+  void WriteDirtyPages(size_t max_pages);
+
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  /** LSN of the CHECKPOINT_BEGIN record of the checkpoint in progress. */
+  lsn_t begin_lsn_{INVALID_LSN};
+  /** Active transaction table captured by BeginCheckpoint(). */
+  std::vector<ActiveTxnEntry> active_txns_;
+  /** Dirty page table captured by BeginCheckpoint(). */
+  std::vector<DirtyPageEntry> dirty_pages_;
+
+  std::thread *writer_thread_;
+  bool writer_running_{false};
+  /** Protects writer_running_. */
+  std::mutex writer_latch_;
+  /** Wakes the background writer when it is stopped. */
+  std::condition_variable writer_cv_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,128 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_log.h
+//
+// Identification: src/include/recovery/index_log.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "concurrency/transaction.h"
+#include "recovery/log_manager.h"
+#include "recovery/log_record.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * IndexLog collects the page changes of one index operation and writes them ahead as a single log record, so recovery
+ * redoes the operation completely or not at all.
+ *
+ * Every change must be reported right after it is made to a page that stays pinned and write latched until Append(),
+ * which stamps the record's LSN on all of those pages. The exception are parent page ids written into the children of
+ * a B+ tree page (SetParent): children are not latched for that, so their LSN is left alone and redo simply reapplies
+ * the assignment.
+ *
+ * All methods are no-ops unless logging is enabled and a log manager was given.
+ */
+class IndexLog {
+ public:
+  IndexLog(LogManager *log_manager, Transaction *txn)
+      : log_manager_(enable_logging ? log_manager : nullptr), txn_(txn) {}
+
+  /** @return true if changes are being logged */
+  bool IsEnabled() const { return log_manager_ != nullptr; }
+
+  /** The size bytes at addr, which points into the data of page, were overwritten. */
+  void Write(Page *page, const void *addr, size_t size);
+
+  /** The first size bytes of page were rewritten, e.g. by a split. */
+  void Image(Page *page, size_t size) { Write(page, page->GetData(), size); }
+
+  /** The entry was inserted at slot of a B+ tree page. */
+  void InsertEntry(Page *page, int slot, const void *entry, size_t entry_size);
+
+  /** The entry was removed from slot of a B+ tree page. */
+  void DeleteEntry(Page *page, int slot, const void *entry, size_t entry_size);
+
+  /** The B+ tree page page_id was adopted by parent_id. */
+  void SetParent(page_id_t page_id, page_id_t parent_id);
+
+  /** The header page now records root_id as the root of the index called name. */
+  void SetRoot(Page *header_page, const std::string &name, page_id_t root_id);
+
+  /** Describe the entry an INDEX_INSERT / INDEX_DELETE adds or removes, for logical undo. */
+  void SetEntry(IndexDescriptor index, std::string key, std::string value);
+
+  /**
+   * Append the collected changes as one record of the given type and stamp its LSN on the changed pages. Entry records
+   * belong to the transaction, structure modifications to no transaction, so that undo never reverts them.
+   */
+  void Append(LogRecordType type);
+
+  /** Reapply a logged change to page during redo. The caller sets the page LSN. */
+  static void Redo(const IndexPageOp &op, Page *page);
+
+ private:
+  void AddOp(Page *page, IndexPageOp op);
+
+  LogManager *log_manager_;
+  Transaction *txn_;
+  IndexDescriptor index_;
+  std::string key_;
+  std::string value_;
+  std::vector<IndexPageOp> ops_;
+  std::vector<Page *> pages_;
+};
+
+/** @return the key column types of an index, which only GenericComparator knows */
+template <typename KeyComparator>
+std::vector<TypeId> GetKeyTypes(const KeyComparator &comparator) {
+  return {};
+}
+
+template <size_t KeySize>
+std::vector<TypeId> GetKeyTypes(const GenericComparator<KeySize> &comparator) {
+  std::vector<TypeId> key_types;
+  for (const Column &column : comparator.GetKeySchema()->GetColumns()) {
+    // normalized keys hold strings in full, the others only an offset to them
+    if (!column.IsInlined() && !comparator.IsNormalized()) {
+      return {};
+    }
+    key_types.push_back(column.GetType());
+  }
+  return key_types;
+}
+
+/** @return true if the keys of an index compare as bytes, which only GenericComparator can tell */
+template <typename KeyComparator>
+bool HasNormalizedKeys(const KeyComparator &comparator) {
+  return false;
+}
+
+template <size_t KeySize>
+bool HasNormalizedKeys(const GenericComparator<KeySize> &comparator) {
+  return comparator.IsNormalized();
+}
+
+/** @return how many bytes of a key are compared, 0 if all of them are or that is unknown */
+template <typename KeyComparator>
+int32_t ComparedKeySize(const KeyComparator &comparator) {
+  return 0;
+}
+
+template <size_t KeySize>
+int32_t ComparedKeySize(const GenericComparator<KeySize> &comparator) {
+  return static_cast<int32_t>(comparator.ComparedSize());
+}
+
+}  // namespace bustub
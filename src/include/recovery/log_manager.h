@@ -16,6 +16,9 @@
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+#include <utility>
+#include <vector>
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -29,7 +32,11 @@ namespace bustub {
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : next_lsn_(NextLSNAfterLog(disk_manager)),
+        persistent_lsn_(next_lsn_ - 1),
+        flush_thread_(nullptr),
+        disk_manager_(disk_manager),
+        log_offset_(disk_manager->GetLogEndOffset()) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
   }
@@ -46,13 +53,33 @@ class LogManager {
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
+  /**
+   * Force the log buffer to disk and block until every record up to and including lsn is persistent.
+   * @param lsn the log sequence number that must become persistent
+   */
+  void Flush(lsn_t lsn);
+
+  /**
+   * Record in the master record that recovery may start reading the log at redo_start_lsn, then release the log
+   * segments before it.
+   * @param redo_start_lsn an already persistent LSN, no record before it is needed by recovery
+   */
+  void WriteMasterRecord(lsn_t redo_start_lsn);
+
   inline lsn_t GetNextLSN() { return next_lsn_; }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /**
+   * LSNs go on from the last record already in the log, so they keep increasing across restarts.
+   * @return the LSN after that of the last record in the log, 0 for an empty log
+   */
+  static lsn_t NextLSNAfterLog(DiskManager *disk_manager);
+
+  /** Write out the log buffer, releasing the latch during disk I/O. Only called by the flush thread. */
+  void FlushLogBuffer(std::unique_lock<std::mutex> *latch);
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
@@ -61,14 +88,29 @@ class LogManager {
 
   char *log_buffer_;
   char *flush_buffer_;
-
+  /** Number of bytes appended to log_buffer_. */
+  int buffer_offset_{0};
+  /** LSN of the first record in log_buffer_, INVALID_LSN if it holds none. */
+  lsn_t buffer_first_lsn_{INVALID_LSN};
+  /** True if a thread is waiting for the log buffer to be flushed. */
+  bool need_flush_{false};
+
+  /** Protects the log buffer and everything below. */
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_;
 
+  /** Wakes the flush thread. */
   std::condition_variable cv_;
+  /** Wakes threads waiting for buffer space or persistence. */
+  std::condition_variable flushed_cv_;
+
+  DiskManager *disk_manager_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  /** Logical log offset at which log_buffer_ will be written. */
+  size_t log_offset_;
+  /** (first LSN, logical log offset) of every flushed block that recovery may still need, in LSN order. */
+  std::vector<std::pair<lsn_t, size_t>> block_offsets_;
 };
 
 }  // namespace bustub
@@ -14,9 +14,12 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
+#include "type/type_id.h"
 
 namespace bustub {
 /** The type of the log record. */
@@ -32,12 +35,77 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint. */
+  CHECKPOINT_BEGIN,
+  /** End of a fuzzy checkpoint, once the log is flushed and before the master record points at it. */
+  CHECKPOINT_END,
+  /** An entry added to a B+ tree leaf or a hash bucket. Undone logically through the index. */
+  INDEX_INSERT,
+  /** An entry removed from a B+ tree leaf or a hash bucket. Undone logically through the index. */
+  INDEX_DELETE,
+  /** Page splits on behalf of an insert, including the parent or directory update. Redo only. */
+  INDEX_SPLIT,
+  /** Merges and redistributions on behalf of a delete, including a collapsing root. Redo only. */
+  INDEX_MERGE,
+  /** A B+ tree root created or dropped, or a hash table directory created. Redo only. */
+  INDEX_ROOT_CHANGE,
+};
+
+/** An entry of the active transaction table taken by a checkpoint. */
+struct ActiveTxnEntry {
+  txn_id_t txn_id_;
+  /** LSN of the transaction's BEGIN record. */
+  lsn_t begin_lsn_;
+  /** LSN of the last record written by the transaction. */
+  lsn_t last_lsn_;
+};
+
+/** An entry of the dirty page table taken by a checkpoint. */
+struct DirtyPageEntry {
+  page_id_t page_id_;
+  /** LSN of the first record that dirtied the page since it was last written out. */
+  lsn_t rec_lsn_;
+};
+
+/** Names the index an index log record belongs to, so undo can reopen it. */
+struct IndexDescriptor {
+  std::string name_;
+  /** Directory page of an extendible hash table; INVALID_PAGE_ID for a B+ tree, whose root is found by name. */
+  page_id_t directory_page_id_{INVALID_PAGE_ID};
+  /** Types of the key columns; empty if the key is not a GenericKey, in which case the entry cannot be undone. */
+  std::vector<TypeId> key_types_;
+  /** True if the keys are normalized (see GenericKey::SetFromKey()), and compare as bytes. */
+  bool normalized_keys_{false};
+  /** How many bytes of a normalized key are compared, the rest being payload; 0 if all of them are. */
+  int32_t compared_key_size_{0};
+};
+
+/**
+ * A physiological change to one index page: it names the page and describes the change in terms of the page layout,
+ * without knowing the key type.
+ */
+struct IndexPageOp {
+  enum class Kind : int32_t {
+    /** Overwrite the page with data_ starting at byte offset_. */
+    WRITE = 0,
+    /** Insert the entry data_ at slot offset_ of a B+ tree page, shifting the entries behind it. */
+    INSERT_ENTRY,
+    /** Remove the entry data_ at slot offset_ of a B+ tree page, shifting the entries behind it. */
+    DELETE_ENTRY,
+    /** Record offset_ as the root page id of the index named data_ in the header page. */
+    SET_ROOT,
+  };
+
+  Kind kind_{Kind::WRITE};
+  page_id_t page_id_{INVALID_PAGE_ID};
+  int32_t offset_{0};
+  std::string data_;
 };
 
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in total).
+ * For EACH log record, HEADER is like (5 fields in common, 28 bytes in total, the LSNs take 8 bytes each).
  *---------------------------------------------
  * | size | LSN | transID | prevLSN | LogType |
  *---------------------------------------------
@@ -54,9 +122,17 @@ enum class LogRecordType {
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * Checkpoint begin and end type log records are only a HEADER.
+ * For index type log records (strings and arrays are prefixed with their int32 length, key types take one byte each)
+ *-------------------------------------------------------------------------------------------------------------------
+ * | HEADER | index_name | directory_page_id | normalized | compared_size | key_types | key | value | op_count | ops... |
+ *-------------------------------------------------------------------------------------------------------------------
+ * where each op is (kind, page_id, offset, data).
+ * Key and value are those of the entry an INDEX_INSERT / INDEX_DELETE adds or removes, and are empty otherwise.
+ * All the page changes of one record are redone together, so a split or merge is never replayed halfway.
  */
 class LogRecord {
   friend class LogManager;
@@ -65,7 +141,7 @@ class LogRecord {
  public:
   LogRecord() = default;
 
-  // constructor for Transaction type(BEGIN/COMMIT/ABORT)
+  // constructor for Transaction type(BEGIN/COMMIT/ABORT) and CHECKPOINT_BEGIN/CHECKPOINT_END
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
       : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
 
@@ -110,6 +186,24 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for INDEX_INSERT/INDEX_DELETE/INDEX_SPLIT/INDEX_MERGE/INDEX_ROOT_CHANGE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, IndexDescriptor index,
+            std::string index_key, std::string index_value, std::vector<IndexPageOp> index_ops)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        index_(std::move(index)),
+        index_key_(std::move(index_key)),
+        index_value_(std::move(index_value)),
+        index_ops_(std::move(index_ops)) {
+    // calculate log record size
+    size_ = HEADER_SIZE + 8 * sizeof(int32_t) + index_.name_.size() + index_.key_types_.size() + index_key_.size() +
+            index_value_.size();
+    for (const auto &op : index_ops_) {
+      size_ += 4 * sizeof(int32_t) + op.data_.size();
+    }
+  }
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -128,6 +222,14 @@ class LogRecord {
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline IndexDescriptor &GetIndex() { return index_; }
+
+  inline std::string &GetIndexKey() { return index_key_; }
+
+  inline std::string &GetIndexValue() { return index_value_; }
+
+  inline std::vector<IndexPageOp> &GetIndexOps() { return index_ops_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -176,7 +278,13 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
-  static const int HEADER_SIZE = 20;
+
+  // case5: for index operations
+  IndexDescriptor index_;
+  std::string index_key_;
+  std::string index_value_;
+  std::vector<IndexPageOp> index_ops_;
+  static const int HEADER_SIZE = 28;
 };  // namespace bustub
 
 }  // namespace bustub
@@ -13,10 +13,15 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
 #include "concurrency/lock_manager.h"
 #include "recovery/log_record.h"
 
@@ -24,34 +29,99 @@ namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo is parallel: a single reader parses the log sequentially and routes every record to a worker by hashing the page
+ * id it touches. Each worker therefore sees the records of its pages in LSN order. Undo rolls back each loser
+ * transaction on its own worker.
+ *
+ * The log segments are mapped read-only for the duration of recovery and records are deserialized straight out of the
+ * mappings, so neither phase copies log data into an intermediate buffer.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-  }
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+              size_t num_workers = RECOVERY_WORKER_NUM)
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        num_workers_(std::max<size_t>(num_workers, 1)) {}
 
-  ~LogRecovery() {
-    delete[] log_buffer_;
-    log_buffer_ = nullptr;
-  }
+  ~LogRecovery() { UnmapSegments(); }
 
   void Redo();
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A unit of redo work: apply one log record to one page. */
+  struct RedoTask {
+    std::shared_ptr<LogRecord> log_record_;
+    page_id_t page_id_;
+  };
+
+  /** A log segment mapped by DiskManager::MapLogSegment; data_ is nullptr if the segment no longer exists. */
+  struct MappedSegment {
+    const char *data_{nullptr};
+    size_t size_{0};
+  };
+
+  /** FIFO of redo tasks owned by a single worker. */
+  class RedoQueue {
+   public:
+    void Push(RedoTask task);
+    /** Blocks until a task is available. @return false once the queue is closed and drained */
+    bool Pop(RedoTask *task);
+    void Close();
+
+   private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<RedoTask> tasks_;
+    bool closed_{false};
+  };
+
+  /** Routes a parsed record to the worker(s) owning the page(s) it touches. */
+  void DispatchRedo(const std::shared_ptr<LogRecord> &log_record, std::vector<RedoQueue> *queues);
+
+  /** Replays a record against one page, skipping it if the page already reflects it. */
+  void RedoPage(LogRecord *log_record, page_id_t page_id);
+
+  /** Walks the prevLSN chain of a loser transaction, rolling back each record. */
+  void UndoTxn(lsn_t last_lsn);
+
+  /** Reverts a single record on the page it touches. */
+  void UndoRecord(LogRecord *log_record);
+
+  /** Reverts an index entry record by running the inverse operation on the index. */
+  void UndoIndexRecord(LogRecord *log_record);
+
+  template <size_t KeySize>
+  void UndoIndexEntry(LogRecord *log_record, Schema *key_schema);
+
+  static bool IsIndexRecord(LogRecordType type) {
+    return type >= LogRecordType::INDEX_INSERT && type <= LogRecordType::INDEX_ROOT_CHANGE;
+  }
+
+  /** @return the mapped bytes at a logical log offset, nullptr if that segment is not mapped */
+  const char *GetLogData(size_t offset) const;
+
+  void UnmapSegments();
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  /** Number of redo/undo worker threads. */
+  size_t num_workers_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** Mapping the log sequence number to logical log offset for undos. */
+  std::unordered_map<lsn_t, size_t> lsn_mapping_;
+
+  /** Segments [first_segment_, first_segment_ + segments_.size()) are mapped by Redo and released by Undo. */
+  size_t first_segment_{0};
+  std::vector<MappedSegment> segments_;
 
-  int offset_ __attribute__((__unused__));
-  char *log_buffer_;
+  /** Index undo goes through the index structures, which recovery opens without their usual owners' latches. */
+  std::mutex index_undo_latch_;
 };
 
 }  // namespace bustub
@@ -25,6 +25,12 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * The log is a sequence of fixed-size segment files. Log offsets are logical: offset o lives in segment
+ * o / LOG_SEGMENT_SIZE at o % LOG_SEGMENT_SIZE. Segment files are pre-allocated to their full size, so appends never
+ * extend a file. Segments that recovery no longer needs are either recycled as future segments or deleted. A recycled
+ * segment keeps its old blocks and is overwritten in place; the log manager starts every segment with its segment
+ * number (LOG_SEGMENT_HEADER_SIZE bytes), which tells a segment written since it was recycled from one that was not.
  */
 class DiskManager {
  public:
@@ -34,7 +40,7 @@ class DiskManager {
    */
   explicit DiskManager(const std::string &db_file);
 
-  ~DiskManager() = default;
+  ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -66,10 +72,50 @@ class DiskManager {
    * Read a log entry from the log file.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
+   * @param offset logical log offset of the log entry
    * @return true if the read was successful, false otherwise
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, size_t offset);
+
+  /**
+   * Map a log segment read-only for a sequential scan. The mapping stays valid until it is unmapped, even if the
+   * segment is released in the meantime.
+   * @param segment_no the segment to map
+   * @param[out] size number of mapped bytes
+   * @return start of the mapping, nullptr if the segment does not exist
+   */
+  const char *MapLogSegment(size_t segment_no, size_t *size);
+
+  /**
+   * Release a mapping returned by MapLogSegment.
+   * @param data start of the mapping
+   * @param size number of mapped bytes
+   */
+  void UnmapLogSegment(const char *data, size_t size);
+
+  /** @return the logical log offset the next WriteLog writes to */
+  size_t GetLogEndOffset();
+
+  /**
+   * Release every log segment that lies entirely before offset. Up to LOG_SEGMENT_SPARE_NUM of them are renamed to
+   * future segments, keeping their blocks and old content, the rest are deleted.
+   * @param offset logical log offset before which the log is no longer needed
+   */
+  void TruncateLog(size_t offset);
+
+  /**
+   * Durably record where recovery has to start reading the log. The master record is replaced atomically.
+   * @param redo_offset logical log offset written by the last complete checkpoint
+   * @return false if the new record may not be durable, in which case the log before it has to be kept
+   */
+  bool WriteMasterRecord(size_t redo_offset);
+
+  /**
+   * Read the master record written by the last complete checkpoint.
+   * @param[out] redo_offset logical log offset recovery has to start reading from
+   * @return false if no checkpoint has completed yet
+   */
+  bool ReadMasterRecord(size_t *redo_offset);
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -91,9 +137,26 @@ class DiskManager {
 
  private:
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+  /** @return the file name of a log segment, segment 0 is the log file itself */
+  std::string GetLogSegmentName(size_t segment_no) const;
+  /** Find the existing log segments and the offset at which appending resumes. */
+  void ScanLogSegments();
+  /** Make log_fd_ refer to segment_no, creating and pre-allocating the segment if needed. */
+  bool OpenLogSegment(size_t segment_no);
+  /** Sync the directory holding file_name, so that creating, renaming or removing the file is durable. */
+  static bool SyncDirectory(const std::string &file_name);
+  // file name of log segment 0, later segments append their number
   std::string log_name_;
+  // segment currently appended to, -1 if none is open
+  int log_fd_{-1};
+  size_t log_segment_no_{0};
+  // logical offset of the next log write
+  size_t log_write_offset_{0};
+  // segment files [log_head_segment_, log_end_segment_) may exist on disk
+  size_t log_head_segment_{0};
+  size_t log_end_segment_{0};
+  // file holding the master record of the last checkpoint
+  std::string master_name_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
@@ -103,6 +166,8 @@ class DiskManager {
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
   std::mutex db_io_latch_;
+  // Recovery reads the log from several threads, so log file access is protected as well
+  std::mutex log_io_latch_;
 };
 
 }  // namespace bustub
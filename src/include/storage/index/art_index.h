@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.h
+//
+// Identification: src/include/storage/index/art_index.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "container/art/adaptive_radix_tree.h"
+#include "storage/index/index.h"
+#include "storage/index/index_key_layout.h"
+
+namespace bustub {
+
+#define ART_INDEX_TYPE ArtIndex<KeyType, ValueType, KeyComparator>
+
+/**
+ * Adaptive radix tree index, held in memory only: it takes no pages and writes no log, so it does not survive a
+ * restart and has to be built again from its table. Its keys are laid out like those of the B+ tree index (see
+ * IndexKeyLayout), which the tree reads as byte strings; point lookups follow one path down the tree, and range scans
+ * walk it in key order. Readers never block writers (see AdaptiveRadixTree).
+ *
+ * Transactions take no key locks on the index, so REPEATABLE_READ scans of it may see phantoms.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class ArtIndex : public Index {
+ public:
+  explicit ArtIndex(std::unique_ptr<IndexMetadata> &&metadata);
+
+  ~ArtIndex() override = default;
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  bool StoresCoveredColumns() const override { return layout_.IsCovering(); }
+
+  /**
+   * Reads the range ART_SCAN_BATCH_SIZE entries at a time, each batch in one pass over the tree, and goes on from past
+   * the last key of a batch for the next one. The scan hands out entries if the index stores its covered columns.
+   */
+  std::unique_ptr<IndexRangeScan> ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+                                            bool high_inclusive, Transaction *transaction) override;
+
+ protected:
+  /** A range scan over batches of the tree. */
+  class TreeScan : public IndexRangeScan {
+   public:
+    /** @param done true for an empty range */
+    TreeScan(ArtIndex *index, const KeyType &low, const KeyType &high, bool done)
+        : index_(index), low_(low), high_(high), done_(done) {}
+
+    bool NextBatch(std::vector<RID> *rids) override { return Next(rids, nullptr); }
+
+    bool NextEntries(std::vector<RID> *rids, std::vector<Tuple> *entries) override {
+      if (!index_->StoresCoveredColumns()) {
+        throw NotImplementedException("this index does not store its covered columns");
+      }
+      return Next(rids, entries);
+    }
+
+   private:
+    bool Next(std::vector<RID> *rids, std::vector<Tuple> *entries);
+
+    ArtIndex *index_;
+    /** The least key of what is left of the range. */
+    KeyType low_;
+    KeyType high_;
+    bool done_;
+    std::vector<std::pair<KeyType, ValueType>> batch_;
+  };
+
+  /** How the entries are laid out in the keys; the tree reads the compared bytes only. */
+  IndexKeyLayout<KeyType> layout_;
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  AdaptiveRadixTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
@@ -10,11 +10,19 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <queue>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "common/epoch_reclaimer.h"
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "recovery/index_log.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
@@ -32,6 +40,27 @@ namespace bustub {
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * Writers follow latch crabbing. They first descend with read latches and write latch only the leaf, which is enough
+ * unless the leaf would split or merge. Otherwise they start over and keep the write latches of the nodes a split or
+ * merge could reach, recorded top-down in the transaction's page set (nullptr standing for the latch on
+ * root_page_id_). An insert splits every full node on that path top-down before it touches the leaf, so the structure
+ * modification and the new entry can be logged as two records that are each consistent on their own.
+ *
+ * Point lookups and iterators take no latches at all (B-link). They read each page optimistically, against its
+ * version (see Page::GetVersion()), and read it again if a writer latched it meanwhile, so they never wait for more
+ * than a single page change. A page that split after its parent was read is recognized by its high key, and the
+ * reader moves on to the right sibling. A page that gave keys to its left sibling, or was merged away, sends the
+ * reader back to the root. Merged-away pages, and old roots, are therefore first marked invalid, as a reader may still
+ * be on its way to one. Each latch-free read runs under a guard of reclaimer_, and the pages are deleted once no read
+ * that may have reached them runs any more, nor holds a pin on them (see EpochReclaimer).
+ *
+ * Key-range locking is left to the caller (see BPlusTreeIndex), which passes a KeyLockHook to be called under the leaf
+ * latch with each key the operation has to lock. Locks that must be waited for are never waited for under a latch: the
+ * hook only tries, and the operation gives up when it fails, so that the caller can wait and retry.
+ *
+ * With a log manager, every page change is written ahead through IndexLog: entry changes as INDEX_INSERT /
+ * INDEX_DELETE records of the transaction, structure modifications as redo-only records.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -39,21 +68,40 @@ class BPlusTree {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
 
  public:
+  /**
+   * Called with the leaf latched and a key to lock, nullptr standing for the end of the index. Returns false if the
+   * lock is not free, which makes the operation release its latches and give up.
+   */
+  using KeyLockHook = std::function<bool(const KeyType *key)>;
+
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     LogManager *log_manager = nullptr);
+
+  // Pick up the root page id recorded in the header page, e.g. to reopen the tree after a restart.
+  void LoadRootPageId();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
 
-  // Insert a key-value pair into this B+ tree.
-  bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+  // Insert a key-value pair into this B+ tree, lock_hook is given the key following the new one.
+  bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr,
+              const KeyLockHook &lock_hook = nullptr);
+
+  // Remove a key and its value from this B+ tree, lock_hook is given the key following the removed one.
+  void Remove(const KeyType &key, Transaction *transaction = nullptr, const KeyLockHook &lock_hook = nullptr);
 
-  // Remove a key and its value from this B+ tree.
-  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+  // Build the empty tree bottom-up from count pairs yielded in increasing key order, filling pages to fill_factor.
+  bool BulkLoad(const std::function<bool(MappingType *pair)> &next, size_t count,
+                double fill_factor = INDEX_FILL_FACTOR, Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // return the value associated with a given key, without taking latches
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  // Collect the entries of the keys in [low, high] in key order, lock_hook is given every key read and the one after.
+  bool ScanRange(const KeyType &low, const KeyType &high, std::vector<MappingType> *result,
+                 const KeyLockHook &lock_hook = nullptr);
+
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
@@ -76,33 +124,75 @@ class BPlusTree {
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
-  // expose for test purpose
+  // expose for test purpose; the leaf page is returned pinned and read latched
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
  private:
-  void StartNewTree(const KeyType &key, const ValueType &value);
+  enum class Operation { INSERT, DELETE };
+
+  Page *FetchPage(page_id_t page_id);
+
+  Page *FindLeafPageForWrite(const KeyType &key, Operation op, std::deque<Page *> *page_set);
+
+  Page *FindLeafPageOptimistic(const KeyType &key, Operation op);
+
+  Page *FindLeafPageWithoutLatches(const KeyType &key, bool leftMost, const std::function<void(LeafPage *)> &read);
+
+  typename INDEXITERATOR_TYPE::Seek SeekLeaf();
+
+  void LatchForWrite(Page *page);
+
+  bool IsSafe(BPlusTreePage *node, Operation op, const KeyType &key) const;
+
+  /** A level of a tree being bulk loaded: how many entries and pages it gets, and the page being filled. */
+  struct BulkLevel {
+    size_t entries_;
+    size_t pages_;
+    size_t page_index_;
+    Page *page_;
+  };
+
+  static size_t BulkPageCount(size_t entries, int max_size, int min_size, double fill_factor);
+
+  Page *BulkPageFor(std::vector<BulkLevel> *levels, size_t level, const KeyType &key, IndexLog *log);
+
+  void BulkFinishPage(Page *page, IndexLog *log);
+
+  bool NextKey(Page *leaf_page, int index, KeyType *next, bool *at_end);
+
+  void ReleasePages(std::deque<Page *> *page_set, bool is_dirty);
+
+  Page *NewLatchedPage(std::deque<Page *> *page_set);
+
+  Page *StartNewTree(std::deque<Page *> *page_set, IndexLog *log);
+
+  void InsertIntoLeaf(Page *leaf_page, const KeyType &key, const ValueType &value, IndexLog *log);
+
+  Page *SplitPath(const KeyType &key, std::deque<Page *> *page_set, IndexLog *log);
+
+  Page *Split(Page *page, std::deque<Page *> *page_set, KeyType *separator, IndexLog *log);
+
+  bool CoalesceOrRedistribute(Page *page, Page *parent_page, std::deque<Page *> *page_set,
+                              std::unordered_set<page_id_t> *deleted_page_set, IndexLog *log);
 
-  bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+  void Coalesce(Page *left_page, Page *right_page, Page *parent_page, int index,
+                std::unordered_set<page_id_t> *deleted_page_set, IndexLog *log);
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                        Transaction *transaction = nullptr);
+  void Redistribute(Page *sibling_page, Page *page, Page *parent_page, int index, bool from_right,
+                    const KeyType &separator, IndexLog *log);
 
-  template <typename N>
-  N *Split(N *node);
+  bool AdjustRoot(Page *old_root_page, std::deque<Page *> *page_set, std::unordered_set<page_id_t> *deleted_page_set,
+                  IndexLog *log);
 
-  template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  void UpdateRootPageId(std::deque<Page *> *page_set, IndexLog *log);
 
-  template <typename N>
-  bool Coalesce(N **neighbor_node, N **node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
-                int index, Transaction *transaction = nullptr);
+  void LogImage(Page *page, IndexLog *log) const;
 
-  template <typename N>
-  void Redistribute(N *neighbor_node, N *node, int index);
+  void LogInsertedEntry(Page *page, int index, int prefix, int suffix, IndexLog *log) const;
 
-  bool AdjustRoot(BPlusTreePage *node);
+  void LogChildren(InternalPage *node, int begin, int end, IndexLog *log) const;
 
-  void UpdateRootPageId(int insert_record = 0);
+  IndexDescriptor Descriptor() const;
 
   /* Debug Routines for FREE!! */
   void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
@@ -111,11 +201,17 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  // written under root_latch_, read without it by latch-free readers
+  std::atomic<page_id_t> root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  LogManager *log_manager_;
+  // protects root_page_id_
+  ReaderWriterLatch root_latch_;
+  // pages unlinked by Remove(), deleted once no latch-free reader can reach them
+  EpochReclaimer<page_id_t> reclaimer_;
 };
 
 }  // namespace bustub
@@ -11,22 +11,46 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "concurrency/lock_manager.h"
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/index.h"
+#include "storage/index/index_key_layout.h"
 
 namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * B+ tree index. With a lock manager, transactions take key-range (next-key) locks on its keys, so that repeatable
+ * read scans of the index see no phantoms:
+ * - an insert holds an exclusive lock on the new key until commit, and checks that nobody holds the key after it,
+ *   which guards the gap the new key lands in, without keeping that lock;
+ * - a delete holds exclusive locks on the removed key and the key after it, whose gap grows over the removed one;
+ * - a REPEATABLE_READ scan holds shared locks on every key it reads and on the first key past its range.
+ * The end of the index has a key of its own. Transactions reading without locks and rollbacks take no key locks.
+ *
+ * Keys are normalized (see GenericKey::SetFromKey()), so that the tree compares them as bytes. The tree itself holds
+ * unique keys only: an index that is not unique (see IndexMetadata::IsUnique()) ends every key with its RID, which
+ * orders the entries of a key by RID next to each other, and needs keys of more than 8 bytes. ScanKey() then reads
+ * them all in one pass along the leaves.
+ *
+ * The included columns of the index (see IndexMetadata::GetIncludedAttrs()) follow the key and its RID, normalized
+ * too, as payload the tree does not compare (see IndexKeyLayout). When the whole entry fits, the index stores its
+ * covered columns and range scans can decode the entries from the leaves instead of the table heap.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 LogManager *log_manager = nullptr, LockManager *lock_manager = nullptr,
+                 double fill_factor = INDEX_FILL_FACTOR);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -34,6 +58,30 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  bool StoresCoveredColumns() const override { return layout_.IsCovering(); }
+
+  bool TakesKeyLocks() const override { return lock_manager_ != nullptr; }
+
+  /**
+   * Sorts the entries, spilling to disk if they do not fit in memory, and builds the tree bottom-up from them with its
+   * pages filled to fill_factor. An index that is not empty any more takes them one at a time instead.
+   */
+  void BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) override;
+
+  /**
+   * Scans the range a leaf at a time, and fetches the next leaf in the background while the caller works through the
+   * current one. A REPEATABLE_READ transaction taking key locks locks and reads the whole range at once instead. The
+   * scan hands out entries if the index stores its covered columns.
+   */
+  std::unique_ptr<IndexRangeScan> ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+                                            bool high_inclusive, Transaction *transaction) override;
+
+  /**
+   * Collects the values of the keys in [low, high] in key order, locking the range under REPEATABLE_READ. The bounds
+   * are normalized keys.
+   */
+  void ScanRange(const KeyType &low, const KeyType &high, std::vector<RID> *result, Transaction *transaction);
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
@@ -41,10 +89,105 @@ class BPlusTreeIndex : public Index {
   INDEXITERATOR_TYPE GetEndIterator();
 
  protected:
+  /** @return true if transaction takes key locks for its reads */
+  bool LocksKeys(Transaction *transaction) const {
+    return lock_manager_ != nullptr && transaction != nullptr &&
+           transaction->GetState() != TransactionState::ABORTED;
+  }
+
+  /**
+   * @return true if transaction is aborted and still holds key exclusively, i.e. it is rolling back its own write of
+   * key. An aborted transaction cannot lock, and its other writes are refused.
+   */
+  bool IsRollback(Transaction *transaction, const KeyType *key) const;
+
+  /** Collects the entries of the keys in [low, high] in key order, like ScanRange(). */
+  void ScanEntries(const KeyType &low, const KeyType &high, std::vector<MappingType> *result,
+                   Transaction *transaction);
+
+  /** A range scan along the leaves, or over entries read beforehand. */
+  class LeafScan : public IndexRangeScan {
+   public:
+    LeafScan(const BPlusTreeIndex *index, INDEXITERATOR_TYPE &&iterator, const KeyType *high,
+             std::vector<MappingType> &&items)
+        : index_(index),
+          iterator_(std::move(iterator)),
+          high_(high == nullptr ? KeyType{} : *high),
+          has_high_(high != nullptr),
+          items_(std::move(items)) {}
+
+    bool NextBatch(std::vector<RID> *rids) override { return Next(rids, nullptr); }
+
+    bool NextEntries(std::vector<RID> *rids, std::vector<Tuple> *entries) override {
+      if (!index_->StoresCoveredColumns()) {
+        throw NotImplementedException("this index does not store its covered columns");
+      }
+      return Next(rids, entries);
+    }
+
+   private:
+    bool Next(std::vector<RID> *rids, std::vector<Tuple> *entries) {
+      rids->clear();
+      if (entries != nullptr) {
+        entries->clear();
+      }
+      if (!NextItems()) {
+        return false;
+      }
+      for (const MappingType &item : batch_) {
+        rids->push_back(item.second);
+        if (entries != nullptr) {
+          entries->push_back(index_->layout_.EntryTuple(item.first));
+        }
+      }
+      return true;
+    }
+
+    /** Read the next batch into batch_, @return false if there is none */
+    bool NextItems() {
+      if (!items_.empty()) {
+        batch_.swap(items_);
+        items_.clear();
+        return true;
+      }
+      while (more_ && !iterator_.IsEnd()) {
+        if (started_ && (++iterator_).IsEnd()) {
+          break;
+        }
+        started_ = true;
+        more_ = iterator_.ReadLeafBatch(&batch_, has_high_ ? &high_ : nullptr);
+        if (!batch_.empty()) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    const BPlusTreeIndex *index_;
+    INDEXITERATOR_TYPE iterator_;
+    KeyType high_;
+    bool has_high_;
+    std::vector<MappingType> items_;
+    std::vector<MappingType> batch_;
+    /** Whether the iterator is on an entry handed out already. */
+    bool started_{false};
+    bool more_{true};
+  };
+
+  /** @return the id of key for the lock manager, nullptr standing for the end of the index */
+  int64_t KeyLockId(const KeyType *key) const;
+
+  /** How the entries are laid out in the keys; the comparator looks at the compared bytes only. */
+  IndexKeyLayout<KeyType> layout_;
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  LockManager *lock_manager_;
+  /** How full bulk loading fills the pages, leaving room for inserts. */
+  double fill_factor_;
+  /** Tells the key locks of this index apart from those of other indexes. */
+  size_t key_lock_seed_;
 };
 
 }  // namespace bustub
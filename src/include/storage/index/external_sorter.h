@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.h
+//
+// Identification: src/include/storage/index/external_sorter.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define EXTERNAL_SORTER_TYPE ExternalSorter<KeyType, ValueType, KeyComparator>
+
+/**
+ * ExternalSorter sorts the key & value pairs an index is bulk loaded with, keeping only the first pair added for each
+ * key, as unique-key inserts one at a time would.
+ *
+ * Pairs are collected in memory up to buffer_size bytes. A full buffer is sorted and spilled as a run to a temporary
+ * file, and the runs are merged when the pairs are read back. Runs are written and read sequentially, in blocks, so
+ * sorting more pairs than fit in memory costs two passes over the file, plus one for counting the distinct keys.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSorter {
+ public:
+  explicit ExternalSorter(const KeyComparator &comparator, size_t buffer_size = SORT_BUFFER_SIZE);
+  ~ExternalSorter();
+
+  DISALLOW_COPY_AND_MOVE(ExternalSorter);
+
+  /** Adds a pair. Must not be called after Finish(). */
+  void Add(const KeyType &key, const ValueType &value);
+
+  /**
+   * Sorts the pairs added so far.
+   * @return the number of pairs Next() will yield, one per distinct key
+   */
+  size_t Finish();
+
+  /**
+   * Yields the sorted pairs one at a time, once Finish() was called.
+   * @return false if all pairs were yielded
+   */
+  bool Next(MappingType *pair);
+
+ private:
+  /** A sorted run in the temporary file, at byte offsets [begin_, end_), read back a block at a time. */
+  struct Run {
+    size_t begin_;
+    size_t end_;
+    size_t read_;
+    std::vector<MappingType> block_;
+    size_t block_pos_;
+  };
+
+  /** Sorts the buffer, drops later pairs of the same key and writes what is left out as a run. */
+  void SpillRun();
+
+  /** Sorts the buffer in place, keeping the first pair added for each key. */
+  void SortBuffer();
+
+  /** Rewinds all runs and fills the merge heap with their first pairs. */
+  void StartMerge();
+
+  /** @return false if the run has no pairs left, otherwise its next pair */
+  bool ReadRun(size_t run, MappingType *pair);
+
+  /** @return false if all runs are exhausted, otherwise the next pair of a key not yielded yet */
+  bool NextMerged(MappingType *pair);
+
+  /** @return true if a comes after b in the merge: by key, then by the run it was added to first */
+  bool MergeAfter(const std::pair<MappingType, size_t> &a, const std::pair<MappingType, size_t> &b) const;
+
+  KeyComparator comparator_;
+  size_t buffer_capacity_;
+  std::vector<MappingType> buffer_;
+  size_t buffer_pos_{0};
+  std::FILE *file_{nullptr};
+  size_t file_size_{0};
+  std::vector<Run> runs_;
+  /** The next pair of each run that is not exhausted, paired with the run, as a heap. */
+  std::vector<std::pair<MappingType, size_t>> heap_;
+  /** The key last yielded by the merge, to skip later pairs of the same key. */
+  KeyType last_key_;
+  bool has_last_key_{false};
+};
+
+}  // namespace bustub
@@ -12,19 +12,32 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "common/exception.h"
+#include "common/rid.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
 namespace bustub {
 
+template <size_t KeySize>
+class GenericComparator;
+
 /**
  * Generic key is used for indexing with opaque data.
  *
  * This key type uses an fixed length array to hold data for indexing
  * purposes, the actual size of which is specified and instantiated
  * with a template argument.
+ *
+ * Keys are either the raw key tuple (SetFromKey(tuple)), compared column by
+ * column through Value, or its normalized encoding (SetFromKey(tuple, schema)),
+ * which orders as the tuple does under memcmp, see GenericComparator.
  */
 template <size_t KeySize>
 class GenericKey {
@@ -35,6 +48,218 @@ class GenericKey {
     memcpy(data_, tuple.GetData(), tuple.GetLength());
   }
 
+  /**
+   * Set the key to the order-preserving encoding of the key tuple, column after column:
+   *  - integers and BOOLEAN: big-endian, with the sign bit flipped
+   *  - DECIMAL: big-endian, with the sign bit flipped if positive and all bits flipped if negative
+   *  - TIMESTAMP: big-endian, plus one
+   *  - VARCHAR: a null-ordering byte (0 for NULL, 1 otherwise), then the bytes with every 0 escaped as 0 0xff, then 0 0
+   * Fixed-width NULLs are stored as the least value of their type, which the encodings above map to all zero bytes, so
+   * NULLs order first without taking a byte of their own. An encoding longer than KeySize is cut short, and keys that
+   * only differ past KeySize bytes compare equal. ToValue() does not apply to normalized keys, DecodeColumns() does.
+   */
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    memset(data_, 0, KeySize);
+    EncodeColumns(tuple, key_schema, 0, key_schema->GetColumnCount(), 0, KeySize);
+  }
+
+  /**
+   * Write the normalized encoding of the columns [begin, end) of tuple from byte offset on, cut short at byte limit.
+   * @return the offset past the encoding
+   */
+  inline size_t EncodeColumns(const Tuple &tuple, const Schema *schema, uint32_t begin, uint32_t end, size_t offset,
+                              size_t limit) {
+    auto append = [&](uint8_t byte) {
+      if (offset < limit) {
+        data_[offset++] = static_cast<char>(byte);
+      }
+    };
+    auto append_big_endian = [&](uint64_t bits, int width) {
+      for (int shift = (width - 1) * 8; shift >= 0; shift -= 8) {
+        append(static_cast<uint8_t>(bits >> shift));
+      }
+    };
+    for (uint32_t i = begin; i < end && offset < limit; i++) {
+      const Value value = tuple.GetValue(schema, i);
+      const TypeId type = schema->GetColumn(i).GetType();
+      char raw[sizeof(uint64_t)];
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+        case TypeId::SMALLINT:
+        case TypeId::INTEGER:
+        case TypeId::BIGINT: {
+          int width = static_cast<int>(Type::GetTypeSize(type));
+          value.SerializeTo(raw);
+          uint64_t bits = static_cast<uint64_t>(GenericComparator<KeySize>::ReadInteger(raw, width));
+          append_big_endian(bits ^ (uint64_t{1} << (width * 8 - 1)), width);
+          break;
+        }
+        case TypeId::DECIMAL: {
+          double decimal = value.GetAs<double>();
+          // -0.0 and 0.0 are the same value
+          decimal = decimal == 0 ? 0 : decimal;
+          uint64_t bits;
+          memcpy(&bits, &decimal, sizeof(bits));
+          append_big_endian((bits >> 63) != 0 ? ~bits : bits ^ (uint64_t{1} << 63), sizeof(bits));
+          break;
+        }
+        case TypeId::TIMESTAMP:
+          // the NULL timestamp is the largest, wrap it around to zero
+          append_big_endian(value.GetAs<uint64_t>() + 1, sizeof(uint64_t));
+          break;
+        case TypeId::VARCHAR: {
+          if (value.IsNull()) {
+            append(0);
+            break;
+          }
+          append(1);
+          const char *data = value.GetData();
+          // the length counts the terminating '\0'
+          for (uint32_t j = 0; j + 1 < value.GetLength(); j++) {
+            append(static_cast<uint8_t>(data[j]));
+            if (data[j] == 0) {
+              append(0xff);
+            }
+          }
+          append(0);
+          append(0);
+          break;
+        }
+        default:
+          throw NotImplementedException("cannot normalize index keys of this type");
+      }
+    }
+    return offset;
+  }
+
+  /**
+   * Decode the columns [begin, end) of schema from their normalized encoding at byte offset, see EncodeColumns(). An
+   * encoding that was cut short yields a cut string, or the columns it lost as zero.
+   * @param[out] values The values of the columns are appended to it
+   * @return the offset past the encoding
+   */
+  inline size_t DecodeColumns(const Schema *schema, uint32_t begin, uint32_t end, size_t offset,
+                              std::vector<Value> *values) const {
+    auto next = [&]() -> uint8_t { return offset < KeySize ? static_cast<uint8_t>(data_[offset++]) : 0; };
+    auto next_big_endian = [&](int width) {
+      uint64_t bits = 0;
+      for (int i = 0; i < width; i++) {
+        bits = bits << 8 | next();
+      }
+      return bits;
+    };
+    for (uint32_t i = begin; i < end; i++) {
+      const TypeId type = schema->GetColumn(i).GetType();
+      char raw[sizeof(uint64_t)];
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+        case TypeId::SMALLINT:
+        case TypeId::INTEGER:
+        case TypeId::BIGINT: {
+          int width = static_cast<int>(Type::GetTypeSize(type));
+          uint64_t bits = next_big_endian(width) ^ (uint64_t{1} << (width * 8 - 1));
+          // the low bytes of the integer, as it is serialized
+          memcpy(raw, &bits, width);
+          values->push_back(Value::DeserializeFrom(raw, type));
+          break;
+        }
+        case TypeId::DECIMAL: {
+          uint64_t bits = next_big_endian(sizeof(uint64_t));
+          bits = (bits >> 63) != 0 ? bits ^ (uint64_t{1} << 63) : ~bits;
+          memcpy(raw, &bits, sizeof(bits));
+          values->push_back(Value::DeserializeFrom(raw, type));
+          break;
+        }
+        case TypeId::TIMESTAMP: {
+          uint64_t bits = next_big_endian(sizeof(uint64_t)) - 1;
+          memcpy(raw, &bits, sizeof(bits));
+          values->push_back(Value::DeserializeFrom(raw, type));
+          break;
+        }
+        case TypeId::VARCHAR: {
+          if (next() == 0) {
+            values->push_back(Value(TypeId::VARCHAR, nullptr, 0, false));
+            break;
+          }
+          std::string data;
+          while (offset < KeySize) {
+            char byte = static_cast<char>(next());
+            if (byte == 0) {
+              // an escaped 0, or the terminating 0 0
+              if (next() == 0) {
+                break;
+              }
+            }
+            data.push_back(byte);
+          }
+          values->push_back(Value(TypeId::VARCHAR, data));
+          break;
+        }
+        default:
+          throw NotImplementedException("cannot normalize index keys of this type");
+      }
+    }
+    return offset;
+  }
+
+  /**
+   * @return the size in bytes of the longest normalized encoding of the columns [begin, end) of schema, taking strings
+   * to be at most as long as their column
+   */
+  static size_t MaxEncodedSize(const Schema *schema, uint32_t begin, uint32_t end) {
+    size_t size = 0;
+    for (uint32_t i = begin; i < end; i++) {
+      const Column &column = schema->GetColumn(i);
+      // a string may escape every byte
+      size += column.GetType() == TypeId::VARCHAR ? 3 + 2 * column.GetLength() : Type::GetTypeSize(column.GetType());
+    }
+    return size;
+  }
+
+  /**
+   * Write rid big-endian at byte offset of a normalized key, into its last 8 bytes by default, so that the entries of
+   * equal keys order by their RID.
+   */
+  inline void SetRidSuffix(const RID &rid, size_t offset = KeySize - sizeof(uint64_t)) {
+    uint64_t bits = static_cast<uint64_t>(static_cast<uint32_t>(rid.GetPageId())) << 32 | rid.GetSlotNum();
+    for (size_t i = 0; i < sizeof(bits) && offset + i < KeySize; i++) {
+      data_[offset + i] = static_cast<char>(bits >> ((sizeof(bits) - 1 - i) * 8));
+    }
+  }
+
+  /**
+   * Step the first size bytes of a normalized key to the least key above them, e.g. to turn an exclusive lower bound
+   * into an inclusive one.
+   * @return false if there is none, those bytes being all 0xff
+   */
+  inline bool StepUp(size_t size = KeySize) {
+    for (size_t i = size; i-- > 0;) {
+      if (static_cast<uint8_t>(data_[i]) != 0xff) {
+        data_[i]++;
+        return true;
+      }
+      data_[i] = 0;
+    }
+    return false;
+  }
+
+  /**
+   * Step the first size bytes of a normalized key to the greatest key below them.
+   * @return false if there is none, those bytes being all zero
+   */
+  inline bool StepDown(size_t size = KeySize) {
+    for (size_t i = size; i-- > 0;) {
+      if (data_[i] != 0) {
+        data_[i]--;
+        return true;
+      }
+      data_[i] = static_cast<char>(0xff);
+    }
+    return false;
+  }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
@@ -72,11 +297,32 @@ class GenericKey {
 
 /**
  * Function object returns true if lhs < rhs, used for trees
+ *
+ * Keys made up of integer columns only are compared straight from their bytes, without building a Value per column.
+ * Their NULLs, which are stored as the least value of the type, order before all other values.
+ *
+ * A normalized comparator compares keys set with their schema (see GenericKey::SetFromKey()) as a single memcmp, of
+ * their first compared_size bytes. The bytes after those are payload riding along with the key.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
+    if (normalized_) {
+      int order = memcmp(lhs.data_, rhs.data_, compared_size_);
+      return order < 0 ? -1 : (order > 0 ? 1 : 0);
+    }
+    if (!integer_columns_.empty()) {
+      for (const auto &[offset, width] : integer_columns_) {
+        int64_t lhs_value = ReadInteger(lhs.data_ + offset, width);
+        int64_t rhs_value = ReadInteger(rhs.data_ + offset, width);
+        if (lhs_value != rhs_value) {
+          return lhs_value < rhs_value ? -1 : 1;
+        }
+      }
+      return 0;
+    }
+
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -94,13 +340,89 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_},
+        normalized_{other.normalized_},
+        compared_size_{other.compared_size_},
+        integer_columns_{other.integer_columns_} {}
+
+  // constructor, normalized if the keys are set with their schema
+  explicit GenericComparator(Schema *key_schema, bool normalized = false, size_t compared_size = KeySize)
+      : key_schema_(key_schema), normalized_(normalized), compared_size_(std::min(compared_size, KeySize)) {
+    if (normalized_) {
+      return;
+    }
+    for (const Column &column : key_schema_->GetColumns()) {
+      int width = IntegerWidth(column.GetType());
+      if (width == 0) {
+        integer_columns_.clear();
+        break;
+      }
+      integer_columns_.emplace_back(column.GetOffset(), width);
+    }
+  }
+
+  /** @return the schema of the keys being compared */
+  Schema *GetKeySchema() const { return key_schema_; }
+
+  /** @return true if the keys are normalized, and order as their bytes */
+  bool IsNormalized() const { return normalized_; }
 
-  // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  /** @return how many bytes of a normalized key are compared */
+  size_t ComparedSize() const { return compared_size_; }
+
+  /**
+   * @return the width in bytes of the integer the keys consist of, at their start, or 0 if they are anything else. The
+   * keys order as those integers read with ReadInteger()
+   */
+  int IntegerKeyWidth() const {
+    return integer_columns_.size() == 1 && integer_columns_[0].first == 0 ? integer_columns_[0].second : 0;
+  }
+
+  /** @return the signed integer of width bytes (1, 2, 4 or 8) at data */
+  static inline int64_t ReadInteger(const char *data, int width) {
+    switch (width) {
+      case 1:
+        return *reinterpret_cast<const int8_t *>(data);
+      case 2: {
+        int16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+      }
+      case 4: {
+        int32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+      }
+      default: {
+        int64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+      }
+    }
+  }
 
  private:
+  static int IntegerWidth(TypeId type) {
+    switch (type) {
+      case TypeId::TINYINT:
+        return 1;
+      case TypeId::SMALLINT:
+        return 2;
+      case TypeId::INTEGER:
+        return 4;
+      case TypeId::BIGINT:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
   Schema *key_schema_;
+  bool normalized_;
+  size_t compared_size_;
+  // offset and width of every column, if all are integers
+  std::vector<std::pair<uint32_t, int>> integer_columns_;
 };
 
 }  // namespace bustub
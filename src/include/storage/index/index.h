@@ -12,12 +12,14 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -43,14 +45,26 @@ class IndexMetadata {
    * @param table_name The name of the table on which the index is created
    * @param tuple_schema The schema of the indexed key
    * @param key_attrs The mapping from indexed columns to base table columns
+   * @param is_unique Whether a key may have a single RID only
+   * @param included_attrs The base table columns the index stores along with the key, without indexing them
    */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, bool is_unique = true, std::vector<uint32_t> included_attrs = {})
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_attrs_(std::move(key_attrs)),
+        is_unique_(is_unique),
+        included_attrs_(std::move(included_attrs)) {
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
+    covered_attrs_ = key_attrs_;
+    covered_attrs_.insert(covered_attrs_.end(), included_attrs_.begin(), included_attrs_.end());
+    covered_schema_ = Schema::CopySchema(tuple_schema, covered_attrs_);
   }
 
-  ~IndexMetadata() { delete key_schema_; }
+  ~IndexMetadata() {
+    delete key_schema_;
+    delete covered_schema_;
+  }
 
   /** @return The name of the index */
   inline const std::string &GetName() const { return name_; }
@@ -72,6 +86,18 @@ class IndexMetadata {
   /** @return The mapping relation between indexed columns and base table columns */
   inline const std::vector<uint32_t> &GetKeyAttrs() const { return key_attrs_; }
 
+  /** @return true if a key may have a single RID only, false if the index holds duplicate keys */
+  inline bool IsUnique() const { return is_unique_; }
+
+  /** @return The base table columns stored along with the key */
+  inline const std::vector<uint32_t> &GetIncludedAttrs() const { return included_attrs_; }
+
+  /** @return The base table columns of an index entry: the key columns, then the included ones */
+  inline const std::vector<uint32_t> &GetCoveredAttrs() const { return covered_attrs_; }
+
+  /** @return A schema object pointer that represents an index entry, see GetCoveredAttrs() */
+  inline Schema *GetCoveredSchema() const { return covered_schema_; }
+
   /** @return A string representation for debugging */
   std::string ToString() const {
     std::stringstream os;
@@ -92,8 +118,45 @@ class IndexMetadata {
   std::string table_name_;
   /** The mapping relation between key schema and tuple schema */
   const std::vector<uint32_t> key_attrs_;
+  /** Whether a key may have a single RID only */
+  const bool is_unique_;
+  /** The base table columns stored along with the key */
+  const std::vector<uint32_t> included_attrs_;
+  /** The key columns followed by the included ones */
+  std::vector<uint32_t> covered_attrs_;
   /** The schema of the indexed key */
   Schema *key_schema_;
+  /** The schema of an index entry */
+  Schema *covered_schema_;
+};
+
+/**
+ * class IndexRangeScan - A scan of the keys in a range, see Index::ScanRange().
+ *
+ * The scan hands out the RIDs of the keys in key order, in batches as the index
+ * stores them together, e.g. one leaf at a time.
+ */
+class IndexRangeScan {
+ public:
+  virtual ~IndexRangeScan() = default;
+
+  /**
+   * Fetch the next batch of RIDs.
+   * @param[out] rids Replaced with the next batch, which is never empty
+   * @return `false` if the scan is over, and rids empty
+   */
+  virtual bool NextBatch(std::vector<RID> *rids) = 0;
+
+  /**
+   * Fetch the next batch of RIDs along with their entries, as the index stores them, for an index that stores its
+   * covered columns (see Index::StoresCoveredColumns()).
+   * @param[out] rids Replaced with the next batch, which is never empty
+   * @param[out] entries Replaced with the entries of rids, tuples of the covered schema
+   * @return `false` if the scan is over, and rids empty
+   */
+  virtual bool NextEntries(std::vector<RID> *rids, std::vector<Tuple> *entries) {
+    throw NotImplementedException("this index does not store its entries");
+  }
 };
 
 /////////////////////////////////////////////////////////////////////
@@ -139,6 +202,24 @@ class Index {
   /** @return The index key attributes */
   const std::vector<uint32_t> &GetKeyAttrs() const { return metadata_->GetKeyAttrs(); }
 
+  /** @return The schema of an index entry, the key columns followed by the included ones */
+  Schema *GetCoveredSchema() const { return metadata_->GetCoveredSchema(); }
+
+  /** @return The base table columns of an index entry */
+  const std::vector<uint32_t> &GetCoveredAttrs() const { return metadata_->GetCoveredAttrs(); }
+
+  /**
+   * @return true if the index stores the whole of its entries, so that its range scans can hand them out (see
+   * IndexRangeScan::NextEntries()) and queries that only need covered columns can skip the table heap
+   */
+  virtual bool StoresCoveredColumns() const { return false; }
+
+  /**
+   * @return true if transactions take key-range locks on the index, so that REPEATABLE_READ reads of it see neither
+   * phantoms nor uncommitted entries
+   */
+  virtual bool TakesKeyLocks() const { return false; }
+
   /** @return A string representation for debugging */
   std::string ToString() const {
     std::stringstream os;
@@ -153,7 +234,7 @@ class Index {
 
   /**
    * Insert an entry into the index.
-   * @param key The index key
+   * @param key The index entry, a tuple of the covered schema: the key columns, then the included ones
    * @param rid The RID associated with the key (unused)
    * @param transaction The transaction context
    */
@@ -161,7 +242,7 @@ class Index {
 
   /**
    * Delete an index entry by key.
-   * @param key The index key
+   * @param key The index entry, a tuple of the covered schema
    * @param rid The RID associated with the key (unused)
    * @param transaction The transaction context
    */
@@ -175,6 +256,61 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Scan the keys between two bounds, in key order. Ordered indexes override this; the others can only scan a range
+   * holding a single key, and throw for any other.
+   * @param low The least key of the range, nullptr for no lower bound
+   * @param low_inclusive Whether low itself is in the range
+   * @param high The greatest key of the range, nullptr for no upper bound
+   * @param high_inclusive Whether high itself is in the range
+   * @param transaction The transaction context
+   * @return The scan, which hands out the RIDs of the keys in the range
+   */
+  virtual std::unique_ptr<IndexRangeScan> ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+                                                    bool high_inclusive, Transaction *transaction) {
+    bool single_key = low != nullptr && high != nullptr && low_inclusive && high_inclusive;
+    for (uint32_t i = 0; single_key && i < GetIndexColumnCount(); i++) {
+      Value low_value = low->GetValue(GetKeySchema(), i);
+      single_key = low_value.CompareEquals(high->GetValue(GetKeySchema(), i)) == CmpBool::CmpTrue;
+    }
+    if (!single_key) {
+      throw NotImplementedException("this index cannot scan a range of keys");
+    }
+
+    /** All RIDs of a single key, in one batch. */
+    class KeyScan : public IndexRangeScan {
+     public:
+      bool NextBatch(std::vector<RID> *rids) override {
+        rids->swap(rids_);
+        rids_.clear();
+        return !rids->empty();
+      }
+
+      std::vector<RID> rids_;
+    };
+    auto scan = std::make_unique<KeyScan>();
+    ScanKey(*low, &scan->rids_, transaction);
+    return scan;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Bulk Modification
+  ///////////////////////////////////////////////////////////////////
+
+  /**
+   * Fill a new index with many entries at once, e.g. those of the table it is created on. Indexes that can build
+   * themselves faster from all entries at hand override this; by default every entry is inserted on its own.
+   * @param next Yields the next entry, a tuple of the covered schema, and RID, and returns false when there are no more
+   * @param transaction The transaction context
+   */
+  virtual void BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) {
+    Tuple key;
+    RID rid;
+    while (next(&key, &rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
@@ -13,6 +13,12 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <functional>
+#include <future>  // NOLINT
+#include <vector>
+
+#include "common/epoch_reclaimer.h"
+#include "common/macros.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
@@ -21,23 +27,89 @@ namespace bustub {
 
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = B_PLUS_TREE_LEAF_PAGE_TYPE;
+
  public:
-  // you may define your own constructor based on your member variables
-  IndexIterator();
+  /** Finds the leaf page key belongs to, or the leftmost one for nullptr, and returns it pinned only. */
+  using Seek = std::function<Page *(const KeyType *key)>;
+
+  /**
+   * Iterate over the entries from bound on, or over all of them if bound is nullptr, or over nothing if seek is
+   * nullptr. The iterator holds a pin on the current leaf but takes no latches: each entry is copied out
+   * optimistically, and copied again if a writer latched the leaf meanwhile. It keeps its place by key rather than by
+   * slot, and uses the fence keys of the leaves to notice entries moving past it, going back to seek then. So it sees
+   * every entry that is in the tree for the whole scan, once and in order, but it is no consistent snapshot. Moving on
+   * to the right sibling of a leaf runs under a guard of reclaimer, which keeps the sibling from being deleted until it
+   * is pinned.
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, EpochReclaimer<page_id_t> *reclaimer,
+                const KeyComparator &comparator, Seek seek, const KeyType *bound);
+  IndexIterator(IndexIterator &&other) noexcept;
   ~IndexIterator();
 
+  DISALLOW_COPY(IndexIterator);
+
   bool IsEnd();
 
   const MappingType &operator*();
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  /**
+   * Copy the current entry and those after it on the same leaf into batch, up to high (inclusive) unless it is nullptr,
+   * and stay on the last one copied. The leaf is read at once rather than entry by entry, unless a writer changed it
+   * since the current entry was read. Unless the batch ends at high, the next leaf is fetched in the background while
+   * the caller works through the batch, for operator++ to move on to.
+   * @return false if the batch ended at high, so that the entries after it are past the range
+   */
+  bool ReadLeafBatch(std::vector<MappingType> *batch, const KeyType *high);
+
+  bool operator==(const IndexIterator &itr) const {
+    return page_ == itr.page_ && (page_ == nullptr || index_ == itr.index_);
+  }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /** Move on to the first entry past bound_, on the current leaf or the ones to its right. */
+  void SkipToNextEntry();
+
+  /** @return the slot of the first entry past bound_ on the current leaf */
+  int FirstIndexPastBound() const;
+
+  /** @return the leaf page_id pinned, the one prefetched if it is that */
+  Page *FetchLeaf(page_id_t page_id);
+
+  /** Wait for the page being prefetched, if any, and unpin it. */
+  void DropPrefetch();
+
+  /** No version of a page the iterator read from, those are even. */
+  static constexpr uint64_t NO_VERSION = 1;
+
+  BufferPoolManager *buffer_pool_manager_;
+  EpochReclaimer<page_id_t> *reclaimer_;
+  KeyComparator comparator_;
+  Seek seek_;
+  Page *page_;
+  LeafPage *leaf_;
+  /** The slot item_ was read from, at version_ of the leaf. */
+  int index_{0};
+  uint64_t version_{NO_VERSION};
+  /** The entry the iterator is on. */
+  MappingType item_;
+  /** Entries up to bound_ (inclusive_: exclusive of it) have been passed; none without has_bound_. */
+  KeyType bound_;
+  bool has_bound_;
+  bool inclusive_;
+  /**
+   * The current leaf may only be read while its low key is at most floor_ (or it has none), or entries past bound_ may
+   * have moved to its left. No floor means the leaf must be the leftmost one.
+   */
+  KeyType floor_;
+  bool has_floor_;
+  /** The right sibling of the current leaf being fetched by ReadLeafBatch(), if prefetch_ is valid. */
+  std::future<Page *> prefetch_;
+  page_id_t prefetch_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_key_layout.h
+//
+// Identification: src/include/storage/index/index_key_layout.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+/**
+ * How an ordered index lays out its entries in normalized keys (see GenericKey::SetFromKey()), which it compares as
+ * bytes:
+ *  --------------------------------------------------
+ * | key columns | RID (unless unique) | included columns |
+ *  --------------------------------------------------
+ * An index that is not unique (see IndexMetadata::IsUnique()) ends every key with its RID, which orders the entries of
+ * a key by RID next to each other and makes them unique. The included columns (see IndexMetadata::GetIncludedAttrs())
+ * follow as payload that is not compared: ComparedSize() is where they start. With included columns the key columns
+ * take the room of their longest encoding, so that they are never cut short.
+ */
+template <typename KeyType>
+class IndexKeyLayout {
+ public:
+  explicit IndexKeyLayout(const IndexMetadata *metadata)
+      : metadata_(metadata),
+        key_size_(metadata->GetIncludedAttrs().empty()
+                      ? sizeof(KeyType) - (metadata->IsUnique() ? 0 : sizeof(RID))
+                      : KeyType::MaxEncodedSize(metadata->GetKeySchema(), 0, metadata->GetIndexColumnCount())),
+        included_offset_(key_size_ + (metadata->IsUnique() ? 0 : sizeof(RID))),
+        covering_(KeyType::MaxEncodedSize(metadata->GetKeySchema(), 0, metadata->GetIndexColumnCount()) <= key_size_) {
+    if (!metadata->IsUnique() && sizeof(KeyType) <= sizeof(RID)) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "the keys of an index that is not unique need room for a RID");
+    }
+    Schema *covered_schema = metadata->GetCoveredSchema();
+    if (included_offset_ + KeyType::MaxEncodedSize(covered_schema, metadata->GetIndexColumnCount(),
+                                                   covered_schema->GetColumnCount()) > sizeof(KeyType)) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "the included columns of the index do not fit in its keys");
+    }
+  }
+
+  /** @return how many bytes of a key are compared, those before the included columns */
+  size_t ComparedSize() const { return included_offset_; }
+
+  /** @return true if the entries fit in the keys whole, so that EntryTuple() gives them back */
+  bool IsCovering() const { return covering_; }
+
+  /** Set index_key to the key columns of entry, then rid unless the index is unique, then its included columns. */
+  void SetIndexKey(KeyType *index_key, const Tuple &entry, const RID &rid) const {
+    Schema *covered_schema = metadata_->GetCoveredSchema();
+    uint32_t key_count = metadata_->GetIndexColumnCount();
+    memset(static_cast<void *>(index_key), 0, sizeof(KeyType));
+    index_key->EncodeColumns(entry, covered_schema, 0, key_count, 0, key_size_);
+    if (!metadata_->IsUnique()) {
+      index_key->SetRidSuffix(rid, key_size_);
+    }
+    index_key->EncodeColumns(entry, covered_schema, key_count, covered_schema->GetColumnCount(), included_offset_,
+                             sizeof(KeyType));
+  }
+
+  /**
+   * Set key to the inclusive form of a range bound, a tuple of the key schema, or to the least or greatest key there is
+   * for nullptr.
+   * @return false if there is no such key, and the range is empty
+   */
+  bool RangeBound(KeyType *key, const Tuple *bound, bool inclusive, bool upper) const {
+    if (bound == nullptr) {
+      memset(static_cast<void *>(key), upper ? 0xff : 0, sizeof(KeyType));
+      return true;
+    }
+    // the compared bytes past the key columns, e.g. its RID, are the least or greatest there are: an inclusive bound
+    // takes in every entry of its key, an exclusive one none
+    memset(static_cast<void *>(key), inclusive == upper ? 0xff : 0, sizeof(KeyType));
+    key->EncodeColumns(*bound, metadata_->GetKeySchema(), 0, metadata_->GetIndexColumnCount(), 0, key_size_);
+    if (inclusive) {
+      return true;
+    }
+    return upper ? key->StepDown(included_offset_) : key->StepUp(included_offset_);
+  }
+
+  /** @return the entry of an index key, a tuple of the covered schema */
+  Tuple EntryTuple(const KeyType &key) const {
+    Schema *covered_schema = metadata_->GetCoveredSchema();
+    uint32_t key_count = metadata_->GetIndexColumnCount();
+    std::vector<Value> values;
+    key.DecodeColumns(covered_schema, 0, key_count, 0, &values);
+    key.DecodeColumns(covered_schema, key_count, covered_schema->GetColumnCount(), included_offset_, &values);
+    return Tuple(values, covered_schema);
+  }
+
+ private:
+  const IndexMetadata *metadata_;
+  /** How many bytes of a key the key columns take. */
+  size_t key_size_;
+  /** Where the included columns start, past the key and its RID. */
+  size_t included_offset_;
+  bool covering_;
+};
+
+}  // namespace bustub
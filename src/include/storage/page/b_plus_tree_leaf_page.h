@@ -18,8 +18,9 @@
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_HEADER_SIZE 40
+// twice what fits uncompressed, less two: the halves of a split plus the new entry always fit
+#define LEAF_PAGE_SIZE (2 * BPlusTreePage::UncompressedCapacity<KeyType, ValueType>() - 2)
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
@@ -27,17 +28,24 @@ namespace bustub {
  * page. Only support unique key.
  *
  * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ *  ----------------------------------------------------------------------------------------------------
+ * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n) | ... | TEMPLATE | LOW | HIGH |
+ *  ----------------------------------------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 36 bytes in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ----------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | HasLowKey (4) |
+ *  ----------------------------------------------------------------
+ *  ----------------------------------------
+ * | KeyPrefixSize (2) | KeySuffixSize (2) |
+ *  ----------------------------------------
+ *
+ *  Each KEY is stored without the prefix and suffix that TEMPLATE holds for
+ *  all keys of the page. LOW and HIGH are the fence keys of the page, see
+ *  BPlusTreePage.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -46,14 +54,17 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   // method to set default values
   void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE);
   // helper methods
-  page_id_t GetNextPageId() const;
-  void SetNextPageId(page_id_t next_page_id);
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  MappingType GetItem(int index) const;
+  const char *EntryData(int index) const;
+  int EntrySize() const;
+  bool HasRoomFor(const KeyType &key) const;
+  bool HasRoomForAllOf(const BPlusTreeLeafPage *other) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
+  void Append(const KeyType &key, const ValueType &value);
   bool Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const;
   int RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator);
 
@@ -64,10 +75,8 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
+  void CopyNFrom(const BPlusTreeLeafPage *source, int begin, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
-  page_id_t next_page_id_;
-  MappingType array_[0];
 };
 }  // namespace bustub
@@ -10,10 +10,14 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/index/generic_key.h"
@@ -33,17 +37,36 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 24 bytes in total):
+ * Header format (size in byte, 40 bytes in total):
  * ----------------------------------------------------------------------------
- * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ * | PageType (4) | LSN (8) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | NextPageId (4) | HasLowKey (4) |
  * ----------------------------------------------------------------------------
+ * | KeyPrefixSize (2) | KeySuffixSize (2) |
+ * ----------------------------------------------------------------------------
+ *
+ * Every page links to its right sibling on the same level (B-link), and the two
+ * fence keys at the very end of the page bound the keys it is responsible for:
+ * LowKey <= K < HighKey. The leftmost page of a level has no low key, the
+ * rightmost one no high key (and no right sibling). Readers that traverse the
+ * tree without latches use them to notice that a page split or shrank since
+ * its parent was read.
+ *
+ * Keys are stored compressed: the bytes at the start (prefix) and at the end
+ * (suffix) that all keys of the page have in common are kept only once, in the
+ * key template in front of the fence keys, and each entry holds the remaining
+ * middle of its key followed by its value. The entries are packed right after
+ * the header, so how many fit depends on how well the keys compress; max size
+ * only caps their number. Writers widen the stored middle when a key that
+ * does not share the template's bytes comes in, and recompute the template
+ * when a page is rebuilt by a split or merge.
  */
 class BPlusTreePage {
  public:
   bool IsLeafPage() const;
   bool IsRootPage() const;
+  IndexPageType GetPageType() const;
   void SetPageType(IndexPageType page_type);
 
   int GetSize() const;
@@ -62,14 +85,364 @@ class BPlusTreePage {
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  int GetKeyPrefixSize() const;
+  int GetKeySuffixSize() const;
+
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+
+  bool HasLowKey() const;
+  void SetHasLowKey(bool has_low_key);
+
+  template <typename KeyType>
+  const KeyType &LowKey() const {
+    return *reinterpret_cast<const KeyType *>(reinterpret_cast<const char *>(this) + PAGE_SIZE - 2 * sizeof(KeyType));
+  }
+  template <typename KeyType>
+  void SetLowKey(const KeyType &key) {
+    memcpy(reinterpret_cast<char *>(this) + PAGE_SIZE - 2 * sizeof(KeyType), &key, sizeof(KeyType));
+  }
+
+  // only meaningful while the page has a right sibling
+  template <typename KeyType>
+  const KeyType &HighKey() const {
+    return *reinterpret_cast<const KeyType *>(reinterpret_cast<const char *>(this) + PAGE_SIZE - sizeof(KeyType));
+  }
+  template <typename KeyType>
+  void SetHighKey(const KeyType &key) {
+    memcpy(reinterpret_cast<char *>(this) + PAGE_SIZE - sizeof(KeyType), &key, sizeof(KeyType));
+  }
+
+  // the bytes of the key prefix and suffix, in front of the fence keys
+  template <typename KeyType>
+  const KeyType &KeyTemplate() const {
+    return *reinterpret_cast<const KeyType *>(reinterpret_cast<const char *>(this) + PAGE_SIZE - 3 * sizeof(KeyType));
+  }
+
+  /** @return the number of entries that fit into a page whatever their keys, i.e. with nothing to compress */
+  template <typename KeyType, typename ValueType>
+  static constexpr int UncompressedCapacity() {
+    return (PAGE_SIZE - HEADER_SIZE - 3 * sizeof(KeyType)) / (sizeof(KeyType) + sizeof(ValueType));
+  }
+
+ protected:
+  static constexpr int HEADER_SIZE = 40;
+
+  void SetKeyTemplate(const char *key, int key_size) {
+    memcpy(reinterpret_cast<char *>(this) + PAGE_SIZE - 3 * key_size, key, key_size);
+  }
+
+  /*
+   * The entries, packed without gaps. Internal pages do not compress the key
+   * of their first entry, which is not used
+   */
+  int FirstKeyIndex() const { return IsLeafPage() ? 0 : 1; }
+
+  template <typename KeyType, typename ValueType>
+  int SlotSize() const {
+    // clamped, as readers without latches may see the sizes while they change
+    int prefix = std::min<int>(key_prefix_size_, sizeof(KeyType));
+    int suffix = std::min<int>(key_suffix_size_, sizeof(KeyType) - prefix);
+    return static_cast<int>(sizeof(KeyType)) - prefix - suffix + sizeof(ValueType);
+  }
+
+  template <typename KeyType, typename ValueType>
+  const char *SlotData(int index) const {
+    int slot_size = SlotSize<KeyType, ValueType>();
+    // a reader without latches may see a size from before the entries were rewritten, stay within the page
+    int capacity = (PAGE_SIZE - HEADER_SIZE - 3 * static_cast<int>(sizeof(KeyType))) / slot_size;
+    return entries_ + std::min(index, capacity - 1) * slot_size;
+  }
+
+  template <typename KeyType, typename ValueType>
+  char *SlotData(int index) {
+    return const_cast<char *>(static_cast<const BPlusTreePage *>(this)->SlotData<KeyType, ValueType>(index));
+  }
+
+  template <typename KeyType, typename ValueType>
+  KeyType SlotKey(int index) const {
+    KeyType key = KeyTemplate<KeyType>();
+    int prefix = std::min<int>(key_prefix_size_, sizeof(KeyType));
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    memcpy(reinterpret_cast<char *>(&key) + prefix, SlotData<KeyType, ValueType>(index), key_size);
+    return key;
+  }
+
+  // the first size bytes of the key at index, without decoding all of it
+  template <typename KeyType, typename ValueType>
+  void SlotKeyHead(int index, char *head, int size) const {
+    int prefix = std::min<int>(key_prefix_size_, sizeof(KeyType));
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    memcpy(head, &KeyTemplate<KeyType>(), size);
+    if (prefix < size) {
+      memcpy(head + prefix, SlotData<KeyType, ValueType>(index), std::min(size, prefix + key_size) - prefix);
+    }
+  }
+
+  /*
+   * The first index in [begin, end) whose key is not less than key, or with
+   * upper not greater either, for keys that order as the integers of width
+   * bytes at their start (see GenericComparator::IntegerKeyWidth()). The
+   * binary search does not branch on the keys, the compiler turns the choice
+   * of half into a conditional move
+   */
+  template <typename KeyType, typename ValueType, typename KeyComparator>
+  int IntegerKeyBound(int begin, int end, const KeyType &key, int width, bool upper) const {
+    if (begin >= end) {
+      return begin;
+    }
+    int64_t target = KeyComparator::ReadInteger(reinterpret_cast<const char *>(&key), width);
+    auto before = [&](int index) {
+      char head[sizeof(int64_t)];
+      SlotKeyHead<KeyType, ValueType>(index, head, width);
+      int64_t value = KeyComparator::ReadInteger(head, width);
+      return static_cast<int>(upper ? value <= target : value < target);
+    };
+    int base = begin;
+    int size = end - begin;
+    while (size > 1) {
+      int half = size / 2;
+      base += before(base + half) * half;
+      size -= half;
+    }
+    return base + before(base);
+  }
+
+  /*
+   * The same bound for normalized keys, whose first compared_size bytes order
+   * as they are (see GenericComparator::IsNormalized()). The key is compared
+   * with the prefix and suffix of the template once, so that each probe is a
+   * single memcmp of the slot bytes
+   */
+  template <typename KeyType, typename ValueType>
+  int NormalizedKeyBound(int begin, int end, const KeyType &key, int compared_size, bool upper) const {
+    if (begin >= end) {
+      return begin;
+    }
+    const char *target = reinterpret_cast<const char *>(&key);
+    const char *tmpl = reinterpret_cast<const char *>(&KeyTemplate<KeyType>());
+    int prefix = std::min<int>({key_prefix_size_, sizeof(KeyType), compared_size});
+    int order = memcmp(tmpl, target, prefix);
+    if (order != 0) {
+      // every key of the page shares the prefix, they all order the same way against key
+      return order > 0 ? begin : end;
+    }
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    int body = std::min(key_size, compared_size - prefix);
+    int tail = compared_size - prefix - body;
+    // how the suffix compares, for the slots whose bytes equal those of key
+    int tail_order = memcmp(tmpl + prefix + body, target + prefix + body, tail);
+    int limit = upper ? 1 : 0;
+    auto before = [&](int index) {
+      int slot_order = memcmp(SlotData<KeyType, ValueType>(index), target + prefix, body);
+      return static_cast<int>((slot_order != 0 ? slot_order : tail_order) < limit);
+    };
+    int base = begin;
+    int size = end - begin;
+    while (size > 1) {
+      int half = size / 2;
+      base += before(base + half) * half;
+      size -= half;
+    }
+    return base + before(base);
+  }
+
+  template <typename KeyType, typename ValueType>
+  ValueType SlotValue(int index) const {
+    ValueType value;
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    memcpy(reinterpret_cast<char *>(&value), SlotData<KeyType, ValueType>(index) + key_size, sizeof(ValueType));
+    return value;
+  }
+
+  // key must share the prefix and suffix of the page
+  template <typename KeyType, typename ValueType>
+  void WriteSlot(int index, const KeyType &key, const ValueType &value) {
+    char *data = SlotData<KeyType, ValueType>(index);
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    memcpy(data, reinterpret_cast<const char *>(&key) + key_prefix_size_, key_size);
+    memcpy(data + key_size, reinterpret_cast<const char *>(&value), sizeof(ValueType));
+  }
+
+  template <typename KeyType, typename ValueType>
+  void WriteSlotValue(int index, const ValueType &value) {
+    int key_size = SlotSize<KeyType, ValueType>() - static_cast<int>(sizeof(ValueType));
+    memcpy(SlotData<KeyType, ValueType>(index) + key_size, reinterpret_cast<const char *>(&value), sizeof(ValueType));
+  }
+
+  // shifts the entries from index on to make room, key must share the prefix and suffix of the page
+  template <typename KeyType, typename ValueType>
+  void InsertSlot(int index, const KeyType &key, const ValueType &value) {
+    int slot_size = SlotSize<KeyType, ValueType>();
+    memmove(entries_ + (index + 1) * slot_size, entries_ + index * slot_size, (size_ - index) * slot_size);
+    size_++;
+    WriteSlot(index, key, value);
+  }
+
+  template <typename KeyType, typename ValueType>
+  void RemoveSlots(int index, int count) {
+    int slot_size = SlotSize<KeyType, ValueType>();
+    memmove(entries_ + index * slot_size, entries_ + (index + count) * slot_size,
+            (size_ - index - count) * slot_size);
+    size_ -= count;
+  }
+
+  /*
+   * The prefix and suffix sizes the page would have with key among its keys:
+   * the bytes key shares with the template, or all of key if it would be the
+   * only one
+   */
+  template <typename KeyType>
+  std::pair<int, int> KeyAffixesWith(const KeyType &key) const {
+    if (size_ <= FirstKeyIndex()) {
+      return {sizeof(KeyType), 0};
+    }
+    int prefix = key_prefix_size_;
+    int suffix = key_suffix_size_;
+    ShareAffixes(reinterpret_cast<const char *>(&KeyTemplate<KeyType>()), reinterpret_cast<const char *>(&key),
+                 sizeof(KeyType), &prefix, &suffix);
+    return {prefix, suffix};
+  }
+
+  /** @return true if size entries fit into the page once key is among them */
+  template <typename KeyType, typename ValueType>
+  bool HasRoomForKey(const KeyType &key, int size) const {
+    auto [prefix, suffix] = KeyAffixesWith(key);
+    return HasRoomForSlots<KeyType, ValueType>(size, prefix, suffix);
+  }
+
+  /**
+   * @return true if the entries of other fit into the page besides its own, with key among them if given, as when
+   * merging other into the page
+   */
+  template <typename KeyType, typename ValueType>
+  bool HasRoomForPage(const BPlusTreePage *other, const KeyType *key) const {
+    const char *tmpl = nullptr;
+    int prefix = sizeof(KeyType);
+    int suffix = sizeof(KeyType);
+    auto add = [&](const char *bytes, int bytes_prefix, int bytes_suffix) {
+      prefix = std::min(prefix, bytes_prefix);
+      suffix = std::min(suffix, bytes_prefix == static_cast<int>(sizeof(KeyType)) ? bytes_prefix : bytes_suffix);
+      if (tmpl == nullptr) {
+        tmpl = bytes;
+      } else {
+        ShareAffixes(tmpl, bytes, sizeof(KeyType), &prefix, &suffix);
+      }
+    };
+    for (const BPlusTreePage *page : {this, other}) {
+      if (page->size_ > page->FirstKeyIndex()) {
+        add(reinterpret_cast<const char *>(&page->KeyTemplate<KeyType>()), page->key_prefix_size_,
+            page->key_suffix_size_);
+      }
+    }
+    if (key != nullptr) {
+      add(reinterpret_cast<const char *>(key), sizeof(KeyType), sizeof(KeyType));
+    }
+    if (prefix == static_cast<int>(sizeof(KeyType))) {
+      suffix = 0;
+    }
+    return HasRoomForSlots<KeyType, ValueType>(size_ + other->size_, prefix, suffix);
+  }
+
+  template <typename KeyType, typename ValueType>
+  bool HasRoomForSlots(int size, int prefix, int suffix) const {
+    size_t slot_size = sizeof(KeyType) - prefix - suffix + sizeof(ValueType);
+    return size <= max_size_ && static_cast<size_t>(size) * slot_size <= PAGE_SIZE - HEADER_SIZE - 3 * sizeof(KeyType);
+  }
+
+  /**
+   * Shrinks prefix and suffix to the bytes that a and b, of key_size bytes each, share at their start and end. A
+   * prefix of the whole key stands for a single key, all of whose bytes the suffix may share as well.
+   */
+  static void ShareAffixes(const char *a, const char *b, int key_size, int *prefix, int *suffix) {
+    if (*prefix == key_size) {
+      *suffix = key_size;
+    }
+    int shared = 0;
+    while (shared < *prefix && a[shared] == b[shared]) {
+      shared++;
+    }
+    *prefix = shared;
+    shared = 0;
+    while (shared < *suffix && a[key_size - 1 - shared] == b[key_size - 1 - shared]) {
+      shared++;
+    }
+    // equal keys are stored as prefix only
+    *suffix = *prefix == key_size ? 0 : shared;
+  }
+
+  /** Shrinks the prefix and suffix as far as needed for key to be stored, which must have room. */
+  template <typename KeyType, typename ValueType>
+  void IncludeKey(const KeyType &key) {
+    auto [prefix, suffix] = KeyAffixesWith(key);
+    if (size_ <= FirstKeyIndex()) {
+      // nothing to share with yet, key becomes the template
+      Reencode<KeyType, ValueType>(key, prefix, suffix);
+    } else if (prefix != key_prefix_size_ || suffix != key_suffix_size_) {
+      Reencode<KeyType, ValueType>(KeyTemplate<KeyType>(), prefix, suffix);
+    }
+  }
+
+  /** Grows the prefix and suffix as far as the keys of the page allow, e.g. after a split. */
+  template <typename KeyType, typename ValueType>
+  void CompactKeys() {
+    int first = FirstKeyIndex();
+    if (size_ <= first) {
+      return;
+    }
+    KeyType tmpl = SlotKey<KeyType, ValueType>(first);
+    int prefix = sizeof(KeyType);
+    int suffix = sizeof(KeyType);
+    for (int i = first + 1; i < size_ && prefix + suffix > 0; i++) {
+      KeyType key = SlotKey<KeyType, ValueType>(i);
+      ShareAffixes(reinterpret_cast<const char *>(&tmpl), reinterpret_cast<const char *>(&key), sizeof(KeyType),
+                   &prefix, &suffix);
+    }
+    // keys that all agree are stored as prefix only
+    if (prefix == static_cast<int>(sizeof(KeyType))) {
+      suffix = 0;
+    }
+    if (prefix != key_prefix_size_ || suffix != key_suffix_size_) {
+      Reencode<KeyType, ValueType>(tmpl, prefix, suffix);
+    }
+  }
+
+  /** Rewrites the entries for a new template and prefix and suffix sizes, which all keys must share. */
+  template <typename KeyType, typename ValueType>
+  void Reencode(const KeyType &tmpl, int prefix, int suffix) {
+    std::vector<std::pair<KeyType, ValueType>> entries;
+    entries.reserve(size_);
+    for (int i = 0; i < size_; i++) {
+      entries.emplace_back(SlotKey<KeyType, ValueType>(i), SlotValue<KeyType, ValueType>(i));
+    }
+    SetKeyTemplate(reinterpret_cast<const char *>(&tmpl), sizeof(KeyType));
+    key_prefix_size_ = prefix;
+    key_suffix_size_ = suffix;
+    for (int i = 0; i < size_; i++) {
+      WriteSlot(i, entries[i].first, entries[i].second);
+    }
+  }
+
+  void SetKeyAffixes(int prefix, int suffix) {
+    key_prefix_size_ = prefix;
+    key_suffix_size_ = suffix;
+  }
+
  private:
   // member variable, attributes that both internal and leaf page share
-  IndexPageType page_type_ __attribute__((__unused__));
-  lsn_t lsn_ __attribute__((__unused__));
-  int size_ __attribute__((__unused__));
-  int max_size_ __attribute__((__unused__));
-  page_id_t parent_page_id_ __attribute__((__unused__));
-  page_id_t page_id_ __attribute__((__unused__));
+  IndexPageType page_type_;
+  // unaligned where Page expects it, see Page::GetLSN()
+  char lsn_[sizeof(lsn_t)];
+  int size_;
+  int max_size_;
+  page_id_t parent_page_id_;
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int has_low_key_;
+  uint16_t key_prefix_size_;
+  uint16_t key_suffix_size_;
+  // the packed entries, see above
+  char entries_[0];
 };
 
 }  // namespace bustub
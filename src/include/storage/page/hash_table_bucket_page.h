@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "common/config.h"
+#include "recovery/index_log.h"
 #include "storage/index/int_comparator.h"
 #include "storage/page/hash_table_page_defs.h"
 
@@ -25,9 +26,9 @@ namespace bustub {
  * non-unique keys.
  *
  * Bucket page format (keys are stored in order):
- *  ----------------------------------------------------------------
- * | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
- *  ----------------------------------------------------------------
+ *  ----------------------------------------------------------------------------------
+ * | PageId (4) | LSN (8) | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
+ *  ----------------------------------------------------------------------------------
  *
  *  Here '+' means concatenation.
  *  The above format omits the space required for the occupied_ and
@@ -53,16 +54,18 @@ class HashTableBucketPage {
    *
    * @param key key to insert
    * @param value value to insert
+   * @param[out] slot if not null, the index the pair was stored at
    * @return true if inserted, false if duplicate KV pair or bucket is full
    */
-  bool Insert(KeyType key, ValueType value, KeyComparator cmp);
+  bool Insert(KeyType key, ValueType value, KeyComparator cmp, uint32_t *slot = nullptr);
 
   /**
    * Removes a key and value.
    *
+   * @param[out] slot if not null, the index the pair was removed from
    * @return true if removed, false if not found
    */
-  bool Remove(KeyType key, ValueType value, KeyComparator cmp);
+  bool Remove(KeyType key, ValueType value, KeyComparator cmp, uint32_t *slot = nullptr);
 
   /**
    * Gets the key at an index in the bucket.
@@ -80,11 +83,25 @@ class HashTableBucketPage {
    */
   ValueType ValueAt(uint32_t bucket_idx) const;
 
+  /**
+   * Store a KV pair at bucket_idx and mark the slot occupied and readable
+   */
+  void InsertAt(uint32_t bucket_idx, KeyType key, ValueType value);
+
   /**
    * Remove the KV pair at bucket_idx
    */
   void RemoveAt(uint32_t bucket_idx);
 
+  /**
+   * Log the slot at bucket_idx, i.e. its pair and its occupied and readable bits, as written to page.
+   *
+   * @param bucket_idx the index that was changed
+   * @param page the page holding this bucket
+   * @param log the log of the current operation
+   */
+  void LogSlot(uint32_t bucket_idx, Page *page, IndexLog *log) const;
+
   /**
    * Returns whether or not an index is occupied (key/value pair or tombstone)
    *
@@ -138,6 +155,9 @@ class HashTableBucketPage {
   void PrintBucket();
 
  private:
+  // the page id and LSN sit where Page expects them, so bucket changes can be logged
+  page_id_t page_id_ __attribute__((__unused__));
+  char lsn_[sizeof(lsn_t)] __attribute__((__unused__));
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
   char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
@@ -28,7 +28,7 @@ namespace bustub {
  *
  * Directory format (size in byte):
  * --------------------------------------------------------------------------------------------
- * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1524)
+ * | PageId(4) | LSN (8) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1520)
  * --------------------------------------------------------------------------------------------
  */
 class HashTableDirectoryPage {
@@ -188,7 +188,8 @@ class HashTableDirectoryPage {
 
  private:
   page_id_t page_id_;
-  lsn_t lsn_;
+  // unaligned where Page expects it, see Page::GetLSN()
+  char lsn_[sizeof(lsn_t)];
   uint32_t global_depth_{0};
   uint8_t local_depths_[DIRECTORY_ARRAY_SIZE];
   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];
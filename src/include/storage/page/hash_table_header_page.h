@@ -28,7 +28,7 @@ namespace bustub {
  *
  * Header format (size in byte, 16 bytes in total):
  * -------------------------------------------------------------
- * | LSN (4) | Size (4) | PageId(4) | NextBlockIndex(4)
+ * | LSN (8) | Size (4) | PageId(4) | NextBlockIndex(4)
  * -------------------------------------------------------------
  */
 class HashTableHeaderPage {
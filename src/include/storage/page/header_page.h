@@ -16,15 +16,19 @@
 
 namespace bustub {
 
+static constexpr int HEADER_RECORDS_OFFSET = 12;
+static constexpr int HEADER_RECORD_SIZE = 36;
+
 /**
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
- * 32 bytes) and their corresponding root_id
+ * 32 bytes) and their corresponding root_id. The LSN sits where Page expects it,
+ * since index root changes are logged against this page.
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------------
+ * | RecordCount (4) | LSN (8) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  ---------------------------------------------------------------------------
  */
 class HeaderPage : public Page {
  public:
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -48,29 +49,66 @@ class Page {
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline bool IsDirty() { return is_dirty_; }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  /** Acquire the page write latch. The version stays odd until the latch is released. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
 
+  /** Acquire the page read latch unless that means waiting. @return true if the latch was acquired */
+  inline bool TryRLatch() { return rwlatch_.TryRLock(); }
+
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
-  /** @return the page LSN. */
-  inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
+  /**
+   * Optimistic reads go without a latch: take the version, read the data, then Validate() the version. The data read
+   * may be torn by a writer, so it must not be acted upon before it validated. An odd version means the page is write
+   * latched right now and is not worth reading.
+   * @return the version of the page, bumped whenever its write latch is taken or released
+   */
+  inline uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
 
-  /** Sets the page LSN. */
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t)); }
+  /** @return true if the page was not write latched since GetVersion() returned version */
+  inline bool Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
+  /** @return the page LSN. */
+  inline lsn_t GetLSN() {
+    // the LSN follows a 4 byte field, so it is not aligned
+    lsn_t lsn;
+    memcpy(&lsn, GetData() + OFFSET_LSN, sizeof(lsn_t));
+    return lsn;
+  }
+
+  /** Sets the page LSN. The first LSN set after the page was last written out becomes its recLSN. */
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + OFFSET_LSN, &lsn, sizeof(lsn_t));
+    if (rec_lsn_ == INVALID_LSN) {
+      rec_lsn_ = lsn;
+    }
+  }
+
+  /** @return the LSN of the first log record that dirtied the page since it was last written out */
+  inline lsn_t GetRecLSN() { return rec_lsn_; }
 
  protected:
   static_assert(sizeof(page_id_t) == 4);
-  static_assert(sizeof(lsn_t) == 4);
+  static_assert(sizeof(lsn_t) == 8);
 
-  static constexpr size_t SIZE_PAGE_HEADER = 8;
+  static constexpr size_t SIZE_PAGE_HEADER = 12;
   static constexpr size_t OFFSET_PAGE_START = 0;
   static constexpr size_t OFFSET_LSN = 4;
 
@@ -86,8 +124,12 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** The recLSN for the dirty page table, reset by the buffer pool manager whenever the page is written out. */
+  lsn_t rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Version for optimistic readers, odd while the page is write latched. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
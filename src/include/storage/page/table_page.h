@@ -34,7 +34,7 @@ namespace bustub {
  *
  *  Header format (size in bytes):
  *  ----------------------------------------------------------------------------
- *  | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
+ *  | PageId (4)| LSN (8)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
  *  ----------------------------------------------------------------------------
  *  ----------------------------------------------------------------
  *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
@@ -73,81 +73,94 @@ class TablePage : public Page {
   }
 
   /**
-   * Insert a tuple into the table.
+   * Insert a tuple into the table. The caller locks the new tuple.
    * @param tuple tuple to insert
    * @param[out] rid rid of the inserted tuple
    * @param txn transaction performing the insert
-   * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @return true if the insert is successful (i.e. there is enough space)
    */
-  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LogManager *log_manager);
 
   /**
-   * Mark a tuple as deleted. This does not actually delete the tuple.
+   * Mark a tuple as deleted. This does not actually delete the tuple. The caller holds an exclusive lock on it.
    * @param rid rid of the tuple to mark as deleted
    * @param txn transaction performing the delete
-   * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
    */
-  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  bool MarkDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
   /**
-   * Update a tuple.
+   * Update a tuple. The caller holds an exclusive lock on it.
    * @param new_tuple new value of the tuple
    * @param[out] old_tuple old value of the tuple
    * @param rid rid of the tuple
    * @param txn transaction performing the update
-   * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @return true if updating the tuple succeeded
    */
   bool UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
-                   LockManager *lock_manager, LogManager *log_manager);
+                   LogManager *log_manager);
 
   /** To be called on commit or abort. Actually perform the delete or rollback an insert. */
   void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
+  /**
+   * To be called by recovery to undo an ApplyDelete: put the tuple back into the slot of rid, which ApplyDelete left
+   * empty. The tuple comes back marked deleted; undoing the MarkDelete or insert before the ApplyDelete then brings it
+   * back or removes it.
+   */
+  void RestoreTuple(const RID &rid, const Tuple &tuple);
+
   /** To be called on abort. Rollback a delete, i.e. this reverses a MarkDelete. */
   void RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
   /**
-   * Read a tuple from a table.
+   * Read a tuple from a table. The caller holds at least a shared lock on it, unless txn reads without locking.
    * @param rid rid of the tuple to read
    * @param[out] tuple the tuple that was read
    * @param txn transaction performing the read
-   * @param lock_manager the lock manager
    * @return true if the read is successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+
+  /**
+   * Copy out the tuple at rid without locking it, e.g. to save its image before it is changed.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the tuple that was read
+   * @return true if the slot holds a tuple that is not deleted
+   */
+  bool ReadTuple(const RID &rid, Tuple *tuple);
 
   /** @return the rid of the first tuple in this page */
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param all_slots also stop at deleted and empty slots, whose older versions a snapshot may still see
    * @return true if the first tuple exists, false otherwise
    */
-  bool GetFirstTupleRid(RID *first_rid);
+  bool GetFirstTupleRid(RID *first_rid, bool all_slots = false);
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param all_slots also stop at deleted and empty slots, whose older versions a snapshot may still see
    * @return true if the next tuple exists, false otherwise
    */
-  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool all_slots = false);
 
  private:
   static_assert(sizeof(page_id_t) == 4);
 
-  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 24;
+  static constexpr size_t SIZE_TABLE_PAGE_HEADER = 28;
   static constexpr size_t SIZE_TUPLE = 8;
-  static constexpr size_t OFFSET_PREV_PAGE_ID = 8;
-  static constexpr size_t OFFSET_NEXT_PAGE_ID = 12;
-  static constexpr size_t OFFSET_FREE_SPACE = 16;
-  static constexpr size_t OFFSET_TUPLE_COUNT = 20;
-  static constexpr size_t OFFSET_TUPLE_OFFSET = 24;  // Naming things is hard.
-  static constexpr size_t OFFSET_TUPLE_SIZE = 28;
+  static constexpr size_t OFFSET_PREV_PAGE_ID = 12;
+  static constexpr size_t OFFSET_NEXT_PAGE_ID = 16;
+  static constexpr size_t OFFSET_FREE_SPACE = 20;
+  static constexpr size_t OFFSET_TUPLE_COUNT = 24;
+  static constexpr size_t OFFSET_TUPLE_OFFSET = 28;  // Naming things is hard.
+  static constexpr size_t OFFSET_TUPLE_SIZE = 32;
 
   /** @return pointer to the end of the current free space, see header comment */
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
@@ -17,18 +17,27 @@
 #include "storage/page/table_page.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "storage/table/version_store.h"
 
 namespace bustub {
 
+class TransactionManager;
+
 /**
  * TableHeap represents a physical table on disk.
- * This is just a doubly-linked list of pages.
+ * This is just a doubly-linked list of pages. Older versions of recently written tuples are kept in a VersionStore
+ * for snapshot isolation transactions, which read through it without taking row locks.
+ *
+ * Rows are locked through LockManager::LockRow(), under intention locks on the table and page, so that a lock on the
+ * whole table, taken directly or by escalation, keeps other transactions from the rows.
  */
 class TableHeap {
   friend class TableIterator;
+  friend class TransactionManager;
 
  public:
-  ~TableHeap() = default;
+  /** Stops the transaction manager from sweeping the versions of this heap. */
+  ~TableHeap();
 
   /**
    * Create a table heap without a transaction. (open table)
@@ -36,9 +45,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param first_page_id the id of the first page
+   * @param oid the table stored in the heap, whose locks cover its rows
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            page_id_t first_page_id);
+            page_id_t first_page_id, table_oid_t oid = 0);
 
   /**
    * Create a table heap with a transaction. (create table)
@@ -46,9 +56,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param oid the table stored in the heap, whose locks cover its rows
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, table_oid_t oid = 0);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -108,11 +119,45 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /**
+   * Called on commit, before ApplyDelete. Makes the writes of txn to rid visible to snapshots taken from commit_ts on.
+   */
+  void CommitVersion(const RID &rid, Transaction *txn, timestamp_t commit_ts) { versions_.Commit(rid, txn, commit_ts); }
+
+  /** Called on abort, once every write of txn to rid has been rolled back. */
+  void AbortVersion(const RID &rid, Transaction *txn) { versions_.Abort(rid, txn); }
+
+  /**
+   * Drop the older versions no snapshot can see anymore.
+   * @param watermark the oldest read timestamp of any running snapshot transaction
+   */
+  void CollectGarbage(timestamp_t watermark) { versions_.CollectGarbage(watermark); }
+
+  /** @return the older versions of the tuples of this table */
+  inline VersionStore *GetVersionStore() { return &versions_; }
+
  private:
+  /**
+   * Checks that txn may write rid under snapshot isolation. Otherwise aborts txn, and unlatches and unpins page.
+   * @return true if the write may go ahead
+   */
+  bool CheckWrite(TablePage *page, const RID &rid, Transaction *txn);
+
+  /**
+   * Locks rid for txn in lock_mode, SHARED or EXCLUSIVE, unless it already holds such a lock. Rows are only locked
+   * while logging is on.
+   * @return false if txn may not go on
+   */
+  bool LockRow(const RID &rid, LockMode lock_mode, Transaction *txn);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  table_oid_t oid_;
+  VersionStore versions_;
+  /** The transaction manager sweeping versions_ once a commit left any, see TransactionManager::CollectGarbage(). */
+  TransactionManager *txn_manager_{nullptr};
 };
 
 }  // namespace bustub
@@ -56,6 +56,15 @@ class TableIterator {
   }
 
  private:
+  /** @return true if the scan reads versions without locking, and skips the slots without one visible to it */
+  bool ReadsVersions() const;
+
+  /**
+   * Moves to the next tuple on the pages, or to End().
+   * @return false if the tuple there is not visible to the transaction
+   */
+  bool Advance();
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
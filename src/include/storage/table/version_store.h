@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/storage/table/version_store.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of the tuples of one table heap for snapshot isolation.
+ *
+ * The table page always holds the newest image of a tuple, possibly written by a running transaction. The first write
+ * of a transaction to a tuple saves the image it replaces as a before-image in the tuple's version chain, stamped with
+ * the commit timestamps of the transaction that wrote it (begin) and of the one that replaced it (end). A snapshot
+ * reader uses the page image if it is committed at or before its read timestamp, and otherwise the newest
+ * before-image old enough for it. Chains only exist for recently written tuples: once no active snapshot needs a
+ * before-image, CollectGarbage() drops it.
+ */
+class VersionStore {
+ public:
+  /**
+   * Checks whether txn may write rid: no other running transaction has written it, and a snapshot transaction has
+   * not missed a newer committed version (first committer wins).
+   * @return false if the write conflicts
+   */
+  bool CanWrite(const RID &rid, Transaction *txn);
+
+  /**
+   * Records that txn is writing rid. The first write of txn saves the image it replaces.
+   * @param before the image of rid before the write, nullptr if rid held no tuple
+   */
+  void RecordWrite(const RID &rid, Transaction *txn, const Tuple *before);
+
+  /** Makes the writes of txn to rid visible to snapshots taken at or after commit_ts. */
+  void Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts);
+
+  /** Drops the before-image saved by txn for rid, once its writes to rid have been rolled back on the page. */
+  void Abort(const RID &rid, Transaction *txn);
+
+  /**
+   * Looks up the version of rid visible to the snapshot of txn, or the latest committed one for an optimistic txn.
+   * @param[out] tuple the visible version, if it is a before-image
+   * @param[out] exists whether a tuple is visible at all, if the answer comes from a before-image
+   * @return false if the page image is the visible one and should be read from the page instead
+   */
+  bool Read(const RID &rid, Transaction *txn, Tuple *tuple, bool *exists);
+
+  /**
+   * Drops the before-images that no snapshot at or after watermark can see, and the chains left with nothing to tell.
+   * @param watermark the oldest read timestamp of any running snapshot transaction
+   */
+  void CollectGarbage(timestamp_t watermark);
+
+  /** @return the number of before-images kept */
+  size_t VersionCount();
+
+ private:
+  /** A former image of a tuple. */
+  struct TupleVersion {
+    /** The image; meaningless if exists_ is false, i.e. the tuple was not inserted yet or already deleted. */
+    Tuple tuple_;
+    bool exists_;
+    /** Commit timestamp of the transaction that wrote the image. */
+    timestamp_t begin_ts_;
+    /** Commit timestamp of the transaction that replaced the image, INVALID_TS while it is running. */
+    timestamp_t end_ts_;
+  };
+
+  struct VersionChain {
+    /** The running transaction that wrote the page image, if any. */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** Commit timestamp of the page image once writer_ committed, 0 for images older than any snapshot. */
+    timestamp_t head_begin_ts_{0};
+    /** Before-images, newest first. */
+    std::deque<TupleVersion> versions_;
+  };
+
+  std::mutex latch_;
+  std::unordered_map<RID, VersionChain> chains_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,141 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_log.cpp
+//
+// Identification: src/recovery/index_log.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/index_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/header_page.h"
+
+namespace bustub {
+
+void IndexLog::Write(Page *page, const void *addr, size_t size) {
+  if (!IsEnabled()) {
+    return;
+  }
+  auto offset = static_cast<const char *>(addr) - page->GetData();
+  BUSTUB_ASSERT(offset >= 0 && offset + size <= PAGE_SIZE, "write must lie within the page");
+  AddOp(page, IndexPageOp{IndexPageOp::Kind::WRITE, page->GetPageId(), static_cast<int32_t>(offset),
+                          std::string(static_cast<const char *>(addr), size)});
+}
+
+void IndexLog::InsertEntry(Page *page, int slot, const void *entry, size_t entry_size) {
+  if (!IsEnabled()) {
+    return;
+  }
+  AddOp(page, IndexPageOp{IndexPageOp::Kind::INSERT_ENTRY, page->GetPageId(), slot,
+                          std::string(static_cast<const char *>(entry), entry_size)});
+}
+
+void IndexLog::DeleteEntry(Page *page, int slot, const void *entry, size_t entry_size) {
+  if (!IsEnabled()) {
+    return;
+  }
+  AddOp(page, IndexPageOp{IndexPageOp::Kind::DELETE_ENTRY, page->GetPageId(), slot,
+                          std::string(static_cast<const char *>(entry), entry_size)});
+}
+
+void IndexLog::SetParent(page_id_t page_id, page_id_t parent_id) {
+  if (!IsEnabled()) {
+    return;
+  }
+  // the parent page id follows the page type, LSN, size and max size in every B+ tree page header
+  ops_.push_back(IndexPageOp{IndexPageOp::Kind::WRITE, page_id, 3 * sizeof(int32_t) + sizeof(lsn_t),
+                             std::string(reinterpret_cast<const char *>(&parent_id), sizeof(page_id_t))});
+}
+
+void IndexLog::SetRoot(Page *header_page, const std::string &name, page_id_t root_id) {
+  if (!IsEnabled()) {
+    return;
+  }
+  AddOp(header_page, IndexPageOp{IndexPageOp::Kind::SET_ROOT, header_page->GetPageId(), root_id, name});
+}
+
+void IndexLog::SetEntry(IndexDescriptor index, std::string key, std::string value) {
+  if (!IsEnabled()) {
+    return;
+  }
+  index_ = std::move(index);
+  key_ = std::move(key);
+  value_ = std::move(value);
+}
+
+void IndexLog::Append(LogRecordType type) {
+  if (!IsEnabled() || ops_.empty()) {
+    return;
+  }
+  bool undoable = type == LogRecordType::INDEX_INSERT || type == LogRecordType::INDEX_DELETE;
+  Transaction *txn = undoable ? txn_ : nullptr;
+  LogRecord log_record(txn == nullptr ? INVALID_TXN_ID : txn->GetTransactionId(),
+                       txn == nullptr ? INVALID_LSN : txn->GetPrevLSN(), type,
+                       undoable ? std::move(index_) : IndexDescriptor{}, undoable ? std::move(key_) : std::string(),
+                       undoable ? std::move(value_) : std::string(), std::move(ops_));
+  BUSTUB_ASSERT(log_record.GetSize() <= LOG_BUFFER_SIZE, "index log record does not fit into the log buffer");
+  lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+  if (txn != nullptr) {
+    txn->SetPrevLSN(lsn);
+  }
+  for (Page *page : pages_) {
+    page->SetLSN(lsn);
+  }
+  index_ = IndexDescriptor{};
+  key_.clear();
+  value_.clear();
+  ops_.clear();
+  pages_.clear();
+}
+
+void IndexLog::AddOp(Page *page, IndexPageOp op) {
+  ops_.push_back(std::move(op));
+  if (std::find(pages_.begin(), pages_.end(), page) == pages_.end()) {
+    pages_.push_back(page);
+  }
+}
+
+void IndexLog::Redo(const IndexPageOp &op, Page *page) {
+  char *data = page->GetData();
+  switch (op.kind_) {
+    case IndexPageOp::Kind::WRITE:
+      memcpy(data + op.offset_, op.data_.data(), op.data_.size());
+      break;
+    case IndexPageOp::Kind::INSERT_ENTRY:
+    case IndexPageOp::Kind::DELETE_ENTRY: {
+      auto *node = reinterpret_cast<BPlusTreePage *>(data);
+      size_t entry_size = op.data_.size();
+      char *entries = data + (node->IsLeafPage() ? LEAF_PAGE_HEADER_SIZE : INTERNAL_PAGE_HEADER_SIZE);
+      char *slot = entries + op.offset_ * entry_size;
+      char *end = entries + node->GetSize() * entry_size;
+      if (op.kind_ == IndexPageOp::Kind::INSERT_ENTRY) {
+        memmove(slot + entry_size, slot, end - slot);
+        memcpy(slot, op.data_.data(), entry_size);
+        node->IncreaseSize(1);
+      } else {
+        memmove(slot, slot + entry_size, end - slot - entry_size);
+        node->IncreaseSize(-1);
+      }
+      break;
+    }
+    case IndexPageOp::Kind::SET_ROOT: {
+      auto *header_page = reinterpret_cast<HeaderPage *>(page);
+      if (!header_page->UpdateRecord(op.data_, op.offset_) && op.offset_ != INVALID_PAGE_ID) {
+        header_page->InsertRecord(op.data_, op.offset_);
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace bustub
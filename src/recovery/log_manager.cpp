@@ -12,6 +12,8 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +24,241 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (enable_logging) {
+    return;
+  }
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> latch(latch_);
+    while (enable_logging) {
+      cv_.wait_for(latch, log_timeout, [this] { return need_flush_ || !enable_logging; });
+      FlushLogBuffer(&latch);
+    }
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (!enable_logging) {
+    return;
+  }
+  {
+    std::scoped_lock latch(latch_);
+    enable_logging = false;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+}
+
+void LogManager::FlushLogBuffer(std::unique_lock<std::mutex> *latch) {
+  need_flush_ = false;
+  if (buffer_offset_ > 0) {
+    std::swap(log_buffer_, flush_buffer_);
+    int size = buffer_offset_;
+    lsn_t last_lsn = next_lsn_ - 1;
+    if (buffer_first_lsn_ != INVALID_LSN) {
+      block_offsets_.emplace_back(buffer_first_lsn_, log_offset_);
+      buffer_first_lsn_ = INVALID_LSN;
+    }
+    log_offset_ += size;
+    buffer_offset_ = 0;
+
+    // appends continue into the other buffer while this one is written
+    latch->unlock();
+    disk_manager_->WriteLog(flush_buffer_, size);
+    latch->lock();
+    persistent_lsn_ = last_lsn;
+  }
+  flushed_cv_.notify_all();
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
+ * The layout of each record type is described in log_record.h.
  *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * A record never straddles two log segments: if it does not fit into the rest
+ * of the current segment, that rest is zero-filled and readers continue at the
+ * next segment. Every segment starts with its segment number, followed by a
+ * record header.
+ */
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  // a larger record would wait forever for room in the buffer
+  BUSTUB_ASSERT(log_record->size_ + LOG_SEGMENT_HEADER_SIZE <= LOG_BUFFER_SIZE,
+                "log record does not fit into the log buffer");
+  std::unique_lock<std::mutex> latch(latch_);
+  auto padding = [this, log_record] {
+    int segment_left = LOG_SEGMENT_SIZE - (log_offset_ + buffer_offset_) % LOG_SEGMENT_SIZE;
+    return segment_left < log_record->size_ ? segment_left : 0;
+  };
+  auto segment_header = [this, &padding] {
+    return (log_offset_ + buffer_offset_ + padding()) % LOG_SEGMENT_SIZE == 0 ? LOG_SEGMENT_HEADER_SIZE : 0;
+  };
+  while (buffer_offset_ + padding() + segment_header() + log_record->size_ > LOG_BUFFER_SIZE) {
+    if (buffer_offset_ == 0) {
+      // the padding crowds the record out of an empty buffer, it is written out on its own
+      buffer_offset_ = padding();
+      memset(log_buffer_, 0, buffer_offset_);
+    }
+    need_flush_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(latch);
+  }
+  int padding_size = padding();
+  memset(log_buffer_ + buffer_offset_, 0, padding_size);
+  buffer_offset_ += padding_size;
+  if (segment_header() != 0) {
+    uint64_t segment_no = (log_offset_ + buffer_offset_) / LOG_SEGMENT_SIZE;
+    memcpy(log_buffer_ + buffer_offset_, &segment_no, LOG_SEGMENT_HEADER_SIZE);
+    buffer_offset_ += LOG_SEGMENT_HEADER_SIZE;
+  }
+
+  log_record->lsn_ = next_lsn_++;
+  if (buffer_first_lsn_ == INVALID_LSN) {
+    buffer_first_lsn_ = log_record->lsn_;
+  }
+
+  char *pos = log_buffer_ + buffer_offset_;
+  memcpy(pos, &log_record->size_, sizeof(int32_t));
+  memcpy(pos + 4, &log_record->lsn_, sizeof(lsn_t));
+  memcpy(pos + 12, &log_record->txn_id_, sizeof(txn_id_t));
+  memcpy(pos + 16, &log_record->prev_lsn_, sizeof(lsn_t));
+  memcpy(pos + 24, &log_record->log_record_type_, sizeof(LogRecordType));
+  pos += LogRecord::HEADER_SIZE;
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+    case LogRecordType::INDEX_SPLIT:
+    case LogRecordType::INDEX_MERGE:
+    case LogRecordType::INDEX_ROOT_CHANGE: {
+      auto write_int = [&pos](int32_t value) {
+        memcpy(pos, &value, sizeof(int32_t));
+        pos += sizeof(int32_t);
+      };
+      auto write_string = [&pos, &write_int](const std::string &str) {
+        write_int(static_cast<int32_t>(str.size()));
+        memcpy(pos, str.data(), str.size());
+        pos += str.size();
+      };
+      const IndexDescriptor &index = log_record->index_;
+      write_string(index.name_);
+      write_int(index.directory_page_id_);
+      write_int(index.normalized_keys_ ? 1 : 0);
+      write_int(index.compared_key_size_);
+      write_int(static_cast<int32_t>(index.key_types_.size()));
+      for (TypeId type : index.key_types_) {
+        *pos++ = static_cast<char>(type);
+      }
+      write_string(log_record->index_key_);
+      write_string(log_record->index_value_);
+      write_int(static_cast<int32_t>(log_record->index_ops_.size()));
+      for (const auto &op : log_record->index_ops_) {
+        write_int(static_cast<int32_t>(op.kind_));
+        write_int(op.page_id_);
+        write_int(op.offset_);
+        write_string(op.data_);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  buffer_offset_ += log_record->size_;
+  return log_record->lsn_;
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock<std::mutex> latch(latch_);
+  while (enable_logging && persistent_lsn_ < lsn) {
+    need_flush_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(latch);
+  }
+}
+
+/*
+ * Only the last segment holding records is read: appending resumes at a new
+ * segment after a restart. The records of a segment end where the LSNs stop
+ * going up one by one, past which lie zero padding, a torn write, or older
+ * records left in a recycled segment
+ */
+lsn_t LogManager::NextLSNAfterLog(DiskManager *disk_manager) {
+  size_t log_end = disk_manager->GetLogEndOffset();
+  size_t size = 0;
+  const char *data = log_end == 0 ? nullptr : disk_manager->MapLogSegment((log_end - 1) / LOG_SEGMENT_SIZE, &size);
+  if (data == nullptr) {
+    return 0;
+  }
+  lsn_t next_lsn = 0;
+  for (size_t pos = LOG_SEGMENT_HEADER_SIZE; pos + LogRecord::HEADER_SIZE <= size;) {
+    int32_t record_size = *reinterpret_cast<const int32_t *>(data + pos);
+    lsn_t lsn = *reinterpret_cast<const lsn_t *>(data + pos + 4);
+    if (record_size < LogRecord::HEADER_SIZE || pos + record_size > size ||
+        (pos != LOG_SEGMENT_HEADER_SIZE && lsn != next_lsn)) {
+      break;
+    }
+    next_lsn = lsn + 1;
+    pos += record_size;
+  }
+  disk_manager->UnmapLogSegment(data, size);
+  return next_lsn;
+}
+
+/*
+ * Translate the redo start LSN into a log offset for the master record. Once
+ * the master record is durable, the segments before that offset are released
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+void LogManager::WriteMasterRecord(lsn_t redo_start_lsn) {
+  size_t redo_offset;
+  {
+    std::scoped_lock latch(latch_);
+    // the last flushed block that starts at or before redo_start_lsn
+    auto block = std::upper_bound(block_offsets_.begin(), block_offsets_.end(), redo_start_lsn,
+                                  [](lsn_t lsn, const std::pair<lsn_t, size_t> &block) { return lsn < block.first; });
+    if (block == block_offsets_.begin()) {
+      // the record predates every known block, recovery has to read the whole log
+      disk_manager_->WriteMasterRecord(0);
+      return;
+    }
+    --block;
+    redo_offset = block->second;
+    if (!disk_manager_->WriteMasterRecord(redo_offset)) {
+      // recovery may still start at the old record, keep the log it needs
+      return;
+    }
+    // earlier blocks are never needed again, recLSNs and active transactions only move forward
+    block_offsets_.erase(block_offsets_.begin(), block);
+  }
+  disk_manager_->TruncateLog(redo_offset);
+}
 
 }  // namespace bustub
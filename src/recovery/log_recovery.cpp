@@ -12,6 +12,17 @@
 
 #include "recovery/log_recovery.h"
 
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_set>
+
+#include "common/exception.h"
+#include "container/hash/extendible_hash_table.h"
+#include "recovery/index_log.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +31,112 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  int32_t size = *reinterpret_cast<const int32_t *>(data);
+  auto type = *reinterpret_cast<const LogRecordType *>(data + 24);
+  if (size < LogRecord::HEADER_SIZE || type <= LogRecordType::INVALID || type > LogRecordType::INDEX_ROOT_CHANGE) {
+    return false;
+  }
+  log_record->size_ = size;
+  log_record->lsn_ = *reinterpret_cast<const lsn_t *>(data + 4);
+  log_record->txn_id_ = *reinterpret_cast<const txn_id_t *>(data + 12);
+  log_record->prev_lsn_ = *reinterpret_cast<const lsn_t *>(data + 16);
+  log_record->log_record_type_ = type;
+
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  switch (type) {
+    case LogRecordType::INSERT:
+      log_record->insert_rid_ = *reinterpret_cast<const RID *>(pos);
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      log_record->delete_rid_ = *reinterpret_cast<const RID *>(pos);
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      log_record->update_rid_ = *reinterpret_cast<const RID *>(pos);
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      log_record->prev_page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      log_record->page_id_ = *reinterpret_cast<const page_id_t *>(pos + sizeof(page_id_t));
+      break;
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+    case LogRecordType::INDEX_SPLIT:
+    case LogRecordType::INDEX_MERGE:
+    case LogRecordType::INDEX_ROOT_CHANGE: {
+      auto read_int = [&pos] {
+        int32_t value = *reinterpret_cast<const int32_t *>(pos);
+        pos += sizeof(int32_t);
+        return value;
+      };
+      auto read_string = [&pos, &read_int] {
+        int32_t length = read_int();
+        std::string str(pos, length);
+        pos += length;
+        return str;
+      };
+      IndexDescriptor &index = log_record->index_;
+      index.name_ = read_string();
+      index.directory_page_id_ = read_int();
+      index.normalized_keys_ = read_int() != 0;
+      index.compared_key_size_ = read_int();
+      index.key_types_.resize(read_int());
+      for (TypeId &key_type : index.key_types_) {
+        key_type = static_cast<TypeId>(*pos++);
+      }
+      log_record->index_key_ = read_string();
+      log_record->index_value_ = read_string();
+      log_record->index_ops_.resize(read_int());
+      for (IndexPageOp &op : log_record->index_ops_) {
+        op.kind_ = static_cast<IndexPageOp::Kind>(read_int());
+        op.page_id_ = read_int();
+        op.offset_ = read_int();
+        op.data_ = read_string();
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return true;
+}
+
+/*****************************************************************************
+ * REDO
+ *****************************************************************************/
+void LogRecovery::RedoQueue::Push(RedoTask task) {
+  {
+    std::scoped_lock latch(latch_);
+    tasks_.emplace_back(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+bool LogRecovery::RedoQueue::Pop(RedoTask *task) {
+  std::unique_lock latch(latch_);
+  cv_.wait(latch, [&] { return closed_ || !tasks_.empty(); });
+  if (tasks_.empty()) {
+    return false;
+  }
+  *task = std::move(tasks_.front());
+  tasks_.pop_front();
+  return true;
+}
+
+void LogRecovery::RedoQueue::Close() {
+  {
+    std::scoped_lock latch(latch_);
+    closed_ = true;
+  }
+  cv_.notify_all();
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -28,13 +144,399 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *
+ *The calling thread is the reader: it maps one segment at a time, parses the
+ *records in place (the kernel reads ahead for the sequential scan) and hands
+ *every record to the worker that owns the record's page. Records of one page
+ *always go to the same worker, in log order, so per-page LSN order is
+ *preserved without any cross-worker ordering. The mappings are kept for Undo.
+ *
+ *Reading starts at the offset in the master record of the last complete
+ *checkpoint: nothing before it is needed by either redo or undo. LSNs go up
+ *one by one through the log, so the records of a segment end at the first one
+ *that does not follow its predecessor: past it lie zero padding, a torn write,
+ *or older records left in a recycled segment. The log continues at the next
+ *segment, whose header must carry its own number.
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  active_txn_.clear();
+  lsn_mapping_.clear();
+
+  std::vector<RedoQueue> queues(num_workers_);
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers_);
+  for (size_t i = 0; i < num_workers_; i++) {
+    workers.emplace_back([this, &queues, i] {
+      RedoTask task;
+      while (queues[i].Pop(&task)) {
+        RedoPage(task.log_record_.get(), task.page_id_);
+      }
+    });
+  }
+
+  size_t redo_offset;
+  size_t offset = disk_manager_->ReadMasterRecord(&redo_offset) ? redo_offset : 0;
+  size_t log_end = disk_manager_->GetLogEndOffset();
 
+  UnmapSegments();
+  first_segment_ = offset / LOG_SEGMENT_SIZE;
+  lsn_t last_lsn = INVALID_LSN;
+  for (size_t segment_no = first_segment_; segment_no * LOG_SEGMENT_SIZE < log_end; segment_no++) {
+    MappedSegment segment;
+    segment.data_ = disk_manager_->MapLogSegment(segment_no, &segment.size_);
+    segments_.push_back(segment);
+    if (segment.data_ == nullptr || segment.size_ < LOG_SEGMENT_HEADER_SIZE ||
+        *reinterpret_cast<const uint64_t *>(segment.data_) != segment_no) {
+      // released before the master record was replaced, or recycled and not written since
+      continue;
+    }
+    size_t segment_start = segment_no * LOG_SEGMENT_SIZE;
+    size_t segment_end = std::min(segment.size_, log_end - segment_start);
+    size_t pos = std::max<size_t>(std::max(offset, segment_start) - segment_start, LOG_SEGMENT_HEADER_SIZE);
+    while (pos + LogRecord::HEADER_SIZE <= segment_end) {
+      int32_t size = *reinterpret_cast<const int32_t *>(segment.data_ + pos);
+      lsn_t lsn = *reinterpret_cast<const lsn_t *>(segment.data_ + pos + 4);
+      bool follows = last_lsn == INVALID_LSN || lsn == last_lsn + 1;
+      if (size < LogRecord::HEADER_SIZE || pos + size > segment_end || !follows) {
+        break;
+      }
+      auto log_record = std::make_shared<LogRecord>();
+      if (!DeserializeLogRecord(segment.data_ + pos, log_record.get())) {
+        break;
+      }
+      last_lsn = lsn;
+      lsn_mapping_[log_record->lsn_] = segment_start + pos;
+      if (log_record->log_record_type_ == LogRecordType::COMMIT ||
+          log_record->log_record_type_ == LogRecordType::ABORT) {
+        active_txn_.erase(log_record->txn_id_);
+      } else if (log_record->txn_id_ != INVALID_TXN_ID) {
+        active_txn_[log_record->txn_id_] = log_record->lsn_;
+      }
+      DispatchRedo(log_record, &queues);
+      pos += size;
+    }
+  }
+
+  for (auto &queue : queues) {
+    queue.Close();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void LogRecovery::DispatchRedo(const std::shared_ptr<LogRecord> &log_record, std::vector<RedoQueue> *queues) {
+  auto dispatch = [&](page_id_t page_id) {
+    (*queues)[std::hash<page_id_t>()(page_id) % num_workers_].Push(RedoTask{log_record, page_id});
+  };
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      dispatch(log_record->insert_rid_.GetPageId());
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      dispatch(log_record->delete_rid_.GetPageId());
+      break;
+    case LogRecordType::UPDATE:
+      dispatch(log_record->update_rid_.GetPageId());
+      break;
+    case LogRecordType::NEWPAGE:
+      // the new page is initialized and its predecessor is linked to it, each by the owner of that page
+      dispatch(log_record->page_id_);
+      if (log_record->prev_page_id_ != INVALID_PAGE_ID) {
+        dispatch(log_record->prev_page_id_);
+      }
+      break;
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+    case LogRecordType::INDEX_SPLIT:
+    case LogRecordType::INDEX_MERGE:
+    case LogRecordType::INDEX_ROOT_CHANGE: {
+      // every page of an index record is redone by its owner, from the ops that touch it
+      std::unordered_set<page_id_t> page_ids;
+      for (const IndexPageOp &op : log_record->index_ops_) {
+        if (page_ids.insert(op.page_id_).second) {
+          dispatch(op.page_id_);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void LogRecovery::RedoPage(LogRecord *log_record, page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  BUSTUB_ASSERT(page != nullptr, "Couldn't fetch page for redo.");
+  auto *table_page = reinterpret_cast<TablePage *>(page);
+  bool redone = false;
+
+  page->WLatch();
+  if (IsIndexRecord(log_record->log_record_type_)) {
+    if (log_record->lsn_ > page->GetLSN()) {
+      for (const IndexPageOp &op : log_record->index_ops_) {
+        if (op.page_id_ == page_id) {
+          IndexLog::Redo(op, page);
+        }
+      }
+      page->SetLSN(log_record->lsn_);
+      redone = true;
+    }
+  } else if (log_record->log_record_type_ == LogRecordType::NEWPAGE) {
+    if (page_id == log_record->page_id_) {
+      // a page that never reached disk has no valid header yet
+      if (table_page->GetTablePageId() != page_id || log_record->lsn_ > page->GetLSN()) {
+        table_page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+        page->SetLSN(log_record->lsn_);
+        redone = true;
+      }
+    } else if (table_page->GetNextPageId() == INVALID_PAGE_ID) {
+      // linking the predecessor is idempotent and does not move its LSN
+      table_page->SetNextPageId(log_record->page_id_);
+      redone = true;
+    }
+  } else if (log_record->lsn_ > page->GetLSN()) {
+    RID rid;
+    Tuple old_tuple;
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT:
+        table_page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr);
+        break;
+      case LogRecordType::MARKDELETE:
+        table_page->MarkDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        table_page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        table_page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE:
+        table_page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr);
+        break;
+      default:
+        break;
+    }
+    page->SetLSN(log_record->lsn_);
+    redone = true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, redone);
+}
+
+/*****************************************************************************
+ * UNDO
+ *****************************************************************************/
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ *
+ *Loser transactions are independent of each other (they held exclusive locks
+ *on everything they wrote), so each one is rolled back on its own worker and
+ *only the page latch serializes workers that touch the same page.
+ *
+ *Undo writes no log records. Instead, once the losers are rolled back, every
+ *page is written out and the master record moves to the end of the log, so
+ *that the next recovery neither redoes nor undoes them a second time.
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  bool has_losers = !active_txn_.empty();
+  std::vector<lsn_t> last_lsns;
+  last_lsns.reserve(active_txn_.size());
+  for (const auto &[txn_id, lsn] : active_txn_) {
+    last_lsns.push_back(lsn);
+  }
+
+  std::atomic<size_t> next_txn{0};
+  std::vector<std::thread> workers;
+  size_t num_workers = std::min(num_workers_, last_lsns.size());
+  workers.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; i++) {
+    workers.emplace_back([this, &last_lsns, &next_txn] {
+      for (size_t idx = next_txn++; idx < last_lsns.size(); idx = next_txn++) {
+        UndoTxn(last_lsns[idx]);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  UnmapSegments();
+
+  if (has_losers) {
+    buffer_pool_manager_->FlushAllPages();
+    size_t log_end = disk_manager_->GetLogEndOffset();
+    if (!disk_manager_->WriteMasterRecord(log_end)) {
+      throw Exception("can't record the end of recovery in the master record");
+    }
+    // the last segment holding records stays, LSNs go on from there
+    disk_manager_->TruncateLog(log_end - LOG_SEGMENT_SIZE);
+  }
+}
+
+void LogRecovery::UndoTxn(lsn_t last_lsn) {
+  lsn_t lsn = last_lsn;
+  while (lsn != INVALID_LSN) {
+    auto it = lsn_mapping_.find(lsn);
+    const char *data = it == lsn_mapping_.end() ? nullptr : GetLogData(it->second);
+    LogRecord log_record;
+    if (data == nullptr || !DeserializeLogRecord(data, &log_record)) {
+      break;
+    }
+    UndoRecord(&log_record);
+    lsn = log_record.prev_lsn_;
+  }
+}
+
+void LogRecovery::UndoRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INDEX_INSERT:
+    case LogRecordType::INDEX_DELETE:
+      UndoIndexRecord(log_record);
+      return;
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    default:
+      return;
+  }
+
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  BUSTUB_ASSERT(page != nullptr, "Couldn't fetch page for undo.");
+  auto *table_page = reinterpret_cast<TablePage *>(page);
+  Tuple old_tuple;
+
+  page->WLatch();
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      table_page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      table_page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      table_page->RestoreTuple(log_record->delete_rid_, log_record->delete_tuple_);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      table_page->MarkDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      table_page->UpdateTuple(log_record->old_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Index entries are undone logically: the entry may have moved to another page
+ * since it was logged, so the inverse operation is run against the index itself
+ * rather than against the logged page. Structure modifications are never
+ * undone, they are not part of any transaction.
+ */
+void LogRecovery::UndoIndexRecord(LogRecord *log_record) {
+  const IndexDescriptor &index = log_record->index_;
+  if (index.key_types_.empty() || log_record->index_value_.size() != sizeof(RID)) {
+    // the key layout of the index is unknown
+    return;
+  }
+  std::vector<Column> columns;
+  for (TypeId type : index.key_types_) {
+    if (type == TypeId::VARCHAR) {
+      // only normalized keys hold strings, and their comparator never looks at the length
+      columns.emplace_back("c" + std::to_string(columns.size()), type,
+                           static_cast<uint32_t>(log_record->index_key_.size()));
+    } else {
+      columns.emplace_back("c" + std::to_string(columns.size()), type);
+    }
+  }
+  Schema key_schema(columns);
+
+  std::scoped_lock latch(index_undo_latch_);
+  switch (log_record->index_key_.size()) {
+    case 4:
+      UndoIndexEntry<4>(log_record, &key_schema);
+      break;
+    case 8:
+      UndoIndexEntry<8>(log_record, &key_schema);
+      break;
+    case 16:
+      UndoIndexEntry<16>(log_record, &key_schema);
+      break;
+    case 32:
+      UndoIndexEntry<32>(log_record, &key_schema);
+      break;
+    case 64:
+      UndoIndexEntry<64>(log_record, &key_schema);
+      break;
+    default:
+      break;
+  }
+}
+
+template <size_t KeySize>
+void LogRecovery::UndoIndexEntry(LogRecord *log_record, Schema *key_schema) {
+  const IndexDescriptor &index = log_record->index_;
+  GenericComparator<KeySize> comparator(
+      key_schema, index.normalized_keys_,
+      index.compared_key_size_ == 0 ? KeySize : static_cast<size_t>(index.compared_key_size_));
+  GenericKey<KeySize> key;
+  memcpy(key.data_, log_record->index_key_.data(), KeySize);
+  RID rid;
+  memcpy(&rid, log_record->index_value_.data(), sizeof(RID));
+  bool undo_insert = log_record->log_record_type_ == LogRecordType::INDEX_INSERT;
+
+  if (index.directory_page_id_ != INVALID_PAGE_ID) {
+    ExtendibleHashTable<GenericKey<KeySize>, RID, GenericComparator<KeySize>> hash_table(
+        index.name_, buffer_pool_manager_, comparator, HashFunction<GenericKey<KeySize>>(), index.directory_page_id_);
+    if (undo_insert) {
+      hash_table.Remove(nullptr, key, rid);
+    } else {
+      hash_table.Insert(nullptr, key, rid);
+    }
+    return;
+  }
+  BPlusTree<GenericKey<KeySize>, RID, GenericComparator<KeySize>> tree(index.name_, buffer_pool_manager_, comparator);
+  tree.LoadRootPageId();
+  if (undo_insert) {
+    tree.Remove(key);
+  } else {
+    tree.Insert(key, rid);
+  }
+}
+
+const char *LogRecovery::GetLogData(size_t offset) const {
+  size_t segment_no = offset / LOG_SEGMENT_SIZE;
+  if (segment_no < first_segment_ || segment_no - first_segment_ >= segments_.size()) {
+    return nullptr;
+  }
+  const MappedSegment &segment = segments_[segment_no - first_segment_];
+  return segment.data_ == nullptr ? nullptr : segment.data_ + offset % LOG_SEGMENT_SIZE;
+}
+
+void LogRecovery::UnmapSegments() {
+  for (const auto &segment : segments_) {
+    if (segment.data_ != nullptr) {
+      disk_manager_->UnmapLogSegment(segment.data_, segment.size_);
+    }
+  }
+  segments_.clear();
+}
 
 }  // namespace bustub
@@ -10,8 +10,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <mutex>  // NOLINT
@@ -27,7 +34,25 @@ namespace bustub {
 static char *buffer_used;
 
 /**
- * Constructor: open/create a single database file & log file
+ * Allocate the whole segment and sync the new file size, so that later log
+ * writes only have to sync data
+ */
+static bool PreallocateLogSegment(int fd) {
+#ifdef __linux__
+  if (posix_fallocate(fd, 0, LOG_SEGMENT_SIZE) != 0) {
+    return false;
+  }
+#else
+  if (ftruncate(fd, LOG_SEGMENT_SIZE) != 0) {
+    return false;
+  }
+#endif
+  return fsync(fd) == 0;
+}
+
+/**
+ * Constructor: open/create a single database file, log segments are opened
+ * lazily by the first log write
  * @input db_file: database file name
  */
 DiskManager::DiskManager(const std::string &db_file)
@@ -38,20 +63,9 @@ DiskManager::DiskManager(const std::string &db_file)
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  master_name_ = file_name_.substr(0, n) + ".master";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
-  }
+  ScanLogSegments();
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
@@ -70,6 +84,12 @@ DiskManager::DiskManager(const std::string &db_file)
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() {
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+}
+
 /**
  * Close all file streams
  */
@@ -78,7 +98,11 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
-  log_io_.close();
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
 }
 
 /**
@@ -132,6 +156,8 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
+ * A write that crosses a segment boundary syncs the earlier segment first, so a
+ * later segment never becomes durable ahead of an earlier one
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
@@ -149,48 +175,199 @@ void DiskManager::WriteLog(char *log_data, int size) {
     assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
   }
 
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  while (size > 0) {
+    size_t segment_no = log_write_offset_ / LOG_SEGMENT_SIZE;
+    size_t segment_offset = log_write_offset_ % LOG_SEGMENT_SIZE;
+    if ((log_fd_ < 0 || log_segment_no_ != segment_no) && !OpenLogSegment(segment_no)) {
+      LOG_DEBUG("I/O error while opening log segment");
+      return;
+    }
+    int count = std::min<int>(size, LOG_SEGMENT_SIZE - segment_offset);
+    // sequence write into space that was allocated up front
+    if (pwrite(log_fd_, log_data, count, segment_offset) != count) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    // needs to flush to keep disk file in sync, the file size never changes so no metadata is written
+#ifdef __linux__
+    fdatasync(log_fd_);
+#else
+    fsync(log_fd_);
+#endif
+    log_data += count;
+    size -= count;
+    log_write_offset_ += count;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
 /**
  * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
+ * Bytes of released segments or beyond the end of the log read as zero
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+bool DiskManager::ReadLog(char *log_data, int size, size_t offset) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  if (offset >= log_write_offset_) {
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  while (size > 0) {
+    size_t segment_no = offset / LOG_SEGMENT_SIZE;
+    size_t segment_offset = offset % LOG_SEGMENT_SIZE;
+    int count = std::min<int>(size, LOG_SEGMENT_SIZE - segment_offset);
+    ssize_t read_count = 0;
+    if (segment_no >= log_head_segment_ && offset < log_write_offset_) {
+      int fd = log_fd_ >= 0 && log_segment_no_ == segment_no ? log_fd_
+                                                               : open(GetLogSegmentName(segment_no).c_str(), O_RDONLY);
+      if (fd >= 0) {
+        read_count = std::max<ssize_t>(pread(fd, log_data, count, segment_offset), 0);
+        if (fd != log_fd_) {
+          close(fd);
+        }
+      }
+    }
+    // if the segment ends before reading "count"
+    memset(log_data + read_count, 0, count - read_count);
+    log_data += count;
+    size -= count;
+    offset += count;
+  }
+  return true;
+}
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+/**
+ * Map a whole log segment. The file descriptor is not needed once the mapping
+ * exists. A segment shorter than LOG_SEGMENT_SIZE is only mapped up to its end,
+ * touching pages past the end of a file would fault
+ */
+const char *DiskManager::MapLogSegment(size_t segment_no, size_t *size) {
+  {
+    std::scoped_lock scoped_log_io_latch(log_io_latch_);
+    if (segment_no < log_head_segment_ || segment_no >= log_end_segment_) {
+      return nullptr;
+    }
+  }
+  int fd = open(GetLogSegmentName(segment_no).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  struct stat stat_buf;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &stat_buf) == 0 && stat_buf.st_size > 0) {
+    *size = std::min<size_t>(stat_buf.st_size, LOG_SEGMENT_SIZE);
+    data = mmap(nullptr, *size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
   }
+  // recovery scans each segment front to back: read ahead aggressively, drop pages behind
+  madvise(data, *size, MADV_SEQUENTIAL);
+  return static_cast<const char *>(data);
+}
 
+void DiskManager::UnmapLogSegment(const char *data, size_t size) { munmap(const_cast<char *>(data), size); }
+
+/**
+ * Returns the logical offset of the end of the log
+ */
+size_t DiskManager::GetLogEndOffset() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  return log_write_offset_;
+}
+
+/**
+ * Recycle or delete the segments before the one containing offset. A recycled
+ * segment is renamed past the last existing segment and keeps its blocks, its
+ * old records are told apart by the segment number in its header
+ */
+void DiskManager::TruncateLog(size_t offset) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  size_t write_segment = log_write_offset_ / LOG_SEGMENT_SIZE;
+  size_t obsolete_end = std::min(offset / LOG_SEGMENT_SIZE, write_segment);
+  if (log_fd_ >= 0 && log_segment_no_ < obsolete_end) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
+  if (log_head_segment_ >= obsolete_end) {
+    return;
+  }
+  for (; log_head_segment_ < obsolete_end; log_head_segment_++) {
+    std::string name = GetLogSegmentName(log_head_segment_);
+    size_t spare_num = log_end_segment_ > write_segment + 1 ? log_end_segment_ - write_segment - 1 : 0;
+    if (spare_num < LOG_SEGMENT_SPARE_NUM) {
+      size_t spare_no = write_segment + 1 + spare_num;
+      std::string spare_name = GetLogSegmentName(spare_no);
+      if (std::rename(name.c_str(), spare_name.c_str()) == 0) {
+        log_end_segment_ = spare_no + 1;
+        continue;
+      }
+    }
+    unlink(name.c_str());
+  }
+  // a recycled segment must not come back under its old name after a crash
+  if (!SyncDirectory(log_name_)) {
+    LOG_DEBUG("I/O error while syncing log directory");
+  }
+}
+
+/**
+ * Replace the master record: write and sync a temporary file, rename it over
+ * the old one and sync the directory, so a crash leaves either the old or the
+ * new record behind, and the new one survives once this returns true
+ */
+bool DiskManager::WriteMasterRecord(size_t redo_offset) {
+  std::string tmp_name = master_name_ + ".tmp";
+  int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while creating master record");
+    return false;
+  }
+  bool written = write(fd, &redo_offset, sizeof(redo_offset)) == sizeof(redo_offset) && fsync(fd) == 0;
+  written = close(fd) == 0 && written;
+  if (!written || std::rename(tmp_name.c_str(), master_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing master record");
+    unlink(tmp_name.c_str());
+    return false;
+  }
+  // the rename is durable once the directory is
+  if (!SyncDirectory(master_name_)) {
+    LOG_DEBUG("I/O error while syncing master record directory");
+    return false;
+  }
   return true;
 }
 
+/**
+ * Private helper function to sync the directory of a file whose directory
+ * entry was created, renamed or removed
+ */
+bool DiskManager::SyncDirectory(const std::string &file_name) {
+  std::string::size_type slash = file_name.rfind('/');
+  std::string dir_name = slash == std::string::npos ? "." : file_name.substr(0, slash + 1);
+  int dir_fd = open(dir_name.c_str(), O_RDONLY | O_DIRECTORY);
+  bool synced = dir_fd >= 0 && fsync(dir_fd) == 0;
+  if (dir_fd >= 0) {
+    close(dir_fd);
+  }
+  return synced;
+}
+
+/**
+ * Read the master record
+ * @return: false means no checkpoint has completed yet
+ */
+bool DiskManager::ReadMasterRecord(size_t *redo_offset) {
+  std::ifstream master_io(master_name_, std::ios::binary | std::ios::in);
+  if (!master_io.is_open()) {
+    return false;
+  }
+  master_io.read(reinterpret_cast<char *>(redo_offset), sizeof(*redo_offset));
+  return master_io.gcount() == sizeof(*redo_offset);
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -206,6 +383,93 @@ int DiskManager::GetNumWrites() const { return num_writes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Private helper function to name log segment files
+ */
+std::string DiskManager::GetLogSegmentName(size_t segment_no) const {
+  return segment_no == 0 ? log_name_ : log_name_ + "." + std::to_string(segment_no);
+}
+
+/**
+ * Private helper function to find the log segments left by an earlier run.
+ * A segment holds log records iff its header carries its own segment number and
+ * a record follows; a recycled segment not written since still carries the
+ * number it had before. Appending resumes at the start of the segment after the
+ * last one holding records
+ */
+void DiskManager::ScanLogSegments() {
+  std::string::size_type slash = log_name_.rfind('/');
+  std::string dir_name = slash == std::string::npos ? "." : log_name_.substr(0, slash + 1);
+  std::string prefix = log_name_.substr(slash + 1);
+  bool found = false;
+  DIR *dir = opendir(dir_name.c_str());
+  if (dir != nullptr) {
+    for (dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      size_t segment_no;
+      if (name == prefix) {
+        segment_no = 0;
+      } else if (name.size() > prefix.size() + 1 && name.compare(0, prefix.size() + 1, prefix + ".") == 0 &&
+                 std::all_of(name.begin() + prefix.size() + 1, name.end(), ::isdigit)) {
+        segment_no = std::stoul(name.substr(prefix.size() + 1));
+      } else {
+        continue;
+      }
+      log_head_segment_ = found ? std::min(log_head_segment_, segment_no) : segment_no;
+      log_end_segment_ = found ? std::max(log_end_segment_, segment_no + 1) : segment_no + 1;
+      found = true;
+    }
+    closedir(dir);
+  }
+
+  log_write_offset_ = log_head_segment_ * LOG_SEGMENT_SIZE;
+  for (size_t segment_no = log_end_segment_; segment_no > log_head_segment_; segment_no--) {
+    int fd = open(GetLogSegmentName(segment_no - 1).c_str(), O_RDONLY);
+    if (fd < 0) {
+      continue;
+    }
+    uint64_t header = 0;
+    int32_t size = 0;
+    bool used = pread(fd, &header, sizeof(header), 0) == sizeof(header) && header == segment_no - 1 &&
+                pread(fd, &size, sizeof(size), LOG_SEGMENT_HEADER_SIZE) == sizeof(size) && size != 0;
+    close(fd);
+    if (used) {
+      log_write_offset_ = segment_no * LOG_SEGMENT_SIZE;
+      break;
+    }
+  }
+}
+
+/**
+ * Private helper function to switch log_fd_ to another segment. A missing
+ * segment is created at its full size up front
+ */
+bool DiskManager::OpenLogSegment(size_t segment_no) {
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
+  std::string name = GetLogSegmentName(segment_no);
+  int fd = open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 || (stat_buf.st_size < LOG_SEGMENT_SIZE && !PreallocateLogSegment(fd))) {
+    close(fd);
+    return false;
+  }
+  // records flushed to a new segment are only durable once its directory entry is
+  if (stat_buf.st_size < LOG_SEGMENT_SIZE && !SyncDirectory(name)) {
+    close(fd);
+    return false;
+  }
+  log_fd_ = fd;
+  log_segment_no_ = segment_no;
+  log_end_segment_ = std::max(log_end_segment_, segment_no + 1);
+  return true;
+}
+
 /**
  * Private helper function to get disk file size
  */
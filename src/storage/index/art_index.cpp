@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// art_index.cpp
+//
+// Identification: src/storage/index/art_index.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/art_index.h"
+
+#include <limits>
+#include <vector>
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+/*
+ * Constructor
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ART_INDEX_TYPE::ArtIndex(std::unique_ptr<IndexMetadata> &&metadata)
+    : Index(std::move(metadata)),
+      layout_(GetMetadata()),
+      comparator_(GetMetadata()->GetKeySchema(), true, layout_.ComparedSize()),
+      container_(comparator_) {}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  // construct insert index key
+  KeyType index_key;
+  layout_.SetIndexKey(&index_key, key, rid);
+
+  container_.Insert(index_key, rid);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
+  // construct delete index key
+  KeyType index_key;
+  layout_.SetIndexKey(&index_key, key, rid);
+
+  container_.Remove(index_key);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void ART_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  // construct scan index key
+  KeyType index_key;
+  layout_.RangeBound(&index_key, &key, true, false);
+
+  if (GetMetadata()->IsUnique()) {
+    container_.GetValue(index_key, result);
+    return;
+  }
+  // the entries of the key lie between its least and greatest RID suffixes
+  KeyType high_key;
+  layout_.RangeBound(&high_key, &key, true, true);
+  std::vector<std::pair<KeyType, ValueType>> items;
+  container_.ScanRange(index_key, high_key, std::numeric_limits<size_t>::max(), &items);
+  for (const auto &item : items) {
+    result->push_back(item.second);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+std::unique_ptr<IndexRangeScan> ART_INDEX_TYPE::ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+                                                          bool high_inclusive, Transaction *transaction) {
+  KeyType low_key;
+  KeyType high_key;
+  bool empty = !layout_.RangeBound(&low_key, low, low_inclusive, false) ||
+               !layout_.RangeBound(&high_key, high, high_inclusive, true) || comparator_(low_key, high_key) > 0;
+  return std::make_unique<TreeScan>(this, low_key, high_key, empty);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool ART_INDEX_TYPE::TreeScan::Next(std::vector<RID> *rids, std::vector<Tuple> *entries) {
+  rids->clear();
+  if (entries != nullptr) {
+    entries->clear();
+  }
+  if (done_) {
+    return false;
+  }
+  batch_.clear();
+  bool more = index_->container_.ScanRange(low_, high_, ART_SCAN_BATCH_SIZE, &batch_);
+  done_ = !more;
+  if (more) {
+    // the next batch starts past the last key of this one, unless it is the greatest there is
+    low_ = batch_.back().first;
+    done_ = !low_.StepUp(index_->layout_.ComparedSize());
+  }
+  for (const auto &item : batch_) {
+    rids->push_back(item.second);
+    if (entries != nullptr) {
+      entries->push_back(index_->layout_.EntryTuple(item.first));
+    }
+  }
+  return !rids->empty();
+}
+
+template class ArtIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class ArtIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class ArtIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class ArtIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class ArtIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
@@ -9,7 +9,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -19,30 +22,146 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, LogManager *log_manager)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      log_manager_(log_manager) {}
+
+/*
+ * Read the root page id of an existing tree from the header page. A tree that
+ * has no record there is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LoadRootPageId() {
+  Page *page = FetchPage(HEADER_PAGE_ID);
+  page_id_t root_page_id;
+  page->RLatch();
+  bool found = reinterpret_cast<HeaderPage *>(page)->GetRootId(index_name_, &root_page_id);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+
+  root_latch_.WLock();
+  root_page_id_ = found ? root_page_id : INVALID_PAGE_ID;
+  root_latch_.WUnlock();
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 /*
  * Return the only value that associated with input key
- * This method is used for point query
+ * This method is used for point query, and takes no latches
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  return false;
+  ValueType value;
+  bool found = false;
+  Page *page =
+      FindLeafPageWithoutLatches(key, false, [&](LeafPage *leaf) { found = leaf->Lookup(key, &value, comparator_); });
+  if (page == nullptr) {
+    return false;
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  if (found) {
+    result->push_back(value);
+  }
+  return found;
+}
+
+/*
+ * Collect the entries of the keys in [low, high], in key order
+ * lock_hook is given every key read, then the first key past high unless high
+ * itself was found, or nullptr at the end of the index. Moving on to the next
+ * leaf, the previous one stays latched until the first key of the next one is
+ * locked, so that nothing slips into the gap in between. The next leaf is only
+ * tried: a merge may be latching leaves right to left
+ * @return: false if lock_hook failed, with nothing added to result
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::ScanRange(const KeyType &low, const KeyType &high, std::vector<MappingType> *result,
+                               const KeyLockHook &lock_hook) {
+  auto first = static_cast<std::ptrdiff_t>(result->size());
+  while (true) {
+    result->erase(result->begin() + first, result->end());
+    root_latch_.RLock();
+    if (root_page_id_ == INVALID_PAGE_ID) {
+      bool locked = lock_hook == nullptr || lock_hook(nullptr);
+      root_latch_.RUnlock();
+      return locked;
+    }
+    root_latch_.RUnlock();
+    Page *page = FindLeafPage(low);
+    if (page == nullptr) {
+      continue;
+    }
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    int index = leaf->KeyIndex(low, comparator_);
+    Page *prev_page = nullptr;
+    bool locked = true;
+    bool busy = false;
+    while (true) {
+      if (index == leaf->GetSize()) {
+        if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+          locked = lock_hook == nullptr || lock_hook(nullptr);
+          break;
+        }
+        Page *next_page = FetchPage(leaf->GetNextPageId());
+        if (!next_page->TryRLatch()) {
+          buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+          busy = true;
+          break;
+        }
+        // only the root leaf can be empty, so the next leaf has a first key to lock
+        prev_page = page;
+        page = next_page;
+        leaf = reinterpret_cast<LeafPage *>(page->GetData());
+        index = 0;
+        continue;
+      }
+      KeyType key = leaf->KeyAt(index);
+      if (lock_hook != nullptr && !lock_hook(&key)) {
+        locked = false;
+        break;
+      }
+      if (prev_page != nullptr) {
+        prev_page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+        prev_page = nullptr;
+      }
+      int cmp = comparator_(key, high);
+      if (cmp > 0) {
+        break;
+      }
+      result->push_back(leaf->GetItem(index));
+      if (cmp == 0) {
+        break;
+      }
+      index++;
+    }
+    for (Page *latched : {prev_page, page}) {
+      if (latched != nullptr) {
+        latched->RUnlatch();
+        buffer_pool_manager_->UnpinPage(latched->GetPageId(), false);
+      }
+    }
+    if (busy) {
+      continue;
+    }
+    if (!locked) {
+      result->erase(result->begin() + first, result->end());
+    }
+    return locked;
+  }
 }
 
 /*****************************************************************************
@@ -54,56 +173,350 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * entry, otherwise insert into leaf page.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
+ *
+ * A leaf without room for the entry is split, together with every ancestor
+ * without room for the separator from below, before the entry is inserted.
+ * The splits are logged first, so a crash in between leaves a tree that is
+ * merely missing the new entry.
+ *
+ * lock_hook is given the key following the new one before anything changes,
+ * and false is returned without inserting if it fails.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) { return false; }
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction,
+                            const KeyLockHook &lock_hook) {
+  std::deque<Page *> local_page_set;
+  auto *page_set = transaction != nullptr ? transaction->GetPageSet().get() : &local_page_set;
+  IndexLog log(log_manager_, transaction);
+
+  Page *leaf_page;
+  while (true) {
+    leaf_page = FindLeafPageForWrite(key, Operation::INSERT, page_set);
+    if (leaf_page == nullptr) {
+      // the root latch keeps everybody else out of the empty tree meanwhile
+      if (lock_hook != nullptr && !lock_hook(nullptr)) {
+        ReleasePages(page_set, false);
+        return false;
+      }
+      leaf_page = StartNewTree(page_set, &log);
+      break;
+    }
+    auto *leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+    ValueType old_value;
+    if (leaf->Lookup(key, &old_value, comparator_)) {
+      ReleasePages(page_set, false);
+      return false;
+    }
+    if (lock_hook == nullptr) {
+      break;
+    }
+    KeyType next;
+    bool at_end;
+    if (!NextKey(leaf_page, leaf->KeyIndex(key, comparator_), &next, &at_end)) {
+      // the next leaf is being restructured, start over instead of waiting for it under our latches
+      ReleasePages(page_set, false);
+      continue;
+    }
+    if (!lock_hook(at_end ? nullptr : &next)) {
+      ReleasePages(page_set, false);
+      return false;
+    }
+    break;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  if (!leaf->HasRoomFor(key)) {
+    leaf_page = SplitPath(key, page_set, &log);
+    log.Append(LogRecordType::INDEX_SPLIT);
+  }
+  InsertIntoLeaf(leaf_page, key, value, &log);
+  log.SetEntry(Descriptor(), std::string(reinterpret_cast<const char *>(&key), sizeof(KeyType)),
+               std::string(reinterpret_cast<const char *>(&value), sizeof(ValueType)));
+  log.Append(LogRecordType::INDEX_INSERT);
+  ReleasePages(page_set, true);
+  return true;
+}
 /*
- * Insert constant key & value pair into an empty tree
- * User needs to first ask for new page from buffer pool manager(NOTICE: throw
- * an "out of memory" exception if returned value is nullptr), then update b+
- * tree's root page id and insert entry directly into leaf page.
+ * Create an empty root leaf and record it in the header page. The caller holds
+ * the root latch
+ * @return: the new root page, write latched
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+Page *BPLUSTREE_TYPE::StartNewTree(std::deque<Page *> *page_set, IndexLog *log) {
+  Page *page = NewLatchedPage(page_set);
+  reinterpret_cast<LeafPage *>(page->GetData())->Init(page->GetPageId(), INVALID_PAGE_ID, leaf_max_size_);
+  LogImage(page, log);
+  root_page_id_ = page->GetPageId();
+  UpdateRootPageId(page_set, log);
+  log->Append(LogRecordType::INDEX_ROOT_CHANGE);
+  return page;
+}
 
 /*
- * Insert constant key & value pair into leaf page
- * User needs to first find the right leaf page as insertion target, then look
- * through leaf page to see whether insert key exist or not. If exist, return
- * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * Insert constant key & value pair into a leaf page that has room for it
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  return false;
+void BPLUSTREE_TYPE::InsertIntoLeaf(Page *leaf_page, const KeyType &key, const ValueType &value, IndexLog *log) {
+  auto *leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  int slot = leaf->KeyIndex(key, comparator_);
+  int prefix = leaf->GetKeyPrefixSize();
+  int suffix = leaf->GetKeySuffixSize();
+  leaf->Insert(key, value, comparator_);
+  LogInsertedEntry(leaf_page, slot, prefix, suffix, log);
+}
+
+/*
+ * Split the leaf at the end of the latched path, which has no room for key,
+ * then bottom-up every ancestor that has no room for the separator coming up
+ * from below; an ancestor is split before the separator goes into whichever
+ * half the split child ended up in. The first page of the path has room for
+ * any separator or is the root, which grows a new root when split.
+ * @return: the leaf page (write latched) that key belongs to afterwards
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::SplitPath(const KeyType &key, std::deque<Page *> *page_set, IndexLog *log) {
+  std::vector<Page *> path;
+  for (Page *page : *page_set) {
+    if (page != nullptr) {
+      path.push_back(page);
+    }
+  }
+  Page *page = path.back();
+  KeyType separator;
+  Page *sibling_page = Split(page, page_set, &separator, log);
+  Page *leaf_page = comparator_(key, separator) < 0 ? page : sibling_page;
+  for (size_t i = path.size() - 1;; i--) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    auto *sibling = reinterpret_cast<BPlusTreePage *>(sibling_page->GetData());
+    if (i == 0) {
+      BUSTUB_ASSERT(node->IsRootPage(), "only the root may be split without its parent on the latched path");
+      Page *root_page = NewLatchedPage(page_set);
+      auto *root = reinterpret_cast<InternalPage *>(root_page->GetData());
+      root->Init(root_page->GetPageId(), INVALID_PAGE_ID, internal_max_size_);
+      root->PopulateNewRoot(page->GetPageId(), separator, sibling_page->GetPageId());
+      LogImage(root_page, log);
+      for (Page *child_page : {page, sibling_page}) {
+        reinterpret_cast<BPlusTreePage *>(child_page->GetData())->SetParentPageId(root_page->GetPageId());
+        log->SetParent(child_page->GetPageId(), root_page->GetPageId());
+      }
+      root_page_id_ = root_page->GetPageId();
+      UpdateRootPageId(page_set, log);
+      break;
+    }
+    Page *parent_page = path[i - 1];
+    auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+    bool has_room = parent->HasRoomFor(separator);
+    KeyType parent_separator;
+    Page *parent_sibling_page = nullptr;
+    if (!has_room) {
+      parent_sibling_page = Split(parent_page, page_set, &parent_separator, log);
+      if (parent->ValueIndex(page->GetPageId()) == -1) {
+        parent_page = parent_sibling_page;
+        parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+      }
+    }
+    int prefix = parent->GetKeyPrefixSize();
+    int suffix = parent->GetKeySuffixSize();
+    parent->InsertNodeAfter(page->GetPageId(), separator, sibling_page->GetPageId());
+    LogInsertedEntry(parent_page, parent->ValueIndex(sibling_page->GetPageId()), prefix, suffix, log);
+    if (sibling->GetParentPageId() != parent_page->GetPageId()) {
+      sibling->SetParentPageId(parent_page->GetPageId());
+      log->SetParent(sibling_page->GetPageId(), parent_page->GetPageId());
+    }
+    if (has_room) {
+      break;
+    }
+    page = path[i - 1];
+    sibling_page = parent_sibling_page;
+    separator = parent_separator;
+  }
+  return leaf_page;
+}
+
+/*
+ * Move the upper half of a page into a new right sibling, which takes over
+ * the key range from separator on. Linking the sibling into the parent is
+ * left to the caller
+ * @return: the new sibling page, write latched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::Split(Page *page, std::deque<Page *> *page_set, KeyType *separator, IndexLog *log) {
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  Page *sibling_page = NewLatchedPage(page_set);
+  page_id_t sibling_page_id = sibling_page->GetPageId();
+
+  if (node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    auto *sibling = reinterpret_cast<LeafPage *>(sibling_page->GetData());
+    sibling->Init(sibling_page_id, node->GetParentPageId(), leaf->GetMaxSize());
+    leaf->MoveHalfTo(sibling);
+    *separator = sibling->KeyAt(0);
+  } else {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    auto *sibling = reinterpret_cast<InternalPage *>(sibling_page->GetData());
+    sibling->Init(sibling_page_id, node->GetParentPageId(), internal->GetMaxSize());
+    *separator = internal->MoveHalfTo(sibling, buffer_pool_manager_);
+    LogChildren(sibling, 0, sibling->GetSize(), log);
+  }
+  // the sibling takes over the key range from separator on, and the right link
+  auto *sibling = reinterpret_cast<BPlusTreePage *>(sibling_page->GetData());
+  sibling->SetNextPageId(node->GetNextPageId());
+  if (node->GetNextPageId() != INVALID_PAGE_ID) {
+    sibling->SetHighKey(node->HighKey<KeyType>());
+  }
+  sibling->SetHasLowKey(true);
+  sibling->SetLowKey(*separator);
+  node->SetNextPageId(sibling_page_id);
+  node->SetHighKey(*separator);
+  LogImage(page, log);
+  LogImage(sibling_page, log);
+  return sibling_page;
 }
 
+/*****************************************************************************
+ * BULK LOADING
+ *****************************************************************************/
 /*
- * Split input page and return newly created page.
- * Using template N to represent either internal page or leaf page.
- * User needs to first ask for new page from buffer pool manager(NOTICE: throw
- * an "out of memory" exception if returned value is nullptr), then move half
- * of key & value pairs from input page to newly created page
+ * Build the tree bottom-up from count pairs that next yields in increasing key
+ * order, without duplicates. Pages are filled to fill_factor of their max
+ * size, within what keeps every page but the root at least at its min size,
+ * and the entries of a level are spread evenly over its pages. How well keys
+ * compress is not known up front, so sizes are planned as if pages held no
+ * more entries than fit uncompressed; the room compression leaves is taken
+ * up by later inserts. The pages of
+ * all levels are filled in one pass, left to right, each allocated when the
+ * previous one of its level is full; a full page is not touched again.
+ *
+ * The pages are not logged: with logging, each one is written out as soon as
+ * it is full, and only the root change that makes the tree visible is logged.
+ * A crash before it leaves an empty tree.
+ * @return: false if the tree is not empty, with nothing read from next
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
-  return nullptr;
+bool BPLUSTREE_TYPE::BulkLoad(const std::function<bool(MappingType *)> &next, size_t count, double fill_factor,
+                              Transaction *transaction) {
+  std::deque<Page *> page_set;
+  IndexLog log(log_manager_, transaction);
+  root_latch_.WLock();
+  page_set.push_back(nullptr);
+  if (root_page_id_ != INVALID_PAGE_ID) {
+    ReleasePages(&page_set, false);
+    return false;
+  }
+  if (count == 0) {
+    ReleasePages(&page_set, false);
+    return true;
+  }
+
+  // plan the levels bottom-up, each has an entry per page of the one below
+  std::vector<BulkLevel> levels;
+  size_t entries = count;
+  while (true) {
+    bool leaf = levels.empty();
+    int max_size = std::min(leaf ? leaf_max_size_ : internal_max_size_,
+                            leaf ? BPlusTreePage::UncompressedCapacity<KeyType, ValueType>()
+                                 : BPlusTreePage::UncompressedCapacity<KeyType, page_id_t>());
+    // as BPlusTreePage::GetMinSize()
+    int min_size = leaf ? max_size / 2 : (max_size + 1) / 2;
+    size_t pages = BulkPageCount(entries, max_size, min_size, fill_factor);
+    levels.push_back(BulkLevel{entries, pages, 0, nullptr});
+    if (pages == 1) {
+      break;
+    }
+    entries = pages;
+  }
+
+  MappingType pair;
+  size_t loaded = 0;
+  while (next(&pair)) {
+    Page *page = BulkPageFor(&levels, 0, pair.first, &log);
+    reinterpret_cast<LeafPage *>(page->GetData())->Append(pair.first, pair.second);
+    loaded++;
+  }
+  BUSTUB_ASSERT(loaded == count, "bulk load must be given as many pairs as planned for");
+
+  root_page_id_ = levels.back().page_->GetPageId();
+  for (BulkLevel &level : levels) {
+    BulkFinishPage(level.page_, &log);
+  }
+  UpdateRootPageId(&page_set, &log);
+  log.Append(LogRecordType::INDEX_ROOT_CHANGE);
+  ReleasePages(&page_set, true);
+  return true;
 }
 
 /*
- * Insert key & value pair into internal page after split
- * @param   old_node      input page from split() method
- * @param   key
- * @param   new_node      returned page from split() method
- * User needs to first find the parent page of old_node, parent node must be
- * adjusted to take info of new_node into account. Remember to deal with split
- * recursively if necessary.
+ * @return: the number of pages for a level of entries, so that spreading them
+ * evenly fills pages to about fill_factor and keeps every page between
+ * min_size and max_size. A single page, the root, may hold fewer
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+size_t BPLUSTREE_TYPE::BulkPageCount(size_t entries, int max_size, int min_size, double fill_factor) {
+  auto max_entries = static_cast<size_t>(max_size);
+  auto min_entries = static_cast<size_t>(std::max(min_size, 1));
+  auto target = std::clamp(static_cast<size_t>(fill_factor * max_size), min_entries, max_entries);
+  size_t pages = std::max((entries + target - 1) / target, (entries + max_entries - 1) / max_entries);
+  return std::max<size_t>(std::min(pages, entries / min_entries), 1);
+}
+
+/*
+ * Make room for an entry with key on a level of a tree being bulk loaded:
+ * the page being filled, or a new one once that holds its share. A new page
+ * gets key as separator in its parent, and takes over the right link and the
+ * key range from key on from its left neighbour, which is then full
+ * @return: the page to append the entry to, pinned
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::BulkPageFor(std::vector<BulkLevel> *levels, size_t level, const KeyType &key, IndexLog *log) {
+  BulkLevel &current = (*levels)[level];
+  if (current.page_ != nullptr) {
+    // the first entries % pages pages take one entry more than the others
+    size_t index = current.page_index_ - 1;
+    size_t share = current.entries_ / current.pages_ + (index < current.entries_ % current.pages_ ? 1 : 0);
+    if (static_cast<size_t>(reinterpret_cast<BPlusTreePage *>(current.page_->GetData())->GetSize()) < share) {
+      return current.page_;
+    }
+  }
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "all pages are pinned");
+  }
+  page_id_t parent_page_id = INVALID_PAGE_ID;
+  if (level + 1 < levels->size()) {
+    Page *parent_page = BulkPageFor(levels, level + 1, key, log);
+    reinterpret_cast<InternalPage *>(parent_page->GetData())->Append(key, page_id);
+    parent_page_id = parent_page->GetPageId();
+  }
+  if (level == 0) {
+    reinterpret_cast<LeafPage *>(page->GetData())->Init(page_id, parent_page_id, leaf_max_size_);
+  } else {
+    reinterpret_cast<InternalPage *>(page->GetData())->Init(page_id, parent_page_id, internal_max_size_);
+  }
+  if (current.page_ != nullptr) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    auto *left = reinterpret_cast<BPlusTreePage *>(current.page_->GetData());
+    left->SetNextPageId(page_id);
+    left->SetHighKey(key);
+    node->SetHasLowKey(true);
+    node->SetLowKey(key);
+    BulkFinishPage(current.page_, log);
+  }
+  current.page_ = page;
+  current.page_index_++;
+  return page;
+}
+
+/*
+ * Unpin a full page of a tree being bulk loaded. With logging, it is written
+ * out right away, as its contents are not logged
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkFinishPage(Page *page, IndexLog *log) {
+  if (log->IsEnabled()) {
+    buffer_pool_manager_->FlushPage(page->GetPageId());
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), !log->IsEnabled());
+}
 
 /*****************************************************************************
  * REMOVE
@@ -114,59 +527,233 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ *
+ * The entry is logged before the pages are rebalanced; an underfull leaf left
+ * behind by a crash in between is still a valid tree.
+ *
+ * lock_hook is given the key following the removed one before anything
+ * changes, and nothing is removed if it fails.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction, const KeyLockHook &lock_hook) {
+  std::deque<Page *> local_page_set;
+  std::unordered_set<page_id_t> local_deleted_page_set;
+  auto *page_set = transaction != nullptr ? transaction->GetPageSet().get() : &local_page_set;
+  auto *deleted_page_set =
+      transaction != nullptr ? transaction->GetDeletedPageSet().get() : &local_deleted_page_set;
+  IndexLog log(log_manager_, transaction);
+
+  Page *leaf_page;
+  LeafPage *leaf;
+  int slot;
+  while (true) {
+    leaf_page = FindLeafPageForWrite(key, Operation::DELETE, page_set);
+    if (leaf_page == nullptr) {
+      ReleasePages(page_set, false);
+      return;
+    }
+    leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+    slot = leaf->KeyIndex(key, comparator_);
+    if (slot == leaf->GetSize() || comparator_(leaf->KeyAt(slot), key) != 0) {
+      ReleasePages(page_set, false);
+      return;
+    }
+    if (lock_hook == nullptr) {
+      break;
+    }
+    KeyType next;
+    bool at_end;
+    if (!NextKey(leaf_page, slot + 1, &next, &at_end)) {
+      ReleasePages(page_set, false);
+      continue;
+    }
+    if (!lock_hook(at_end ? nullptr : &next)) {
+      ReleasePages(page_set, false);
+      return;
+    }
+    break;
+  }
+  MappingType entry = leaf->GetItem(slot);
+  std::string entry_data(leaf->EntryData(slot), leaf->EntrySize());
+  leaf->RemoveAndDeleteRecord(key, comparator_);
+  log.DeleteEntry(leaf_page, slot, entry_data.data(), entry_data.size());
+  log.SetEntry(Descriptor(), std::string(reinterpret_cast<const char *>(&key), sizeof(KeyType)),
+               std::string(reinterpret_cast<const char *>(&entry.second), sizeof(ValueType)));
+  log.Append(LogRecordType::INDEX_DELETE);
+
+  // rebalance bottom-up along the latched path
+  std::vector<Page *> path;
+  for (Page *page : *page_set) {
+    if (page != nullptr) {
+      path.push_back(page);
+    }
+  }
+  bool rebalanced = false;
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    auto *node = reinterpret_cast<BPlusTreePage *>((*it)->GetData());
+    if (node->IsRootPage()) {
+      AdjustRoot(*it, page_set, deleted_page_set, &log);
+      break;
+    }
+    if (node->GetSize() >= node->GetMinSize() || it + 1 == path.rend()) {
+      break;
+    }
+    rebalanced = true;
+    if (!CoalesceOrRedistribute(*it, *(it + 1), page_set, deleted_page_set, &log)) {
+      break;
+    }
+  }
+  log.Append(rebalanced ? LogRecordType::INDEX_MERGE : LogRecordType::INDEX_ROOT_CHANGE);
+
+  // Pages merged away are not deleted but marked invalid while still latched: a reader that takes no latches may be
+  // on its way to one, and has to find out that it must start over. They are deleted once no such reader runs any
+  // more, and no iterator still holds a pin on one.
+  for (Page *page : *page_set) {
+    if (page != nullptr && deleted_page_set->count(page->GetPageId()) > 0) {
+      reinterpret_cast<BPlusTreePage *>(page->GetData())->SetPageType(IndexPageType::INVALID_INDEX_PAGE);
+    }
+  }
+  ReleasePages(page_set, true);
+  for (page_id_t page_id : *deleted_page_set) {
+    reclaimer_.Retire(page_id);
+  }
+  deleted_page_set->clear();
+  reclaimer_.Reclaim([this](page_id_t page_id) { return buffer_pool_manager_->DeletePage(page_id); });
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
- * Using template N to represent either internal page or leaf page.
- * @return: true means target leaf page should be deleted, false means no
- * deletion happens
+ * The right sibling is preferred; the last child of a parent uses its left one.
+ * Compressed keys may not fit together even below max size, and the parent
+ * may have no room for the separator a redistribution moves up; then the page
+ * is left below its min size, which is still a valid tree.
+ * @return: true means the parent lost an entry and may underflow itself
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(Page *page, Page *parent_page, std::deque<Page *> *page_set,
+                                            std::unordered_set<page_id_t> *deleted_page_set, IndexLog *log) {
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (parent->GetSize() < 2) {
+    // an only child has no sibling to borrow from
+    return false;
+  }
+  int index = parent->ValueIndex(page->GetPageId());
+  bool from_right = index + 1 < parent->GetSize();
+  int sibling_index = from_right ? index + 1 : index - 1;
+  Page *sibling_page = FetchPage(parent->ValueAt(sibling_index));
+  sibling_page->WLatch();
+  page_set->push_back(sibling_page);
+  auto *sibling = reinterpret_cast<BPlusTreePage *>(sibling_page->GetData());
+
+  auto *left = from_right ? node : sibling;
+  auto *right = from_right ? sibling : node;
+  int separator_index = from_right ? sibling_index : index;
+  bool fits = left->IsLeafPage() ? reinterpret_cast<LeafPage *>(left)->HasRoomForAllOf(
+                                       reinterpret_cast<LeafPage *>(right))
+                                 : reinterpret_cast<InternalPage *>(left)->HasRoomForAllOf(
+                                       reinterpret_cast<InternalPage *>(right), parent->KeyAt(separator_index));
+  if (fits) {
+    if (from_right) {
+      Coalesce(page, sibling_page, parent_page, sibling_index, deleted_page_set, log);
+    } else {
+      Coalesce(sibling_page, page, parent_page, index, deleted_page_set, log);
+    }
+    return true;
+  }
+  // the sibling's second or last key ends up as the separator between the two, leaves and internal pages alike
+  KeyType separator = sibling->IsLeafPage()
+                          ? reinterpret_cast<LeafPage *>(sibling)->KeyAt(from_right ? 1 : sibling->GetSize() - 1)
+                          : reinterpret_cast<InternalPage *>(sibling)->KeyAt(from_right ? 1 : sibling->GetSize() - 1);
+  if (parent->HasRoomToSetKey(separator)) {
+    Redistribute(sibling_page, page, parent_page, index, from_right, separator, log);
+  }
   return false;
 }
 
 /*
- * Move all the key & value pairs from one page to its sibling page, and notify
- * buffer pool manager to delete this page. Parent page must be adjusted to
- * take info of deletion into account. Remember to deal with coalesce or
- * redistribute recursively if necessary.
- * Using template N to represent either internal page or leaf page.
- * @param   neighbor_node      sibling page of input "node"
- * @param   node               input from method coalesceOrRedistribute()
- * @param   parent             parent page of input "node"
- * @return  true means parent node should be deleted, false means no deletion
- * happend
+ * Move all the key & value pairs from right page into its left sibling and
+ * mark right page for deletion. The separator at index of the parent goes
+ * away; an internal page takes it over as the key of its first moved entry
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N>
-bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
-                              BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
-                              Transaction *transaction) {
-  return false;
+void BPLUSTREE_TYPE::Coalesce(Page *left_page, Page *right_page, Page *parent_page, int index,
+                              std::unordered_set<page_id_t> *deleted_page_set, IndexLog *log) {
+  auto *left = reinterpret_cast<BPlusTreePage *>(left_page->GetData());
+  auto *right = reinterpret_cast<BPlusTreePage *>(right_page->GetData());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (left->IsLeafPage()) {
+    reinterpret_cast<LeafPage *>(right)->MoveAllTo(reinterpret_cast<LeafPage *>(left));
+  } else {
+    auto *left_internal = reinterpret_cast<InternalPage *>(left);
+    int begin = left_internal->GetSize();
+    reinterpret_cast<InternalPage *>(right)->MoveAllTo(left_internal, parent->KeyAt(index), buffer_pool_manager_);
+    LogChildren(left_internal, begin, left_internal->GetSize(), log);
+  }
+  // left takes over the key range of right and its right link; right keeps its own for iterators still on it
+  left->SetNextPageId(right->GetNextPageId());
+  if (right->GetNextPageId() != INVALID_PAGE_ID) {
+    left->SetHighKey(right->HighKey<KeyType>());
+  }
+  LogImage(left_page, log);
+
+  std::string entry_data(parent->EntryData(index), parent->EntrySize());
+  parent->Remove(index);
+  log->DeleteEntry(parent_page, index, entry_data.data(), entry_data.size());
+  deleted_page_set->insert(right_page->GetPageId());
 }
 
 /*
- * Redistribute key & value pairs from one page to its sibling page. If index ==
- * 0, move sibling page's first key & value pair into end of input "node",
- * otherwise move sibling page's last key & value pair into head of input
- * "node".
- * Using template N to represent either internal page or leaf page.
- * @param   neighbor_node      sibling page of input "node"
- * @param   node               input from method coalesceOrRedistribute()
+ * Move one key & value pair from sibling page into page, which sits at index
+ * of the parent, and make separator the key between the two. With from_right
+ * the sibling's first pair goes to the end of page, otherwise its last pair
+ * goes to the front. The parent must have room for separator.
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+void BPLUSTREE_TYPE::Redistribute(Page *sibling_page, Page *page, Page *parent_page, int index, bool from_right,
+                                  const KeyType &separator, IndexLog *log) {
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  int separator_index = from_right ? index + 1 : index;
+  if (reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage()) {
+    auto *node = reinterpret_cast<LeafPage *>(page->GetData());
+    auto *sibling = reinterpret_cast<LeafPage *>(sibling_page->GetData());
+    if (from_right) {
+      sibling->MoveFirstToEndOf(node);
+    } else {
+      sibling->MoveLastToFrontOf(node);
+    }
+  } else {
+    auto *node = reinterpret_cast<InternalPage *>(page->GetData());
+    auto *sibling = reinterpret_cast<InternalPage *>(sibling_page->GetData());
+    if (from_right) {
+      sibling->MoveFirstToEndOf(node, parent->KeyAt(separator_index), buffer_pool_manager_);
+      LogChildren(node, node->GetSize() - 1, node->GetSize(), log);
+    } else {
+      sibling->MoveLastToFrontOf(node, parent->KeyAt(separator_index), buffer_pool_manager_);
+      LogChildren(node, 0, 1, log);
+    }
+  }
+  int prefix = parent->GetKeyPrefixSize();
+  int suffix = parent->GetKeySuffixSize();
+  parent->SetKeyAt(separator_index, separator);
+  // the fences between the two move along with the separator
+  auto *left = reinterpret_cast<BPlusTreePage *>((from_right ? page : sibling_page)->GetData());
+  auto *right = reinterpret_cast<BPlusTreePage *>((from_right ? sibling_page : page)->GetData());
+  left->SetHighKey(parent->KeyAt(separator_index));
+  right->SetLowKey(parent->KeyAt(separator_index));
+  LogImage(page, log);
+  LogImage(sibling_page, log);
+  if (parent->GetKeyPrefixSize() != prefix || parent->GetKeySuffixSize() != suffix) {
+    LogImage(parent_page, log);
+  } else {
+    log->Write(parent_page, parent->EntryData(separator_index), parent->EntrySize());
+  }
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
- * called within coalesceOrRedistribute() method
+ * called after the pages below the root were rebalanced
  * case 1: when you delete the last element in root page, but root page still
  * has one last child
  * case 2: when you delete the last element in whole b+ tree
@@ -174,7 +761,29 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
+bool BPLUSTREE_TYPE::AdjustRoot(Page *old_root_page, std::deque<Page *> *page_set,
+                                std::unordered_set<page_id_t> *deleted_page_set, IndexLog *log) {
+  auto *old_root = reinterpret_cast<BPlusTreePage *>(old_root_page->GetData());
+  if (old_root->IsLeafPage()) {
+    if (old_root->GetSize() > 0) {
+      return false;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+  } else {
+    if (old_root->GetSize() > 1) {
+      return false;
+    }
+    // the only child is write latched by us already
+    root_page_id_ = reinterpret_cast<InternalPage *>(old_root)->RemoveAndReturnOnlyChild();
+    Page *child_page = FetchPage(root_page_id_);
+    reinterpret_cast<BPlusTreePage *>(child_page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    log->SetParent(root_page_id_, INVALID_PAGE_ID);
+  }
+  UpdateRootPageId(page_set, log);
+  deleted_page_set->insert(old_root_page->GetPageId());
+  return true;
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -185,7 +794,9 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, &reclaimer_, comparator_, SeekLeaf(), nullptr);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -193,7 +804,9 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, &reclaimer_, comparator_, SeekLeaf(), &key);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -201,39 +814,349 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERA
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() {
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, &reclaimer_, comparator_, nullptr, nullptr);
+}
+
+/*
+ * How iterators find their way back into the tree: without latches, to the
+ * leaf the key belongs to, or to the leftmost leaf for nullptr
+ */
+INDEX_TEMPLATE_ARGUMENTS
+typename INDEXITERATOR_TYPE::Seek BPLUSTREE_TYPE::SeekLeaf() {
+  return [this](const KeyType *key) {
+    return FindLeafPageWithoutLatches(key == nullptr ? KeyType{} : *key, key == nullptr, [](LeafPage *leaf) {});
+  };
+}
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
- * the left most leaf page
+ * the left most leaf page. Latches are crabbed downwards in read mode
+ * @return: the leaf page, pinned and read latched, or nullptr for an empty tree
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  root_latch_.RLock();
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = FetchPage(root_page_id_);
+  page->RLatch();
+  root_latch_.RUnlock();
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    Page *child_page = FetchPage(leftMost ? internal->ValueAt(0) : internal->Lookup(key, comparator_));
+    child_page->RLatch();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = child_page;
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  }
+  return page;
+}
+
+/*
+ * Find the leaf page containing key, or the leftmost one, without taking
+ * latches. Each page is read optimistically and read again if a writer
+ * latched it meanwhile; read is run on the leaf the same way, so it may run
+ * more than once and must not act on what it reads. A page that no longer
+ * covers key is left to the right sibling while key is at or above its high
+ * key, otherwise the search starts over from the root
+ * @return: the leaf page, pinned only, or nullptr for an empty tree
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageWithoutLatches(const KeyType &key, bool leftMost,
+                                                const std::function<void(LeafPage *)> &read) {
+  // no page the search may reach is deleted before the search is over
+  typename EpochReclaimer<page_id_t>::Guard guard(&reclaimer_);
+  while (true) {
+    page_id_t page_id = root_page_id_.load();
+    if (page_id == INVALID_PAGE_ID) {
+      return nullptr;
+    }
+    Page *page = FetchPage(page_id);
+    while (page != nullptr) {
+      uint64_t version = page->GetVersion();
+      if (version % 2 == 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      bool restart = false;
+      page_id_t next_page_id = INVALID_PAGE_ID;
+      if (node->GetPageType() == IndexPageType::INVALID_INDEX_PAGE ||
+          (!leftMost && node->HasLowKey() && comparator_(key, node->LowKey<KeyType>()) < 0)) {
+        restart = true;
+      } else if (!leftMost && node->GetNextPageId() != INVALID_PAGE_ID &&
+                 comparator_(key, node->HighKey<KeyType>()) >= 0) {
+        next_page_id = node->GetNextPageId();
+      } else if (node->IsLeafPage()) {
+        read(reinterpret_cast<LeafPage *>(node));
+      } else {
+        auto *internal = reinterpret_cast<InternalPage *>(node);
+        next_page_id = leftMost ? internal->ValueAt(0) : internal->Lookup(key, comparator_);
+      }
+      if (!page->Validate(version)) {
+        continue;
+      }
+      if (!restart && next_page_id == INVALID_PAGE_ID) {
+        return page;
+      }
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = restart ? nullptr : FetchPage(next_page_id);
+    }
+  }
+}
+
+/*
+ * Find the leaf page for an insert or delete. Most writes change nothing but
+ * their leaf, so the descent is first tried optimistically. Otherwise the
+ * latches are crabbed down in write mode: ancestors are released as soon as a
+ * page is safe, i.e. the operation cannot propagate above it; the rest stay in
+ * page_set, top-down.
+ * @return: the leaf page, or nullptr for an empty tree (root latch still held)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageForWrite(const KeyType &key, Operation op, std::deque<Page *> *page_set) {
+  Page *leaf_page = FindLeafPageOptimistic(key, op);
+  if (leaf_page != nullptr) {
+    page_set->push_back(leaf_page);
+    return leaf_page;
+  }
+  root_latch_.WLock();
+  page_set->push_back(nullptr);
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  page_id_t page_id = root_page_id_;
+  while (true) {
+    Page *page = FetchPage(page_id);
+    page->WLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op, key)) {
+      ReleasePages(page_set, false);
+    }
+    page_set->push_back(page);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    page_id = reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_);
+  }
+}
+
+/*
+ * Descend with read latches like a reader, but write latch the leaf. A page
+ * never changes between leaf and internal, and the parent latch keeps the
+ * child from being freed, so its type can be read before latching it
+ * @return: the leaf page, pinned and write latched, or nullptr if the tree is
+ * empty or op could split or merge the leaf
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const KeyType &key, Operation op) {
+  root_latch_.RLock();
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = FetchPage(root_page_id_);
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  LatchForWrite(page);
+  root_latch_.RUnlock();
+  while (!node->IsLeafPage()) {
+    Page *child_page = FetchPage(reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_));
+    auto *child = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
+    LatchForWrite(child_page);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = child_page;
+    node = child;
+  }
+  if (!IsSafe(node, op, key)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return nullptr;
+  }
+  return page;
+}
+
+/*
+ * Latch a page met by an optimistic write: a leaf in write mode, an internal
+ * page in read mode
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LatchForWrite(Page *page) {
+  if (reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage()) {
+    page->WLatch();
+  } else {
+    page->RLatch();
+  }
+}
+
+/*
+ * Whether op with key cannot propagate above node. A leaf is safe for an
+ * insert if it has room for key; the separator an internal page may be given
+ * is not known yet, so it must have room for one more entry even if that
+ * compresses nothing
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op, const KeyType &key) const {
+  if (op == Operation::INSERT) {
+    if (node->IsLeafPage()) {
+      return reinterpret_cast<LeafPage *>(node)->HasRoomFor(key);
+    }
+    return node->GetSize() < std::min(node->GetMaxSize(), BPlusTreePage::UncompressedCapacity<KeyType, page_id_t>());
+  }
+  if (node->IsRootPage()) {
+    return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+  }
+  return node->GetSize() > node->GetMinSize();
+}
+
+/*
+ * Find the key following the entry at index of a write latched leaf, which is
+ * the first key of the next leaf past the last entry. The next leaf is only
+ * tried, a merge may be latching leaves right to left
+ * @return: false if the next leaf is latched in write mode
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::NextKey(Page *leaf_page, int index, KeyType *next, bool *at_end) {
+  auto *leaf = reinterpret_cast<LeafPage *>(leaf_page->GetData());
+  *at_end = false;
+  if (index < leaf->GetSize()) {
+    *next = leaf->KeyAt(index);
+    return true;
+  }
+  if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+    *at_end = true;
+    return true;
+  }
+  Page *next_page = FetchPage(leaf->GetNextPageId());
+  bool latched = next_page->TryRLatch();
+  if (latched) {
+    *next = reinterpret_cast<LeafPage *>(next_page->GetData())->KeyAt(0);
+    next_page->RUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+  return latched;
+}
+
+/*
+ * Unlatch and unpin every page in page_set, releasing the root latch for its
+ * nullptr entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleasePages(std::deque<Page *> *page_set, bool is_dirty) {
+  for (Page *page : *page_set) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+      continue;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);
+  }
+  page_set->clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "all pages are pinned");
+  }
+  return page;
+}
+
+/*
+ * Allocate a page and add it to page_set, write latched. Nobody can reach it
+ * before it is linked in under a latch we hold, but latching it keeps the
+ * release path uniform
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::NewLatchedPage(std::deque<Page *> *page_set) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "all pages are pinned");
+  }
+  page->WLatch();
+  page_set->push_back(page);
+  return page;
+}
+
+/*
+ * Log the used part of a page: its header, its entries, its key template and
+ * its fence keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogImage(Page *page, IndexLog *log) const {
+  if (!log->IsEnabled()) {
+    return;
+  }
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  size_t size = node->IsLeafPage()
+                    ? LEAF_PAGE_HEADER_SIZE + node->GetSize() * reinterpret_cast<LeafPage *>(node)->EntrySize()
+                    : INTERNAL_PAGE_HEADER_SIZE + node->GetSize() * reinterpret_cast<InternalPage *>(node)->EntrySize();
+  log->Image(page, size);
+  log->Write(page, &node->KeyTemplate<KeyType>(), 3 * sizeof(KeyType));
+}
+
+/*
+ * Log the entry just inserted at index of a page whose keys were stored
+ * without prefix and suffix bytes before. If those changed, or the page had
+ * no keys, all entries were rewritten and the whole page is logged
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogInsertedEntry(Page *page, int index, int prefix, int suffix, IndexLog *log) const {
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  int keys = node->IsLeafPage() ? node->GetSize() - 1 : node->GetSize() - 2;
+  if (keys <= 0 || node->GetKeyPrefixSize() != prefix || node->GetKeySuffixSize() != suffix) {
+    LogImage(page, log);
+  } else if (node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    log->InsertEntry(page, index, leaf->EntryData(index), leaf->EntrySize());
+  } else {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    log->InsertEntry(page, index, internal->EntryData(index), internal->EntrySize());
+  }
+}
+
+/*
+ * Log that the children in [begin, end) of node were adopted by it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogChildren(InternalPage *node, int begin, int end, IndexLog *log) const {
+  for (int i = begin; i < end; i++) {
+    log->SetParent(node->ValueAt(i), node->GetPageId());
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+IndexDescriptor BPLUSTREE_TYPE::Descriptor() const {
+  return IndexDescriptor{index_name_, INVALID_PAGE_ID, GetKeyTypes(comparator_), HasNormalizedKeys(comparator_),
+                         ComparedKeySize(comparator_)};
 }
 
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
- * Call this method everytime root page id is changed.
- * @parameter: insert_record      defualt value is false. When set to true,
- * insert a record <index_name, root_page_id> into header page instead of
- * updating it.
+ * Call this method everytime root page id is changed. The header page stays
+ * write latched in page_set until the change is logged.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
+void BPLUSTREE_TYPE::UpdateRootPageId(std::deque<Page *> *page_set, IndexLog *log) {
+  Page *page = FetchPage(HEADER_PAGE_ID);
+  page->WLatch();
+  page_set->push_back(page);
+  auto *header_page = reinterpret_cast<HeaderPage *>(page);
+  if (!header_page->UpdateRecord(index_name_, root_page_id_) && root_page_id_ != INVALID_PAGE_ID) {
     header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
-    // update root_page_id in header_page
-    header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  log->SetRoot(page, index_name_, root_page_id_);
 }
 
 /*
@@ -11,43 +11,196 @@
 
 #include "storage/index/b_plus_tree_index.h"
 
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "storage/index/external_sorter.h"
+
 namespace bustub {
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     LogManager *log_manager, LockManager *lock_manager, double fill_factor)
     : Index(std::move(metadata)),
-      comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      layout_(GetMetadata()),
+      comparator_(GetMetadata()->GetKeySchema(), true, layout_.ComparedSize()),
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 log_manager),
+      lock_manager_(lock_manager),
+      fill_factor_(fill_factor),
+      key_lock_seed_(std::hash<std::string>()(GetMetadata()->GetName())) {}
 
+/*
+ * The tree only tries key locks under its latches. When one is not free, the
+ * operation gives up, waits for the lock with no latch held and starts over.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  layout_.SetIndexKey(&index_key, key, rid);
 
-  container_.Insert(index_key, rid, transaction);
+  if (lock_manager_ == nullptr || transaction == nullptr || IsRollback(transaction, &index_key)) {
+    container_.Insert(index_key, rid, transaction);
+    return;
+  }
+  if (!lock_manager_->LockKey(transaction, LockMode::EXCLUSIVE, KeyLockId(&index_key))) {
+    return;
+  }
+  int64_t blocked_on = 0;
+  bool blocked;
+  auto check_next = [&](const KeyType *next) {
+    blocked_on = KeyLockId(next);
+    blocked = !lock_manager_->CheckKey(transaction, LockMode::EXCLUSIVE, blocked_on, false);
+    return !blocked;
+  };
+  do {
+    blocked = false;
+    container_.Insert(index_key, rid, transaction, check_next);
+  } while (blocked && lock_manager_->CheckKey(transaction, LockMode::EXCLUSIVE, blocked_on));
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  layout_.SetIndexKey(&index_key, key, rid);
 
-  container_.Remove(index_key, transaction);
+  if (lock_manager_ == nullptr || transaction == nullptr || IsRollback(transaction, &index_key)) {
+    container_.Remove(index_key, transaction);
+    return;
+  }
+  if (!lock_manager_->LockKey(transaction, LockMode::EXCLUSIVE, KeyLockId(&index_key))) {
+    return;
+  }
+  int64_t blocked_on = 0;
+  bool blocked;
+  auto lock_next = [&](const KeyType *next) {
+    blocked_on = KeyLockId(next);
+    blocked = !lock_manager_->LockKey(transaction, LockMode::EXCLUSIVE, blocked_on, false);
+    return !blocked;
+  };
+  do {
+    blocked = false;
+    container_.Remove(index_key, transaction, lock_next);
+  } while (blocked && lock_manager_->LockKey(transaction, LockMode::EXCLUSIVE, blocked_on));
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  layout_.RangeBound(&index_key, &key, true, false);
 
+  if (!GetMetadata()->IsUnique()) {
+    // the entries of the key lie between its least and greatest RID suffixes
+    KeyType high_key;
+    layout_.RangeBound(&high_key, &key, true, true);
+    ScanRange(index_key, high_key, result, transaction);
+    return;
+  }
+  if (LocksKeys(transaction) && transaction->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
+    // locks the key if it is there, and the gap it would go into if it is not
+    ScanRange(index_key, index_key, result, transaction);
+    return;
+  }
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) {
+  ExternalSorter<KeyType, ValueType, KeyComparator> sorter(comparator_);
+  Tuple key;
+  RID rid;
+  KeyType index_key;
+  while (next(&key, &rid)) {
+    layout_.SetIndexKey(&index_key, key, rid);
+    sorter.Add(index_key, rid);
+  }
+  size_t count = sorter.Finish();
+  auto next_pair = [&](MappingType *pair) { return sorter.Next(pair); };
+  if (container_.BulkLoad(next_pair, count, fill_factor_, transaction)) {
+    return;
+  }
+  MappingType pair;
+  while (sorter.Next(&pair)) {
+    container_.Insert(pair.first, pair.second, transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+std::unique_ptr<IndexRangeScan> BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple *low, bool low_inclusive,
+                                                                const Tuple *high, bool high_inclusive,
+                                                                Transaction *transaction) {
+  KeyType low_key;
+  KeyType high_key;
+  if (!layout_.RangeBound(&low_key, low, low_inclusive, false) ||
+      !layout_.RangeBound(&high_key, high, high_inclusive, true) || comparator_(low_key, high_key) > 0) {
+    return std::make_unique<LeafScan>(this, GetEndIterator(), nullptr, std::vector<MappingType>());
+  }
+  if (LocksKeys(transaction) && transaction->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
+    std::vector<MappingType> items;
+    ScanEntries(low_key, high_key, &items, transaction);
+    return std::make_unique<LeafScan>(this, GetEndIterator(), nullptr, std::move(items));
+  }
+  return std::make_unique<LeafScan>(this, GetBeginIterator(low_key), high == nullptr ? nullptr : &high_key,
+                                    std::vector<MappingType>());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanRange(const KeyType &low, const KeyType &high, std::vector<RID> *result,
+                                     Transaction *transaction) {
+  std::vector<MappingType> items;
+  ScanEntries(low, high, &items, transaction);
+  for (const MappingType &item : items) {
+    result->push_back(item.second);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanEntries(const KeyType &low, const KeyType &high, std::vector<MappingType> *result,
+                                       Transaction *transaction) {
+  if (!LocksKeys(transaction) || transaction->GetIsolationLevel() != IsolationLevel::REPEATABLE_READ) {
+    container_.ScanRange(low, high, result);
+    return;
+  }
+  int64_t blocked_on = 0;
+  auto lock_key = [&](const KeyType *key) {
+    blocked_on = KeyLockId(key);
+    return lock_manager_->LockKey(transaction, LockMode::SHARED, blocked_on, false);
+  };
+  while (!container_.ScanRange(low, high, result, lock_key)) {
+    if (!lock_manager_->LockKey(transaction, LockMode::SHARED, blocked_on)) {
+      return;
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::IsRollback(Transaction *transaction, const KeyType *key) const {
+  if (transaction->GetState() != TransactionState::ABORTED) {
+    return false;
+  }
+  auto key_modes = transaction->GetKeyLockModes();
+  auto held = key_modes->find(KeyLockId(key));
+  return held != key_modes->end() && held->second == LockMode::EXCLUSIVE;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int64_t BPLUSTREE_INDEX_TYPE::KeyLockId(const KeyType *key) const {
+  if (key == nullptr) {
+    return static_cast<int64_t>(key_lock_seed_);
+  }
+  // the included columns are no part of the key
+  size_t hash = std::hash<std::string_view>()(
+      std::string_view(reinterpret_cast<const char *>(key), comparator_.ComparedSize()));
+  // different keys sharing an id only make their locks conflict needlessly
+  return static_cast<int64_t>(key_lock_seed_ ^ (hash + 0x9E3779B97F4A7C15ULL + (key_lock_seed_ << 6)));
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.Begin(); }
 
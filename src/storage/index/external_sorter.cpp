@@ -0,0 +1,180 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.cpp
+//
+// Identification: src/storage/index/external_sorter.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/external_sorter.h"
+
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::ExternalSorter(const KeyComparator &comparator, size_t buffer_size)
+    : comparator_(comparator), buffer_capacity_(std::max<size_t>(1, buffer_size / sizeof(MappingType))) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::~ExternalSorter() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Add(const KeyType &key, const ValueType &value) {
+  if (buffer_.size() == buffer_capacity_) {
+    SpillRun();
+  }
+  buffer_.emplace_back(key, value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t EXTERNAL_SORTER_TYPE::Finish() {
+  if (runs_.empty()) {
+    SortBuffer();
+    return buffer_.size();
+  }
+  if (!buffer_.empty()) {
+    SpillRun();
+  }
+  std::vector<MappingType>().swap(buffer_);
+  // count the distinct keys in a merge of its own, the caller plans around the exact number
+  StartMerge();
+  size_t count = 0;
+  MappingType pair;
+  while (NextMerged(&pair)) {
+    count++;
+  }
+  StartMerge();
+  return count;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::Next(MappingType *pair) {
+  if (!runs_.empty()) {
+    return NextMerged(pair);
+  }
+  if (buffer_pos_ == buffer_.size()) {
+    return false;
+  }
+  *pair = buffer_[buffer_pos_++];
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SpillRun() {
+  if (file_ == nullptr) {
+    file_ = std::tmpfile();
+    if (file_ == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot create a temporary file to sort in");
+    }
+  }
+  SortBuffer();
+  size_t bytes = buffer_.size() * sizeof(MappingType);
+  if (fseeko(file_, static_cast<off_t>(file_size_), SEEK_SET) != 0 ||
+      std::fwrite(buffer_.data(), 1, bytes, file_) != bytes) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot write a sorted run");
+  }
+  runs_.push_back(Run{file_size_, file_size_ + bytes, file_size_, {}, 0});
+  file_size_ += bytes;
+  buffer_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SortBuffer() {
+  std::stable_sort(buffer_.begin(), buffer_.end(),
+                   [&](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; });
+  auto end = std::unique(buffer_.begin(), buffer_.end(), [&](const MappingType &a, const MappingType &b) {
+    return comparator_(a.first, b.first) == 0;
+  });
+  buffer_.erase(end, buffer_.end());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::StartMerge() {
+  std::fflush(file_);
+  // the memory of the buffer is shared out among the runs, a page worth at least each
+  size_t block_size = std::max(buffer_capacity_ / runs_.size(), PAGE_SIZE / sizeof(MappingType) + 1);
+  heap_.clear();
+  has_last_key_ = false;
+  for (size_t run = 0; run < runs_.size(); run++) {
+    runs_[run].read_ = runs_[run].begin_;
+    runs_[run].block_.resize(block_size);
+    runs_[run].block_pos_ = block_size;
+    MappingType pair;
+    if (ReadRun(run, &pair)) {
+      heap_.emplace_back(pair, run);
+    }
+  }
+  auto after = [&](const auto &a, const auto &b) { return MergeAfter(a, b); };
+  std::make_heap(heap_.begin(), heap_.end(), after);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::ReadRun(size_t run, MappingType *pair) {
+  Run &current = runs_[run];
+  if (current.block_pos_ == current.block_.size()) {
+    size_t bytes = std::min(current.end_ - current.read_, current.block_.size() * sizeof(MappingType));
+    if (bytes == 0) {
+      return false;
+    }
+    if (fseeko(file_, static_cast<off_t>(current.read_), SEEK_SET) != 0 ||
+        std::fread(current.block_.data(), 1, bytes, file_) != bytes) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot read a sorted run");
+    }
+    current.block_.resize(bytes / sizeof(MappingType));
+    current.block_pos_ = 0;
+    current.read_ += bytes;
+  }
+  *pair = current.block_[current.block_pos_++];
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::NextMerged(MappingType *pair) {
+  auto after = [&](const auto &a, const auto &b) { return MergeAfter(a, b); };
+  while (!heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end(), after);
+    auto [next, run] = heap_.back();
+    heap_.pop_back();
+    MappingType refill;
+    if (ReadRun(run, &refill)) {
+      heap_.emplace_back(refill, run);
+      std::push_heap(heap_.begin(), heap_.end(), after);
+    }
+    if (has_last_key_ && comparator_(next.first, last_key_) == 0) {
+      continue;
+    }
+    last_key_ = next.first;
+    has_last_key_ = true;
+    *pair = next;
+    return true;
+  }
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::MergeAfter(const std::pair<MappingType, size_t> &a,
+                                      const std::pair<MappingType, size_t> &b) const {
+  int cmp = comparator_(a.first.first, b.first.first);
+  return cmp != 0 ? cmp > 0 : a.second > b.second;
+}
+
+template class ExternalSorter<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSorter<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSorter<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSorter<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSorter<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
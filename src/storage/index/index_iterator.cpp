@@ -2,29 +2,207 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
 
-/*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
- */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, EpochReclaimer<page_id_t> *reclaimer,
+                                  const KeyComparator &comparator, Seek seek, const KeyType *bound)
+    : buffer_pool_manager_(buffer_pool_manager),
+      reclaimer_(reclaimer),
+      comparator_(comparator),
+      seek_(std::move(seek)),
+      page_(seek_ == nullptr ? nullptr : seek_(bound)),
+      leaf_(page_ == nullptr ? nullptr : reinterpret_cast<LeafPage *>(page_->GetData())),
+      bound_(bound == nullptr ? KeyType{} : *bound),
+      has_bound_(bound != nullptr),
+      inclusive_(true),
+      floor_(bound_),
+      has_floor_(has_bound_) {
+  SkipToNextEntry();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : buffer_pool_manager_(other.buffer_pool_manager_),
+      reclaimer_(other.reclaimer_),
+      comparator_(other.comparator_),
+      seek_(std::move(other.seek_)),
+      page_(other.page_),
+      leaf_(other.leaf_),
+      index_(other.index_),
+      version_(other.version_),
+      item_(other.item_),
+      bound_(other.bound_),
+      has_bound_(other.has_bound_),
+      inclusive_(other.inclusive_),
+      floor_(other.floor_),
+      has_floor_(other.has_floor_),
+      prefetch_(std::move(other.prefetch_)),
+      prefetch_page_id_(other.prefetch_page_id_) {
+  other.page_ = nullptr;
+  other.leaf_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() {
+  DropPrefetch();
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::IsEnd() { return page_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() { return item_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  SkipToNextEntry();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipToNextEntry() {
+  while (page_ != nullptr) {
+    uint64_t version = page_->GetVersion();
+    if (version % 2 == 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    // the right sibling is not deleted before it is pinned
+    typename EpochReclaimer<page_id_t>::Guard guard(reclaimer_);
+    // a leaf merged away, or one that gave entries to its left sibling, may not hold what comes next
+    bool covered = leaf_->GetPageType() == IndexPageType::LEAF_PAGE &&
+                   (!leaf_->HasLowKey() ||
+                    (has_floor_ && comparator_(leaf_->template LowKey<KeyType>(), floor_) <= 0));
+    // unless the leaf changed, the next entry is in the next slot
+    int index = version == version_ ? index_ + 1 : FirstIndexPastBound();
+    bool found = covered && index < leaf_->GetSize();
+    MappingType item;
+    if (found) {
+      item = leaf_->GetItem(index);
+    }
+    page_id_t next_page_id = leaf_->GetNextPageId();
+    KeyType high_key;
+    if (covered && next_page_id != INVALID_PAGE_ID) {
+      high_key = leaf_->template HighKey<KeyType>();
+    }
+    if (!page_->Validate(version)) {
+      continue;
+    }
+    if (found) {
+      index_ = index;
+      version_ = version;
+      item_ = item;
+      bound_ = item.first;
+      has_bound_ = true;
+      inclusive_ = false;
+      return;
+    }
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+    version_ = NO_VERSION;
+    if (!covered) {
+      DropPrefetch();
+      page_ = seek_(has_bound_ ? &bound_ : nullptr);
+      floor_ = bound_;
+      has_floor_ = has_bound_;
+    } else if (next_page_id == INVALID_PAGE_ID) {
+      DropPrefetch();
+      page_ = nullptr;
+    } else {
+      // the right sibling must still start where this leaf ended
+      page_ = FetchLeaf(next_page_id);
+      floor_ = high_key;
+      has_floor_ = true;
+    }
+    leaf_ = page_ == nullptr ? nullptr : reinterpret_cast<LeafPage *>(page_->GetData());
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;
+bool INDEXITERATOR_TYPE::ReadLeafBatch(std::vector<MappingType> *batch, const KeyType *high) {
+  batch->clear();
+  if (page_ == nullptr || (high != nullptr && comparator_(item_.first, *high) > 0)) {
+    return false;
+  }
+  batch->push_back(item_);
+  if (page_->GetVersion() != version_) {
+    // the leaf changed since item_ was read, leave the rest to operator++
+    return true;
+  }
+  // the right sibling is not deleted before the prefetch pins it
+  auto guard = std::make_unique<typename EpochReclaimer<page_id_t>::Guard>(reclaimer_);
+  int size = leaf_->GetSize();
+  bool past_high = false;
+  for (int index = index_ + 1; index < size; index++) {
+    MappingType item = leaf_->GetItem(index);
+    if (high != nullptr && comparator_(item.first, *high) > 0) {
+      past_high = true;
+      break;
+    }
+    batch->push_back(item);
+  }
+  page_id_t next_page_id = leaf_->GetNextPageId();
+  if (!page_->Validate(version_)) {
+    batch->resize(1);
+    return true;
+  }
+  index_ += static_cast<int>(batch->size()) - 1;
+  item_ = batch->back();
+  bound_ = item_.first;
+  if (past_high) {
+    return false;
+  }
+  if (next_page_id != INVALID_PAGE_ID && !prefetch_.valid()) {
+    prefetch_page_id_ = next_page_id;
+    prefetch_ = std::async(std::launch::async,
+                           [buffer_pool_manager = buffer_pool_manager_, next_page_id, guard = std::move(guard)] {
+                             return buffer_pool_manager->FetchPage(next_page_id);
+                           });
+  }
+  return true;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+Page *INDEXITERATOR_TYPE::FetchLeaf(page_id_t page_id) {
+  if (prefetch_.valid() && prefetch_page_id_ == page_id) {
+    return prefetch_.get();
+  }
+  // the leaf split since, or it was never prefetched
+  DropPrefetch();
+  return buffer_pool_manager_->FetchPage(page_id);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::DropPrefetch() {
+  if (!prefetch_.valid()) {
+    return;
+  }
+  Page *page = prefetch_.get();
+  if (page != nullptr) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+int INDEXITERATOR_TYPE::FirstIndexPastBound() const {
+  if (!has_bound_) {
+    return 0;
+  }
+  int index = leaf_->KeyIndex(bound_, comparator_);
+  if (!inclusive_ && index < leaf_->GetSize() && comparator_(leaf_->KeyAt(index), bound_) == 0) {
+    index++;
+  }
+  return index;
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
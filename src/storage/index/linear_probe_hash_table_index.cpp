@@ -12,7 +12,11 @@ HASH_TABLE_INDEX_TYPE::LinearProbeHashTableIndex(std::unique_ptr<IndexMetadata>
                                                  const HashFunction<KeyType> &hash_fn)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, num_buckets, hash_fn) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, num_buckets, hash_fn) {
+  if (!GetMetadata()->GetIncludedAttrs().empty()) {
+    throw NotImplementedException("hash indexes cannot include columns");
+  }
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -22,37 +24,91 @@ namespace bustub {
 /*
  * Init method after creating a new internal page
  * Including set page type, set current size, set page id, set parent id and set
- * max page size
+ * max page size. A new page has neither a right sibling nor fence keys, nor
+ * keys to compress
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+  BUSTUB_ASSERT(max_size <= INTERNAL_PAGE_SIZE, "the halves of a split must fit uncompressed");
+  SetPageType(IndexPageType::INTERNAL_PAGE);
+  SetLSN();
+  SetSize(0);
+  SetMaxSize(max_size);
+  SetParentPageId(parent_id);
+  SetPageId(page_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetHasLowKey(false);
+  SetKeyAffixes(sizeof(KeyType), 0);
+}
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
- * array offset)
+ * array offset). The page must have room for the new key (see
+ * HasRoomToSetKey()), the entries are rewritten if it does not share the
+ * prefix and suffix of the others
  */
 INDEX_TEMPLATE_ARGUMENTS
-KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  KeyType key{};
-  return key;
-}
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const { return SlotKey<KeyType, ValueType>(index); }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  ValueType value = ValueAt(index);
+  IncludeKey<KeyType, ValueType>(key);
+  WriteSlot(index, key, value);
+}
 
 /*
  * Helper method to find and return array index(or offset), so that its value
  * equals to input "value"
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const { return 0; }
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
+  for (int i = 0; i < GetSize(); i++) {
+    if (ValueAt(i) == value) {
+      return i;
+    }
+  }
+  return -1;
+}
 
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return 0; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return SlotValue<KeyType, ValueType>(index); }
+
+/*
+ * Helper methods to get the stored, compressed form of the entry at "index"
+ * and its size, which all entries share
+ */
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntryData(int index) const { return SlotData<KeyType, ValueType>(index); }
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntrySize() const { return SlotSize<KeyType, ValueType>(); }
+
+/*
+ * Helper methods to find out whether the page has room for one more entry
+ * with key, for key in place of one of its keys, or for the entries of
+ * "other" after the middle key from the parent pulled down. Below max size,
+ * a key may still not fit if it shares fewer bytes with the others than they
+ * do among each other
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomFor(const KeyType &key) const {
+  return HasRoomForKey<KeyType, ValueType>(key, GetSize() + 1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomToSetKey(const KeyType &key) const {
+  return HasRoomForKey<KeyType, ValueType>(key, GetSize());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomForAllOf(const BPlusTreeInternalPage *other,
+                                                     const KeyType &middle_key) const {
+  return HasRoomForPage<KeyType, ValueType>(other, &middle_key);
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -61,10 +117,30 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return 0; }
  * Find and return the child pointer(page_id) which points to the child page
  * that contains input "key"
  * Start the search from the second key(the first key should always be invalid)
+ * Normalized and integer keys are searched without decoding them (see
+ * NormalizedKeyBound() and IntegerKeyBound())
  */
 INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
-  return INVALID_PAGE_ID;
+  // find the last index whose key is <= key; the invalid first key counts as minus infinity
+  if (comparator.IsNormalized()) {
+    return ValueAt(NormalizedKeyBound<KeyType, ValueType>(1, GetSize(), key, comparator.ComparedSize(), true) - 1);
+  }
+  int width = comparator.IntegerKeyWidth();
+  if (width > 0 && width <= static_cast<int>(sizeof(KeyType))) {
+    return ValueAt(IntegerKeyBound<KeyType, ValueType, KeyComparator>(1, GetSize(), key, width, true) - 1);
+  }
+  int lo = 1;
+  int hi = GetSize();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (comparator(KeyAt(mid), key) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return ValueAt(lo - 1);
 }
 
 /*****************************************************************************
@@ -78,34 +154,67 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyCo
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
-                                                     const ValueType &new_value) {}
+                                                     const ValueType &new_value) {
+  SetSize(0);
+  InsertSlot(0, new_key, old_value);
+  IncludeKey<KeyType, ValueType>(new_key);
+  InsertSlot(1, new_key, new_value);
+}
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
- * old_value
+ * old_value. The page must have room for it (see HasRoomFor())
  * @return:  new size after insertion
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                                                     const ValueType &new_value) {
-  return 0;
+  int index = ValueIndex(old_value) + 1;
+  IncludeKey<KeyType, ValueType>(new_key);
+  InsertSlot(index, new_key, new_value);
+  return GetSize();
+}
+
+/*
+ * Append new_key & new_value after all the pairs of the page, which must have
+ * room for them. Used to build pages in key order, as bulk loading does
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Append(const KeyType &new_key, const ValueType &new_value) {
+  IncludeKey<KeyType, ValueType>(new_key);
+  InsertSlot(GetSize(), new_key, new_value);
 }
 
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Remove half of key & value pairs from this page to "recipient" page. Both
+ * halves compress their keys anew, they may share more bytes than the whole
+ * @return: the key of the first moved pair, which separates the halves
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
-                                                BufferPoolManager *buffer_pool_manager) {}
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
+                                                   BufferPoolManager *buffer_pool_manager) {
+  int keep = (GetSize() + 1) / 2;
+  KeyType middle_key = KeyAt(keep);
+  recipient->CopyNFrom(this, keep, GetSize() - keep, buffer_pool_manager);
+  SetSize(keep);
+  CompactKeys<KeyType, ValueType>();
+  recipient->CompactKeys<KeyType, ValueType>();
+  return middle_key;
+}
 
-/* Copy entries into me, starting from {items} and copy {size} entries.
+/* Copy {size} entries of source, starting from {begin}, to the end of mine.
  * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
  * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const BPlusTreeInternalPage *source, int begin, int size,
+                                               BufferPoolManager *buffer_pool_manager) {
+  for (int i = begin; i < begin + size; i++) {
+    CopyLastFrom(MappingType(source->KeyAt(i), source->ValueAt(i)), buffer_pool_manager);
+  }
+}
 
 /*****************************************************************************
  * REMOVE
@@ -116,19 +225,26 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, Buf
  * NOTE: store key&value pair continuously after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
+  RemoveSlots<KeyType, ValueType>(index, 1);
+}
 
 /*
  * Remove the only key & value pair in internal page and return the value
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() { return INVALID_PAGE_ID; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
+  ValueType only_child = ValueAt(0);
+  SetSize(0);
+  return only_child;
+}
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 /*
- * Remove all of key & value pairs from this page to "recipient" page.
+ * Remove all of key & value pairs from this page to "recipient" page, which
+ * must have room for them (see HasRoomForAllOf()).
  * The middle_key is the separation key you should get from the parent. You need
  * to make sure the middle key is added to the recipient to maintain the invariant.
  * You also need to use BufferPoolManager to persist changes to the parent page id for those
@@ -136,7 +252,11 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() { return IN
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                               BufferPoolManager *buffer_pool_manager) {}
+                                               BufferPoolManager *buffer_pool_manager) {
+  recipient->CopyLastFrom(MappingType(middle_key, ValueAt(0)), buffer_pool_manager);
+  recipient->CopyNFrom(this, 1, GetSize() - 1, buffer_pool_manager);
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
@@ -151,14 +271,20 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                      BufferPoolManager *buffer_pool_manager) {}
+                                                      BufferPoolManager *buffer_pool_manager) {
+  recipient->CopyLastFrom(MappingType(middle_key, ValueAt(0)), buffer_pool_manager);
+  Remove(0);
+}
 
 /* Append an entry at the end.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  Append(pair.first, pair.second);
+  Adopt(pair.second, buffer_pool_manager);
+}
 
 /*
  * Remove the last key & value pair from this page to head of "recipient" page.
@@ -169,14 +295,33 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                       BufferPoolManager *buffer_pool_manager) {}
+                                                       BufferPoolManager *buffer_pool_manager) {
+  recipient->SetKeyAt(0, middle_key);
+  recipient->CopyFirstFrom(MappingType(KeyAt(GetSize() - 1), ValueAt(GetSize() - 1)), buffer_pool_manager);
+  IncreaseSize(-1);
+}
 
 /* Append an entry at the beginning.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  // the key of the first pair is not used, and need not share the prefix and suffix of the others
+  InsertSlot(0, pair.first, pair.second);
+  Adopt(pair.second, buffer_pool_manager);
+}
+
+/*
+ * Point the parent page id of child page at me.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Adopt(page_id_t child_page_id, BufferPoolManager *buffer_pool_manager) {
+  Page *page = buffer_pool_manager->FetchPage(child_page_id);
+  BUSTUB_ASSERT(page != nullptr, "child page must exist");
+  reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(GetPageId());
+  buffer_pool_manager->UnpinPage(child_page_id, true);
+}
 
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
@@ -24,74 +26,153 @@ namespace bustub {
 /**
  * Init method after creating a new leaf page
  * Including set page type, set current size to zero, set page id/parent id, set
- * next page id and set max size
+ * next page id and set max size. A new page has no fence keys, and no keys to
+ * compress yet
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
-
-/**
- * Helper methods to set/get next page id
- */
-INDEX_TEMPLATE_ARGUMENTS
-page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const { return INVALID_PAGE_ID; }
-
-INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+  BUSTUB_ASSERT(max_size <= LEAF_PAGE_SIZE, "the halves of a split must fit uncompressed");
+  SetPageType(IndexPageType::LEAF_PAGE);
+  SetLSN();
+  SetSize(0);
+  SetMaxSize(max_size);
+  SetParentPageId(parent_id);
+  SetPageId(page_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetHasLowKey(false);
+  SetKeyAffixes(sizeof(KeyType), 0);
+}
 
 /**
  * Helper method to find the first index i so that array[i].first >= key
  * NOTE: This method is only used when generating index iterator
+ * Normalized and integer keys are searched without decoding them (see
+ * NormalizedKeyBound() and IntegerKeyBound())
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const { return 0; }
+int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
+  if (comparator.IsNormalized()) {
+    return NormalizedKeyBound<KeyType, ValueType>(0, GetSize(), key, comparator.ComparedSize(), false);
+  }
+  int width = comparator.IntegerKeyWidth();
+  if (width > 0 && width <= static_cast<int>(sizeof(KeyType))) {
+    return IntegerKeyBound<KeyType, ValueType, KeyComparator>(0, GetSize(), key, width, false);
+  }
+  int lo = 0;
+  int hi = GetSize();
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (comparator(KeyAt(mid), key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
 
 /*
  * Helper method to find and return the key associated with input "index"(a.k.a
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  KeyType key{};
-  return key;
-}
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const { return SlotKey<KeyType, ValueType>(index); }
 
 /*
  * Helper method to find and return the key & value pair associated with input
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  return array_[0];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const {
+  return MappingType(SlotKey<KeyType, ValueType>(index), SlotValue<KeyType, ValueType>(index));
+}
+
+/*
+ * Helper methods to get the stored, compressed form of the entry at "index"
+ * and its size, which all entries share
+ */
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_LEAF_PAGE_TYPE::EntryData(int index) const { return SlotData<KeyType, ValueType>(index); }
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::EntrySize() const { return SlotSize<KeyType, ValueType>(); }
+
+/*
+ * Helper method to find out whether one more entry with key fits into the
+ * page, which it may not even below max size if key shares fewer bytes with
+ * the others than they do among each other
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::HasRoomFor(const KeyType &key) const {
+  return HasRoomForKey<KeyType, ValueType>(key, GetSize() + 1);
+}
+
+/*
+ * Helper method to find out whether the entries of "other" fit into the page
+ * besides its own
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::HasRoomForAllOf(const BPlusTreeLeafPage *other) const {
+  return HasRoomForPage<KeyType, ValueType>(other, nullptr);
 }
 
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 /*
- * Insert key & value pair into leaf page ordered by key
+ * Insert key & value pair into leaf page ordered by key, which must have room
+ * for it (see HasRoomFor()). The entries are rewritten if key does not share
+ * the prefix and suffix of the others
  * @return  page size after insertion
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) {
-  return 0;
+  int index = KeyIndex(key, comparator);
+  if (index < GetSize() && comparator(KeyAt(index), key) == 0) {
+    return GetSize();
+  }
+  IncludeKey<KeyType, ValueType>(key);
+  InsertSlot(index, key, value);
+  return GetSize();
+}
+
+/*
+ * Append key & value after all the pairs of the page, which must have room
+ * for them and hold only smaller keys. Used to build pages in key order, as
+ * bulk loading does
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Append(const KeyType &key, const ValueType &value) {
+  IncludeKey<KeyType, ValueType>(key);
+  InsertSlot(GetSize(), key, value);
 }
 
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Remove half of key & value pairs from this page to "recipient" page. Both
+ * halves compress their keys anew, they may share more bytes than the whole
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
+  int keep = (GetSize() + 1) / 2;
+  recipient->CopyNFrom(this, keep, GetSize() - keep);
+  SetSize(keep);
+  CompactKeys<KeyType, ValueType>();
+  recipient->CompactKeys<KeyType, ValueType>();
+}
 
 /*
- * Copy starting from items, and copy {size} number of elements into me.
+ * Copy {size} entries of source, starting from begin, to the end of mine.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(const BPlusTreeLeafPage *source, int begin, int size) {
+  for (int i = begin; i < begin + size; i++) {
+    MappingType item = source->GetItem(i);
+    Append(item.first, item.second);
+  }
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -103,7 +184,12 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const {
-  return false;
+  int index = KeyIndex(key, comparator);
+  if (index == GetSize() || comparator(KeyAt(index), key) != 0) {
+    return false;
+  }
+  *value = SlotValue<KeyType, ValueType>(index);
+  return true;
 }
 
 /*****************************************************************************
@@ -116,17 +202,29 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
  * @return   page size after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) { return 0; }
+int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) {
+  int index = KeyIndex(key, comparator);
+  if (index == GetSize() || comparator(KeyAt(index), key) != 0) {
+    return GetSize();
+  }
+  RemoveSlots<KeyType, ValueType>(index, 1);
+  return GetSize();
+}
 
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 /*
- * Remove all of key & value pairs from this page to "recipient" page. Don't forget
- * to update the next_page id in the sibling page
+ * Remove all of key & value pairs from this page to "recipient" page, which
+ * must have room for them (see HasRoomForAllOf()). Don't forget to update the
+ * next_page id in the sibling page
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  recipient->CopyNFrom(this, 0, GetSize());
+  recipient->SetNextPageId(GetNextPageId());
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
@@ -135,25 +233,36 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {}
  * Remove the first key & value pair from this page to "recipient" page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyLastFrom(GetItem(0));
+  RemoveSlots<KeyType, ValueType>(0, 1);
+}
 
 /*
  * Copy the item into the end of my item list. (Append item to my array)
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
+  Append(item.first, item.second);
+}
 
 /*
  * Remove the last key & value pair from this page to "recipient" page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyFirstFrom(GetItem(GetSize() - 1));
+  IncreaseSize(-1);
+}
 
 /*
  * Insert item at the front of my items. Move items accordingly.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
+  IncludeKey<KeyType, ValueType>(item.first);
+  InsertSlot(0, item.first, item.second);
+}
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
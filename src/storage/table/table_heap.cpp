@@ -13,20 +13,22 @@
 #include <cassert>
 
 #include "common/logger.h"
+#include "concurrency/transaction_manager.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     page_id_t first_page_id)
+                     page_id_t first_page_id, table_oid_t oid)
     : buffer_pool_manager_(buffer_pool_manager),
       lock_manager_(lock_manager),
       log_manager_(log_manager),
-      first_page_id_(first_page_id) {}
+      first_page_id_(first_page_id),
+      oid_(oid) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
-    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
+                     Transaction *txn, table_oid_t oid)
+    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager), oid_(oid) {
   // Initialize the first table page.
   auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
@@ -36,12 +38,22 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
+TableHeap::~TableHeap() {
+  if (txn_manager_ != nullptr) {
+    txn_manager_->ForgetTable(this);
+  }
+}
+
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
+  if (tuple.size_ + 36 > PAGE_SIZE) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
+  // the table lock, which may have to wait for others, is taken before any page is latched
+  if (enable_logging && !lock_manager_->LockTable(txn, LockMode::INTENTION_EXCLUSIVE, oid_)) {
+    return false;
+  }
   auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
@@ -51,7 +63,7 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
   cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
+  while (!cur_page->InsertTuple(tuple, rid, txn, log_manager_)) {
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
@@ -81,6 +93,9 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       cur_page = new_page;
     }
   }
+  bool locked = LockRow(*rid, LockMode::EXCLUSIVE, txn);
+  BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
+  versions_.RecordWrite(*rid, txn, nullptr);
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
@@ -92,6 +107,9 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
 
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   // TODO(Amadou): remove empty page
+  if (!LockRow(rid, LockMode::EXCLUSIVE, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -101,7 +119,14 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   }
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  if (!CheckWrite(page, rid, txn)) {
+    return false;
+  }
+  Tuple old_tuple;
+  bool had_tuple = page->ReadTuple(rid, &old_tuple);
+  if (page->MarkDelete(rid, txn, log_manager_)) {
+    versions_.RecordWrite(rid, txn, had_tuple ? &old_tuple : nullptr);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
   // Update the transaction's write set.
@@ -110,6 +135,9 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
 }
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
+  if (!LockRow(rid, LockMode::EXCLUSIVE, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -120,7 +148,13 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  if (!CheckWrite(page, rid, txn)) {
+    return false;
+  }
+  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, log_manager_);
+  if (is_updated) {
+    versions_.RecordWrite(rid, txn, &old_tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
@@ -134,10 +168,14 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  BUSTUB_ASSERT(!enable_logging || txn->IsRowLocked(oid_, rid, LockMode::EXCLUSIVE), "We must own the exclusive lock!");
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
-  lock_manager_->Unlock(txn, rid);
+  // A rolled back insert leaves no version behind. It is dropped before another insert can take the freed slot. After
+  // a commit this does nothing, the commit has already stamped the version.
+  versions_.Abort(rid, txn);
+  lock_manager_->UnlockRow(txn, oid_, rid);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
@@ -146,6 +184,8 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  BUSTUB_ASSERT(!enable_logging || txn->IsRowLocked(oid_, rid, LockMode::EXCLUSIVE),
+                "We must own an exclusive lock on the RID.");
   // Rollback the delete.
   page->WLatch();
   page->RollbackDelete(rid, txn, log_manager_);
@@ -154,6 +194,9 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 }
 
 bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+  if (!txn->ReadsWithoutLocks() && !LockRow(rid, LockMode::SHARED, txn)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -161,9 +204,15 @@ bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  // Read the tuple from the page.
+  // Read the tuple from the page, unless a lock-free reader must see an older version.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res;
+  if (!txn->ReadsWithoutLocks() || !versions_.Read(rid, txn, tuple, &res)) {
+    res = page->GetTuple(rid, tuple, txn);
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+    (*txn->GetReadSet())[this].insert(rid);
+  }
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
   return res;
@@ -174,11 +223,16 @@ TableIterator TableHeap::Begin(Transaction *txn) {
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
   RID rid;
   auto page_id = first_page_id_;
+  // A lock-free reader may still see tuples that are deleted on the page.
+  bool all_slots = txn != nullptr && txn->ReadsWithoutLocks();
+  if (txn != nullptr && txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+    txn->GetScanSet()->insert(this);
+  }
   while (page_id != INVALID_PAGE_ID) {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    auto found_tuple = page->GetFirstTupleRid(&rid, all_slots);
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
@@ -189,6 +243,25 @@ TableIterator TableHeap::Begin(Transaction *txn) {
   return TableIterator(this, rid, txn);
 }
 
+bool TableHeap::CheckWrite(TablePage *page, const RID &rid, Transaction *txn) {
+  // Lock-based writers are kept apart by their exclusive locks, a snapshot writer must not overwrite a newer version.
+  if (txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION || versions_.CanWrite(rid, txn)) {
+    return true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+  txn->SetState(TransactionState::ABORTED);
+  return false;
+}
+
+bool TableHeap::LockRow(const RID &rid, LockMode lock_mode, Transaction *txn) {
+  // rolling back under an aborted state finds its rows locked already
+  if (!enable_logging || txn->IsRowLocked(oid_, rid, lock_mode)) {
+    return true;
+  }
+  return lock_manager_->LockRow(txn, lock_mode, oid_, rid);
+}
+
 TableIterator TableHeap::End() { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
 
 }  // namespace bustub
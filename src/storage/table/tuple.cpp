@@ -26,8 +26,12 @@ Tuple::Tuple(std::vector<Value> values, const Schema *schema) : allocated_(true)
 
   // 1. Calculate the size of the tuple.
   uint32_t tuple_size = schema->GetLength();
+  // a NULL varchar is its length alone
+  auto varlen_size = [](const Value &value) {
+    return (value.IsNull() ? 0 : value.GetLength()) + static_cast<uint32_t>(sizeof(uint32_t));
+  };
   for (auto &i : schema->GetUnlinedColumns()) {
-    tuple_size += (values[i].GetLength() + sizeof(uint32_t));
+    tuple_size += varlen_size(values[i]);
   }
 
   // 2. Allocate memory.
@@ -46,7 +50,7 @@ Tuple::Tuple(std::vector<Value> values, const Schema *schema) : allocated_(true)
       *reinterpret_cast<uint32_t *>(data_ + col.GetOffset()) = offset;
       // Serialize varchar value, in place (size+data).
       values[i].SerializeTo(data_ + offset);
-      offset += (values[i].GetLength() + sizeof(uint32_t));
+      offset += varlen_size(values[i]);
     } else {
       values[i].SerializeTo(data_ + col.GetOffset());
     }
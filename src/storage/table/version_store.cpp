@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/storage/table/version_store.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/version_store.h"
+
+#include <limits>
+
+namespace bustub {
+
+bool VersionStore::CanWrite(const RID &rid, Transaction *txn) {
+  std::scoped_lock latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ == txn->GetTransactionId()) {
+    return true;
+  }
+  if (chain->second.writer_ != INVALID_TXN_ID) {
+    return false;
+  }
+  return txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION ||
+         chain->second.head_begin_ts_ <= txn->GetReadTs();
+}
+
+void VersionStore::RecordWrite(const RID &rid, Transaction *txn, const Tuple *before) {
+  std::scoped_lock latch(latch_);
+  VersionChain &chain = chains_[rid];
+  // Only the first write saves an image. Writers are kept apart by locks or CanWrite, except when locking is off (no
+  // logging), where they are not isolated from each other anyway.
+  if (chain.writer_ != INVALID_TXN_ID) {
+    return;
+  }
+  chain.versions_.push_front({before != nullptr ? *before : Tuple{}, before != nullptr, chain.head_begin_ts_,
+                              INVALID_TS});
+  chain.writer_ = txn->GetTransactionId();
+}
+
+void VersionStore::Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts) {
+  std::scoped_lock latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ != txn->GetTransactionId()) {
+    return;
+  }
+  chain->second.versions_.front().end_ts_ = commit_ts;
+  chain->second.head_begin_ts_ = commit_ts;
+  chain->second.writer_ = INVALID_TXN_ID;
+}
+
+void VersionStore::Abort(const RID &rid, Transaction *txn) {
+  std::scoped_lock latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ != txn->GetTransactionId()) {
+    return;
+  }
+  chain->second.head_begin_ts_ = chain->second.versions_.front().begin_ts_;
+  chain->second.versions_.pop_front();
+  chain->second.writer_ = INVALID_TXN_ID;
+}
+
+bool VersionStore::Read(const RID &rid, Transaction *txn, Tuple *tuple, bool *exists) {
+  std::scoped_lock latch(latch_);
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ == txn->GetTransactionId()) {
+    return false;
+  }
+  // an optimistic transaction reads the latest committed version, and finds out at commit if it was overwritten since
+  timestamp_t read_ts = txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC ? std::numeric_limits<timestamp_t>::max()
+                                                                               : txn->GetReadTs();
+  if (chain->second.writer_ == INVALID_TXN_ID && chain->second.head_begin_ts_ <= read_ts) {
+    return false;
+  }
+  // before-images are ordered by decreasing begin timestamp, the first one old enough is the visible one
+  for (const TupleVersion &version : chain->second.versions_) {
+    if (version.begin_ts_ <= read_ts) {
+      *exists = version.exists_;
+      if (version.exists_) {
+        *tuple = version.tuple_;
+      }
+      return true;
+    }
+  }
+  *exists = false;
+  return true;
+}
+
+void VersionStore::CollectGarbage(timestamp_t watermark) {
+  std::scoped_lock latch(latch_);
+  for (auto chain = chains_.begin(); chain != chains_.end();) {
+    auto &versions = chain->second.versions_;
+    // a snapshot at or after the end of a version sees a newer one
+    while (!versions.empty() && versions.back().end_ts_ != INVALID_TS && versions.back().end_ts_ <= watermark) {
+      versions.pop_back();
+    }
+    if (versions.empty() && chain->second.writer_ == INVALID_TXN_ID && chain->second.head_begin_ts_ <= watermark) {
+      chain = chains_.erase(chain);
+    } else {
+      ++chain;
+    }
+  }
+}
+
+size_t VersionStore::VersionCount() {
+  std::scoped_lock latch(latch_);
+  size_t count = 0;
+  for (const auto &[rid, chain] : chains_) {
+    count += chain.versions_.size();
+  }
+  return count;
+}
+
+}  // namespace bustub
@@ -688,4 +688,66 @@ TEST(CatalogTest, DISABLED_IndexInteraction3) {
   remove("catalog_test.log");
 }
 
+
+// Should be able to create ordered indexes of either kind over the rows already in the table
+TEST(CatalogTest, DISABLED_IndexTypes) {
+  for (IndexType index_type : {IndexType::B_PLUS_TREE, IndexType::ADAPTIVE_RADIX_TREE}) {
+    auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+    auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+    auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+    auto txn = std::make_unique<Transaction>(0);
+
+    const std::string table_name{"foobar"};
+    const std::string index_name{"index1"};
+
+    // Construct a new table with two rows per key
+    std::vector<Column> columns{{"A", TypeId::INTEGER}, {"B", TypeId::INTEGER}};
+    Schema table_schema{columns};
+    auto *table_info = catalog->CreateTable(nullptr, table_name, table_schema);
+    EXPECT_NE(Catalog::NULL_TABLE_INFO, table_info);
+    for (int32_t i = 0; i < 100; i++) {
+      Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(i / 2), ValueFactory::GetIntegerValue(i)},
+                  &table_schema};
+      RID rid;
+      ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+    }
+
+    // A non-unique index on A that includes B
+    std::vector<Column> key_columns{{"A", TypeId::INTEGER}};
+    std::vector<uint32_t> key_attrs{0};
+    Schema key_schema{key_columns};
+    auto *index_info = catalog->CreateIndex<GenericKey<32>, RID, GenericComparator<32>>(
+        txn.get(), index_name, table_name, table_schema, key_schema, key_attrs, 32, HashFunction<GenericKey<32>>{},
+        index_type, false, {1});
+    ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+    auto *index = index_info->index_.get();
+    ASSERT_TRUE(index->StoresCoveredColumns());
+
+    // Both rows of a key
+    Tuple key{std::vector<Value>{ValueFactory::GetIntegerValue(7)}, &key_schema};
+    std::vector<RID> results{};
+    index->ScanKey(key, &results, txn.get());
+    ASSERT_EQ(2, results.size());
+
+    // The entries of keys [10, 20) in key order
+    Tuple low{std::vector<Value>{ValueFactory::GetIntegerValue(10)}, &key_schema};
+    Tuple high{std::vector<Value>{ValueFactory::GetIntegerValue(20)}, &key_schema};
+    auto scan = index->ScanRange(&low, true, &high, false, txn.get());
+    std::vector<RID> rids;
+    std::vector<Tuple> entries;
+    int32_t expected = 20;
+    while (scan->NextEntries(&rids, &entries)) {
+      for (const Tuple &entry : entries) {
+        EXPECT_EQ(expected / 2, entry.GetValue(index->GetCoveredSchema(), 0).GetAs<int32_t>());
+        EXPECT_EQ(expected, entry.GetValue(index->GetCoveredSchema(), 1).GetAs<int32_t>());
+        expected++;
+      }
+    }
+    EXPECT_EQ(40, expected);
+
+    remove("catalog_test.db");
+    remove("catalog_test.log");
+  }
+}
+
 }  // namespace bustub
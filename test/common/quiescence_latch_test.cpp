@@ -0,0 +1,50 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// quiescence_latch_test.cpp
+//
+// Identification: test/common/quiescence_latch_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/quiescence_latch.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(QuiescenceLatchTest, BlockTest) {
+  QuiescenceLatch latch;
+  std::atomic<int> inside{0};
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([&]() {
+      while (!stop) {
+        latch.Enter(std::this_thread::get_id());
+        inside++;
+        inside--;
+        latch.Exit(std::this_thread::get_id());
+      }
+    });
+  }
+  for (int round = 0; round < 100; round++) {
+    latch.Block();
+    // nobody runs while the latch is blocked
+    EXPECT_EQ(inside.load(), 0);
+    latch.Resume();
+  }
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace bustub
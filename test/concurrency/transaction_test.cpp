@@ -157,8 +157,8 @@ void CheckAborted(Transaction *txn) { EXPECT_EQ(txn->GetState(), TransactionStat
 void CheckCommitted(Transaction *txn) { EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED); }
 
 void CheckTxnLockSize(Transaction *txn, size_t shared_size, size_t exclusive_size) {
-  EXPECT_EQ(txn->GetSharedLockSet()->size(), shared_size);
-  EXPECT_EQ(txn->GetExclusiveLockSet()->size(), exclusive_size);
+  EXPECT_EQ(txn->GetSharedLockSet()->Size(), shared_size);
+  EXPECT_EQ(txn->GetExclusiveLockSet()->Size(), exclusive_size);
 }
 
 // NOLINTNEXTLINE
@@ -253,4 +253,118 @@ TEST_F(TransactionTest, DISABLED_DirtyReadsTest) {
   delete txn2;
 }
 
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, DISABLED_OptimisticValidationTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  TableHeap *table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  Tuple tuple{{ValueFactory::GetIntegerValue(200), ValueFactory::GetIntegerValue(20)}, &schema};
+  RID rid;
+  auto txn0 = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn0));
+  ASSERT_TRUE(GetTxnManager()->Commit(txn0));
+  delete txn0;
+
+  // txn1 reads the tuple, txn2 overwrites it and commits first
+  auto txn1 = GetTxnManager()->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  auto txn2 = GetTxnManager()->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  Tuple result;
+  ASSERT_TRUE(table->GetTuple(rid, &result, txn1));
+  Tuple new_tuple{{ValueFactory::GetIntegerValue(201), ValueFactory::GetIntegerValue(21)}, &schema};
+  ASSERT_TRUE(table->UpdateTuple(new_tuple, rid, txn2));
+  // the write of txn2 is not committed yet, txn1 keeps reading the committed tuple
+  ASSERT_TRUE(table->GetTuple(rid, &result, txn1));
+  EXPECT_EQ(result.GetValue(&schema, 0).GetAs<int32_t>(), 200);
+  EXPECT_TRUE(GetTxnManager()->Commit(txn2));
+  EXPECT_FALSE(GetTxnManager()->Commit(txn1));
+  CheckAborted(txn1);
+  delete txn1;
+  delete txn2;
+
+  // txn3 scans the table, txn4 inserts into it and commits first
+  auto txn3 = GetTxnManager()->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  auto txn4 = GetTxnManager()->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  size_t count = 0;
+  for (auto iter = table->Begin(txn3); iter != table->End(); ++iter) {
+    count++;
+  }
+  EXPECT_EQ(count, 1);
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn4));
+  EXPECT_TRUE(GetTxnManager()->Commit(txn4));
+  EXPECT_FALSE(GetTxnManager()->Commit(txn3));
+  delete txn3;
+  delete txn4;
+
+  // txn5 began after every conflicting commit
+  auto txn5 = GetTxnManager()->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  ASSERT_TRUE(table->GetTuple(rid, &result, txn5));
+  EXPECT_TRUE(GetTxnManager()->Commit(txn5));
+  CheckCommitted(txn5);
+  delete txn5;
+}
+
+// Validation only compares read and scan sets with committed writes, so it runs on a heap whose pages are never read
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, OptimisticValidationTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(1)}, &schema};
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager);
+  TableHeap table(nullptr, &lock_manager, nullptr, INVALID_PAGE_ID);
+  RID rid{0, 0};
+  auto commit_write = [&](WType wtype) {
+    Transaction *writer = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+    writer->AppendTableWriteRecord(TableWriteRecord(rid, wtype, tuple, &table));
+    EXPECT_TRUE(txn_mgr.Commit(writer));
+    delete writer;
+  };
+  auto run_read_only = [&]() {
+    for (int i = 0; i < MVCC_GC_INTERVAL; i++) {
+      Transaction *txn = txn_mgr.Begin();
+      txn_mgr.Commit(txn);
+      delete txn;
+    }
+  };
+
+  // txn0 read rid, which a transaction that began later overwrote and committed first
+  Transaction *txn0 = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  (*txn0->GetReadSet())[&table].insert(rid);
+  commit_write(WType::UPDATE);
+  EXPECT_FALSE(txn_mgr.Commit(txn0));
+  CheckAborted(txn0);
+  delete txn0;
+
+  // txn1 scanned the table, which a transaction that began later inserted into
+  Transaction *txn1 = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  txn1->GetScanSet()->insert(&table);
+  commit_write(WType::INSERT);
+  EXPECT_FALSE(txn_mgr.Commit(txn1));
+  delete txn1;
+
+  // txn2 began after every conflicting commit, txn3 read a tuple nobody wrote since
+  Transaction *txn2 = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  (*txn2->GetReadSet())[&table].insert(rid);
+  txn2->GetScanSet()->insert(&table);
+  EXPECT_TRUE(txn_mgr.Commit(txn2));
+  CheckCommitted(txn2);
+  delete txn2;
+  Transaction *txn3 = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  (*txn3->GetReadSet())[&table].insert(RID{0, 1});
+  commit_write(WType::UPDATE);
+  EXPECT_TRUE(txn_mgr.Commit(txn3));
+  delete txn3;
+  EXPECT_EQ(txn_mgr.CommittedWriteCount(), 3);
+
+  // the commits before every running optimistic transaction are trimmed, the one txn4 may conflict with is kept
+  Transaction *txn4 = txn_mgr.Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  (*txn4->GetReadSet())[&table].insert(rid);
+  commit_write(WType::UPDATE);
+  run_read_only();
+  EXPECT_EQ(txn_mgr.CommittedWriteCount(), 1);
+  EXPECT_FALSE(txn_mgr.Commit(txn4));
+  delete txn4;
+  run_read_only();
+  EXPECT_EQ(txn_mgr.CommittedWriteCount(), 0);
+}
+
 }  // namespace bustub
@@ -0,0 +1,179 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree_test.cpp
+//
+// Identification: test/container/adaptive_radix_tree_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "container/art/adaptive_radix_tree.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+using ArtType = AdaptiveRadixTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+/** @return a key that sorts bytewise like value */
+GenericKey<8> ArtKey(uint64_t value) {
+  GenericKey<8> key;
+  for (int i = 0; i < 8; i++) {
+    key.data_[i] = static_cast<char>(value >> (56 - 8 * i));
+  }
+  return key;
+}
+
+/** @return the keys in [low, high] read in batches of batch_size, like a range scan of an index does */
+std::vector<uint64_t> ScanKeys(ArtType *tree, uint64_t low, uint64_t high, size_t batch_size) {
+  std::vector<uint64_t> keys;
+  GenericKey<8> low_key = ArtKey(low);
+  GenericKey<8> high_key = ArtKey(high);
+  std::vector<std::pair<GenericKey<8>, RID>> batch;
+  while (true) {
+    batch.clear();
+    bool more = tree->ScanRange(low_key, high_key, batch_size, &batch);
+    for (const auto &entry : batch) {
+      uint64_t key = 0;
+      for (int i = 0; i < 8; i++) {
+        key = (key << 8) | static_cast<uint8_t>(entry.first.data_[i]);
+      }
+      EXPECT_EQ(entry.second.GetSlotNum(), static_cast<uint32_t>(key));
+      keys.push_back(key);
+    }
+    if (!more) {
+      return keys;
+    }
+    low_key = batch.back().first;
+    if (!low_key.StepUp()) {
+      return keys;
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(AdaptiveRadixTreeTest, RandomTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), true);
+  ArtType tree(comparator);
+  std::map<uint64_t, RID> expected;
+
+  // masks leave keys sharing long prefixes, and nodes of every size
+  std::mt19937_64 random(0);
+  const uint64_t masks[] = {0xff, 0xffff, 0x0f0f00ff, 0x00ff0000000000ff, 0xffffffffffffffff};
+  for (int round = 0; round < 20000; round++) {
+    uint64_t key = random() & masks[round / 100 % 5];
+    RID rid(0, static_cast<uint32_t>(key));
+    if (random() % 3 != 0) {
+      EXPECT_EQ(tree.Insert(ArtKey(key), rid), expected.emplace(key, rid).second);
+    } else {
+      EXPECT_EQ(tree.Remove(ArtKey(key)), expected.erase(key) == 1);
+    }
+
+    std::vector<RID> values;
+    uint64_t probe = random() & masks[random() % 5];
+    EXPECT_EQ(tree.GetValue(ArtKey(probe), &values), expected.count(probe) == 1);
+    EXPECT_EQ(values.size(), expected.count(probe));
+
+    if (round % 50 == 0) {
+      uint64_t low = random() & masks[random() % 5];
+      uint64_t high = low + (random() & masks[random() % 5]);
+      if (high < low) {
+        high = UINT64_MAX;
+      }
+      std::vector<uint64_t> range;
+      for (auto entry = expected.lower_bound(low); entry != expected.end() && entry->first <= high; ++entry) {
+        range.push_back(entry->first);
+      }
+      EXPECT_EQ(ScanKeys(&tree, low, high, 1 + random() % 64), range);
+    }
+  }
+
+  std::vector<uint64_t> all;
+  for (const auto &entry : expected) {
+    all.push_back(entry.first);
+  }
+  EXPECT_EQ(ScanKeys(&tree, 0, UINT64_MAX, 100), all);
+  for (uint64_t key : all) {
+    EXPECT_TRUE(tree.Remove(ArtKey(key)));
+  }
+  EXPECT_TRUE(ScanKeys(&tree, 0, UINT64_MAX, 100).empty());
+}
+
+// NOLINTNEXTLINE
+TEST(AdaptiveRadixTreeTest, ConcurrentTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), true);
+  ArtType tree(comparator);
+
+  // every writer owns the keys equal to its id modulo the number of writers, the even ones of which it keeps
+  const int writer_count = 4;
+  const uint64_t key_count = 20000;
+  // distinct keys, which spread over the third byte
+  auto key_of = [](uint64_t i) { return (i & 0xff) << 40 | i >> 8; };
+  std::vector<std::thread> threads;
+  for (int writer = 0; writer < writer_count; writer++) {
+    threads.emplace_back([&, writer] {
+      for (int pass = 0; pass < 3; pass++) {
+        for (uint64_t i = writer; i < key_count; i += writer_count) {
+          uint64_t key = key_of(i);
+          tree.Insert(ArtKey(key), RID(0, static_cast<uint32_t>(key)));
+        }
+        for (uint64_t i = writer; i < key_count; i += writer_count) {
+          uint64_t key = key_of(i);
+          if (i % 2 == 1 || pass < 2) {
+            EXPECT_TRUE(tree.Remove(ArtKey(key)));
+          }
+        }
+      }
+    });
+  }
+  // readers check that scans come out in key order while the tree changes under them
+  std::atomic<bool> writing{true};
+  for (int reader = 0; reader < 2; reader++) {
+    threads.emplace_back([&] {
+      while (writing) {
+        std::vector<uint64_t> keys = ScanKeys(&tree, 0, UINT64_MAX, 64);
+        for (size_t i = 1; i < keys.size(); i++) {
+          EXPECT_LT(keys[i - 1], keys[i]);
+        }
+        std::vector<RID> values;
+        tree.GetValue(ArtKey(0), &values);
+      }
+    });
+  }
+  for (int writer = 0; writer < writer_count; writer++) {
+    threads[writer].join();
+  }
+  writing = false;
+  for (auto &thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  std::map<uint64_t, bool> expected;
+  for (uint64_t i = 0; i < key_count; i += 2) {
+    expected[key_of(i)] = true;
+  }
+  std::vector<uint64_t> all;
+  for (const auto &entry : expected) {
+    all.push_back(entry.first);
+    std::vector<RID> values;
+    EXPECT_TRUE(tree.GetValue(ArtKey(entry.first), &values));
+  }
+  EXPECT_EQ(ScanKeys(&tree, 0, UINT64_MAX, 100), all);
+}
+
+}  // namespace bustub
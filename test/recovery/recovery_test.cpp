@@ -32,6 +32,7 @@ class RecoveryTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.master");
   }
 
   // This function is called after every test.
@@ -39,6 +40,7 @@ class RecoveryTest : public ::testing::Test {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
     remove("test.log");
+    remove("test.master");
   };
 };
 
@@ -247,14 +249,25 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   }
   bustub_instance->transaction_manager_->Commit(txn1);
 
-  // Do checkpoint
+  // Do checkpoint, transactions keep running while it is in progress
   bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  Transaction *txn2 = bustub_instance->transaction_manager_->Begin();
+  RID rid2;
+  EXPECT_TRUE(test_table->InsertTuple(tuple, &rid2, txn2));
+  bustub_instance->transaction_manager_->Commit(txn2);
   bustub_instance->checkpoint_manager_->EndCheckpoint();
 
   // Hacky
   Page *pages = dynamic_cast<BufferPoolManagerInstance *>(bustub_instance->buffer_pool_manager_)->GetPages();
   size_t pool_size = bustub_instance->buffer_pool_manager_->GetPoolSize();
 
+  // the checkpoint completed and left a master record behind
+  size_t redo_offset;
+  EXPECT_TRUE(bustub_instance->disk_manager_->ReadMasterRecord(&redo_offset));
+
+  // dirty pages are written out by the background writer, force all of them out here
+  bustub_instance->checkpoint_manager_->WriteDirtyPages(pool_size);
+
   // make sure that all pages in the buffer pool are marked as non-dirty
   bool all_pages_clean = true;
   for (size_t i = 0; i < pool_size; i++) {
@@ -309,6 +322,7 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
 
   delete txn;
   delete txn1;
+  delete txn2;
   delete test_table;
 
   LOG_INFO("Shutdown System");
@@ -10,10 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
 #include <thread>  // NOLINT
+#include <utility>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -333,4 +335,152 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, DISABLED_KeyLockHookTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // small leaves, so that the scan crosses several of them
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  std::vector<int64_t> keys;
+  for (int64_t key = 2; key <= 20; key += 2) {
+    keys.push_back(key);
+  }
+  InsertHelper(&tree, keys);
+
+  // every key read is locked, then the one past the range, 0 standing for the end of the index
+  std::vector<int64_t> locked;
+  auto lock_all = [&](const GenericKey<8> *key) {
+    locked.push_back(key != nullptr ? key->ToString() : 0);
+    return true;
+  };
+  GenericKey<8> low;
+  GenericKey<8> high;
+  std::vector<std::pair<GenericKey<8>, RID>> rids;
+  low.SetFromInteger(5);
+  high.SetFromInteger(11);
+  EXPECT_TRUE(tree.ScanRange(low, high, &rids, lock_all));
+  EXPECT_EQ(rids.size(), 3);
+  EXPECT_EQ(locked, (std::vector<int64_t>{6, 8, 10, 12}));
+
+  // a range ending on a key stops there
+  locked.clear();
+  rids.clear();
+  high.SetFromInteger(10);
+  EXPECT_TRUE(tree.ScanRange(low, high, &rids, lock_all));
+  EXPECT_EQ(locked, (std::vector<int64_t>{6, 8, 10}));
+
+  locked.clear();
+  rids.clear();
+  low.SetFromInteger(19);
+  high.SetFromInteger(30);
+  EXPECT_TRUE(tree.ScanRange(low, high, &rids, lock_all));
+  EXPECT_EQ(locked, (std::vector<int64_t>{20, 0}));
+
+  // a failing hook leaves the tree and the result alone
+  auto lock_none = [&](const GenericKey<8> *key) {
+    locked.push_back(key != nullptr ? key->ToString() : 0);
+    return false;
+  };
+  locked.clear();
+  rids.clear();
+  EXPECT_FALSE(tree.ScanRange(low, high, &rids, lock_none));
+  EXPECT_TRUE(rids.empty());
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(7);
+  EXPECT_FALSE(tree.Insert(index_key, RID(0, 7), nullptr, lock_none));
+  EXPECT_EQ(locked.back(), 8);
+  index_key.SetFromInteger(20);
+  tree.Remove(index_key, nullptr, lock_none);
+  EXPECT_EQ(locked.back(), 0);
+  std::vector<RID> values;
+  EXPECT_TRUE(tree.GetValue(index_key, &values));
+  index_key.SetFromInteger(7);
+  EXPECT_FALSE(tree.GetValue(index_key, &values));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeConcurrentTest, DISABLED_LatchFreeReadTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(500, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  // tiny pages, so that the writers split and merge all the time
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+
+  // the even keys stay put, the writers insert and remove the odd ones around them
+  const int64_t total = 2000;
+  std::vector<int64_t> even_keys;
+  for (int64_t key = 0; key < total; key += 2) {
+    even_keys.push_back(key);
+  }
+  InsertHelper(&tree, even_keys);
+
+  std::atomic<bool> stop{false};
+  std::atomic<int> missed{0};
+  auto writer = [&](int64_t first) {
+    GenericKey<8> index_key;
+    for (int round = 0; round < 5; round++) {
+      for (int64_t key = first; key < total; key += 4) {
+        index_key.SetFromInteger(key);
+        tree.Insert(index_key, RID(0, key));
+      }
+      for (int64_t key = first; key < total; key += 4) {
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key);
+      }
+    }
+  };
+  std::thread reader([&]() {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    while (!stop) {
+      for (int64_t key : even_keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids) || rids[0].GetSlotNum() != key) {
+          missed++;
+        }
+      }
+      // an iterator sees every even key, once and in order, whatever moves around it
+      int64_t next = 0;
+      for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+        int64_t key = (*iterator).second.GetSlotNum();
+        if (key % 2 == 0) {
+          missed += key == next ? 0 : 1;
+          next = key + 2;
+        }
+      }
+      missed += next == total ? 0 : 1;
+    }
+  });
+  std::thread writer1(writer, 1);
+  std::thread writer3(writer, 3);
+  writer1.join();
+  writer3.join();
+  stop = true;
+  reader.join();
+  EXPECT_EQ(missed.load(), 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
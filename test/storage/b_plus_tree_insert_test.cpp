@@ -145,4 +145,65 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, DISABLED_BulkLoadTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+  // even keys only, spread over several levels of small pages
+  const int64_t count = 1000;
+  int64_t next_key = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *pair) {
+    if (next_key == count * 2) {
+      return false;
+    }
+    pair->first.SetFromInteger(next_key);
+    pair->second.Set(0, next_key);
+    next_key += 2;
+    return true;
+  };
+  EXPECT_TRUE(tree.BulkLoad(next, count, 0.75));
+  // only an empty tree can be bulk loaded
+  EXPECT_FALSE(tree.BulkLoad(next, 0));
+
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < count * 2; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(tree.GetValue(index_key, &rids), key % 2 == 0);
+  }
+
+  // the tree is a regular one: fill in the odd keys, then remove everything but the multiples of four
+  for (int64_t key = 1; key < count * 2; key += 2) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key)));
+  }
+  for (int64_t key = 0; key < count * 2; key++) {
+    if (key % 4 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+    }
+  }
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += 4;
+  }
+  EXPECT_EQ(current_key, count * 2);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <sys/stat.h>
 #include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,14 +27,21 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   };
+
+  void RemoveLogSegments() {
+    remove("test.log");
+    for (int i = 1; i <= 4; i++) {
+      remove(("test.log." + std::to_string(i)).c_str());
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -73,6 +84,65 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
 }
 
 // NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  std::vector<char> first(LOG_SEGMENT_SIZE - 8, 'a');
+  std::vector<char> second(24, 'b');
+  uint64_t segment_no = 1;
+  std::memcpy(second.data() + 8, &segment_no, sizeof(segment_no));
+  char buf[16] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // the second write crosses into segment 1, which it starts with the segment header
+  dm.WriteLog(first.data(), first.size());
+  dm.WriteLog(second.data(), second.size());
+  EXPECT_EQ(LOG_SEGMENT_SIZE + 16, dm.GetLogEndOffset());
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), LOG_SEGMENT_SIZE - 8));
+  EXPECT_EQ(std::memcmp(buf, second.data(), sizeof(buf)), 0);
+  EXPECT_FALSE(dm.ReadLog(buf, sizeof(buf), LOG_SEGMENT_SIZE + 16));
+
+  // segment 0 is recycled as the first spare segment after the one being written, keeping its blocks
+  dm.TruncateLog(LOG_SEGMENT_SIZE);
+  struct stat stat_buf;
+  EXPECT_NE(0, stat("test.log", &stat_buf));
+  ASSERT_EQ(0, stat("test.log.2", &stat_buf));
+  EXPECT_EQ(LOG_SEGMENT_SIZE, stat_buf.st_size);
+  std::ifstream spare("test.log.2", std::ios::binary);
+  spare.read(buf, 8);
+  EXPECT_EQ(std::memcmp(buf, first.data(), 8), 0);
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), LOG_SEGMENT_SIZE));
+  EXPECT_EQ(std::memcmp(buf, second.data() + 8, sizeof(buf)), 0);
+  dm.ShutDown();
+
+  // appending resumes at the segment after the last one holding data, the spare still carries its old header
+  auto restarted = DiskManager(db_file);
+  EXPECT_EQ(2 * LOG_SEGMENT_SIZE, restarted.GetLogEndOffset());
+  EXPECT_TRUE(restarted.ReadLog(buf, sizeof(buf), LOG_SEGMENT_SIZE - 8));
+  EXPECT_EQ(std::memcmp(buf, std::string(8, 0).data(), 8), 0);
+  EXPECT_EQ(std::memcmp(buf + 8, second.data() + 8, 8), 0);
+  restarted.ShutDown();
+}
+
+TEST_F(DiskManagerTest, MapLogSegmentTest) {
+  char data[16] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  size_t size;
+  EXPECT_EQ(nullptr, dm.MapLogSegment(0, &size));  // nothing written yet
+
+  dm.WriteLog(data, sizeof(data));
+  const char *segment = dm.MapLogSegment(0, &size);
+  ASSERT_NE(nullptr, segment);
+  EXPECT_EQ(LOG_SEGMENT_SIZE, size);
+  EXPECT_EQ(std::memcmp(segment, data, sizeof(data)), 0);
+  dm.UnmapLogSegment(segment, size);
+  EXPECT_EQ(nullptr, dm.MapLogSegment(1, &size));
+
+  dm.ShutDown();
+}
+
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
 }  // namespace bustub
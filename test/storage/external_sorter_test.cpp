@@ -0,0 +1,64 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter_test.cpp
+//
+// Identification: test/storage/external_sorter_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/index/external_sorter.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+void SortKeys(size_t buffer_size) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  ExternalSorter<GenericKey<8>, RID, GenericComparator<8>> sorter(comparator, buffer_size);
+
+  // every key twice, the first time with page id 0
+  const int64_t count = 1000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < count; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  GenericKey<8> index_key;
+  for (int page_id = 0; page_id < 2; page_id++) {
+    for (int64_t key : keys) {
+      index_key.SetFromInteger(key);
+      sorter.Add(index_key, RID(page_id, key));
+    }
+  }
+
+  EXPECT_EQ(sorter.Finish(), count);
+  std::pair<GenericKey<8>, RID> pair;
+  int64_t expected = 0;
+  while (sorter.Next(&pair)) {
+    EXPECT_EQ(pair.second.GetSlotNum(), expected);
+    EXPECT_EQ(pair.second.GetPageId(), 0);
+    expected++;
+  }
+  EXPECT_EQ(expected, count);
+}
+
+// NOLINTNEXTLINE
+TEST(ExternalSorterTest, InMemoryTest) { SortKeys(SORT_BUFFER_SIZE); }
+
+// NOLINTNEXTLINE
+TEST(ExternalSorterTest, SpillTest) {
+  // 64 pairs per run
+  SortKeys(64 * sizeof(std::pair<GenericKey<8>, RID>));
+}
+
+}  // namespace bustub
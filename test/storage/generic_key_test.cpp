@@ -0,0 +1,310 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+TEST(GenericKeyTest, IntegerKeysCompareAsValues) {
+  auto key_schema = ParseCreateStatement("a integer,b smallint");
+  GenericComparator<8> comparator(key_schema.get());
+  EXPECT_EQ(0, comparator.IntegerKeyWidth());
+  EXPECT_EQ(8, GenericComparator<8>(ParseCreateStatement("a bigint").get()).IntegerKeyWidth());
+  EXPECT_EQ(0, GenericComparator<8>(ParseCreateStatement("a varchar(4)").get()).IntegerKeyWidth());
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> a_values(-5, 5);
+  std::uniform_int_distribution<int16_t> b_values(-300, 300);
+  for (int i = 0; i < 1000; i++) {
+    std::vector<Value> lhs_values{ValueFactory::GetIntegerValue(a_values(rng)),
+                                  ValueFactory::GetSmallIntValue(b_values(rng))};
+    std::vector<Value> rhs_values{ValueFactory::GetIntegerValue(a_values(rng)),
+                                  ValueFactory::GetSmallIntValue(b_values(rng))};
+    GenericKey<8> lhs;
+    GenericKey<8> rhs;
+    lhs.SetFromKey(Tuple(lhs_values, key_schema.get()));
+    rhs.SetFromKey(Tuple(rhs_values, key_schema.get()));
+
+    int expected = 0;
+    for (size_t column = 0; column < lhs_values.size() && expected == 0; column++) {
+      if (lhs_values[column].CompareLessThan(rhs_values[column]) == CmpBool::CmpTrue) {
+        expected = -1;
+      } else if (lhs_values[column].CompareGreaterThan(rhs_values[column]) == CmpBool::CmpTrue) {
+        expected = 1;
+      }
+    }
+    EXPECT_EQ(expected, comparator(lhs, rhs));
+  }
+}
+
+TEST(GenericKeyTest, IntegerKeySearchInPages) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  ASSERT_EQ(8, comparator.IntegerKeyWidth());
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int64_t> values(-100000, 100000);
+  std::vector<int64_t> keys;
+  GenericKey<8> index_key;
+
+  // the page memory, as the buffer pool would hand it out
+  std::vector<char> leaf_data(PAGE_SIZE);
+  auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(leaf_data.data());
+  leaf->Init(1);
+  while (keys.size() < 200) {
+    int64_t key = values(rng);
+    index_key.SetFromInteger(key);
+    if (std::find(keys.begin(), keys.end(), key) == keys.end() && leaf->HasRoomFor(index_key)) {
+      leaf->Insert(index_key, RID(0, 0), comparator);
+      keys.push_back(key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<char> internal_data(PAGE_SIZE);
+  auto *internal =
+      reinterpret_cast<BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>> *>(internal_data.data());
+  internal->Init(2);
+  index_key.SetFromInteger(keys[0]);
+  internal->PopulateNewRoot(0, index_key, 1);
+  for (size_t i = 1; i < 100; i++) {
+    index_key.SetFromInteger(keys[i]);
+    internal->InsertNodeAfter(static_cast<page_id_t>(i), index_key, static_cast<page_id_t>(i + 1));
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    int64_t probe = i % 2 == 0 ? values(rng) : keys[rng() % keys.size()];
+    index_key.SetFromInteger(probe);
+    auto lower = std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin();
+    EXPECT_EQ(lower, leaf->KeyIndex(index_key, comparator));
+    // child i + 1 holds the keys from keys[i] on
+    auto upper = std::upper_bound(keys.begin(), keys.begin() + 100, probe) - keys.begin();
+    EXPECT_EQ(upper, internal->Lookup(index_key, comparator));
+  }
+}
+
+TEST(GenericKeyTest, NormalizedKeysCompareAsBytes) {
+  auto key_schema = ParseCreateStatement("a integer,b varchar(8),c double");
+  GenericComparator<32> comparator(key_schema.get(), true);
+  EXPECT_TRUE(comparator.IsNormalized());
+  EXPECT_EQ(0, comparator.IntegerKeyWidth());
+
+  std::vector<Value> a_values{ValueFactory::GetNullValueByType(TypeId::INTEGER), ValueFactory::GetIntegerValue(-70000),
+                              ValueFactory::GetIntegerValue(-1), ValueFactory::GetIntegerValue(0),
+                              ValueFactory::GetIntegerValue(1), ValueFactory::GetIntegerValue(70000)};
+  std::vector<Value> b_values{ValueFactory::GetVarcharValue(""),  ValueFactory::GetVarcharValue("a"),
+                              ValueFactory::GetVarcharValue("ab"), ValueFactory::GetVarcharValue("abc"),
+                              ValueFactory::GetVarcharValue("b"),  ValueFactory::GetVarcharValue("\xff")};
+  std::vector<Value> c_values{ValueFactory::GetNullValueByType(TypeId::DECIMAL),
+                              ValueFactory::GetDecimalValue(-1e300),
+                              ValueFactory::GetDecimalValue(-2.5),
+                              ValueFactory::GetDecimalValue(-0.0),
+                              ValueFactory::GetDecimalValue(0.0),
+                              ValueFactory::GetDecimalValue(1e-300),
+                              ValueFactory::GetDecimalValue(3.75)};
+  std::vector<std::vector<Value> *> columns{&a_values, &b_values, &c_values};
+
+  std::mt19937 rng(0);
+  for (int i = 0; i < 2000; i++) {
+    std::vector<Value> lhs_values;
+    std::vector<Value> rhs_values;
+    for (auto *values : columns) {
+      lhs_values.push_back((*values)[rng() % values->size()]);
+      rhs_values.push_back((*values)[rng() % values->size()]);
+    }
+    GenericKey<32> lhs;
+    GenericKey<32> rhs;
+    lhs.SetFromKey(Tuple(lhs_values, key_schema.get()), key_schema.get());
+    rhs.SetFromKey(Tuple(rhs_values, key_schema.get()), key_schema.get());
+
+    // NULLs order first
+    int expected = 0;
+    for (size_t column = 0; column < columns.size() && expected == 0; column++) {
+      if (lhs_values[column].IsNull() || rhs_values[column].IsNull()) {
+        expected = static_cast<int>(rhs_values[column].IsNull()) - static_cast<int>(lhs_values[column].IsNull());
+      } else if (lhs_values[column].CompareLessThan(rhs_values[column]) == CmpBool::CmpTrue) {
+        expected = -1;
+      } else if (lhs_values[column].CompareGreaterThan(rhs_values[column]) == CmpBool::CmpTrue) {
+        expected = 1;
+      }
+    }
+    EXPECT_EQ(expected, comparator(lhs, rhs));
+  }
+}
+
+TEST(GenericKeyTest, NormalizedKeySearchInPages) {
+  auto key_schema = ParseCreateStatement("a integer,b varchar(8)");
+  // the last bytes of the keys ride along without being compared
+  GenericComparator<16> comparator(key_schema.get(), true, 12);
+  auto less = [&comparator](const GenericKey<16> &lhs, const GenericKey<16> &rhs) { return comparator(lhs, rhs) < 0; };
+
+  std::mt19937 rng(0);
+  std::vector<std::string> strings{"", "a", "ab", "abc", "abd", "b", "ba", "zzzzzzzz"};
+  auto random_key = [&] {
+    GenericKey<16> key;
+    std::vector<Value> values{ValueFactory::GetIntegerValue(static_cast<int32_t>(rng() % 4)),
+                              ValueFactory::GetVarcharValue(strings[rng() % strings.size()])};
+    key.SetFromKey(Tuple(values, key_schema.get()), key_schema.get());
+    return key;
+  };
+  std::vector<GenericKey<16>> keys;
+
+  std::vector<char> leaf_data(PAGE_SIZE);
+  auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>> *>(leaf_data.data());
+  leaf->Init(1);
+  for (int i = 0; i < 200; i++) {
+    GenericKey<16> key = random_key();
+    auto equal = [&](const GenericKey<16> &other) { return comparator(key, other) == 0; };
+    if (std::find_if(keys.begin(), keys.end(), equal) == keys.end() && leaf->HasRoomFor(key)) {
+      leaf->Insert(key, RID(0, 0), comparator);
+      keys.push_back(key);
+    }
+  }
+  std::sort(keys.begin(), keys.end(), less);
+  ASSERT_GT(keys.size(), 10);
+
+  std::vector<char> internal_data(PAGE_SIZE);
+  auto *internal =
+      reinterpret_cast<BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>> *>(internal_data.data());
+  internal->Init(2);
+  internal->PopulateNewRoot(0, keys[0], 1);
+  for (size_t i = 1; i < keys.size() / 2; i++) {
+    internal->InsertNodeAfter(static_cast<page_id_t>(i), keys[i], static_cast<page_id_t>(i + 1));
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    GenericKey<16> probe = i % 2 == 0 ? random_key() : keys[rng() % keys.size()];
+    auto lower = std::lower_bound(keys.begin(), keys.end(), probe, less) - keys.begin();
+    EXPECT_EQ(lower, leaf->KeyIndex(probe, comparator));
+    auto upper = std::upper_bound(keys.begin(), keys.begin() + keys.size() / 2, probe, less) - keys.begin();
+    EXPECT_EQ(upper, internal->Lookup(probe, comparator));
+  }
+}
+
+TEST(GenericKeyTest, RidSuffixOrdersDuplicateKeys) {
+  auto key_schema = ParseCreateStatement("a integer");
+  GenericComparator<16> comparator(key_schema.get(), true);
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> a_values(-3, 3);
+  std::uniform_int_distribution<page_id_t> page_ids(0, 1 << 20);
+  for (int i = 0; i < 1000; i++) {
+    int32_t lhs_value = a_values(rng);
+    int32_t rhs_value = a_values(rng);
+    RID lhs_rid(page_ids(rng), rng() % 4);
+    RID rhs_rid(rng() % 2 == 0 ? lhs_rid.GetPageId() : page_ids(rng), rng() % 4);
+    GenericKey<16> lhs;
+    GenericKey<16> rhs;
+    lhs.SetFromKey(Tuple({ValueFactory::GetIntegerValue(lhs_value)}, key_schema.get()), key_schema.get());
+    rhs.SetFromKey(Tuple({ValueFactory::GetIntegerValue(rhs_value)}, key_schema.get()), key_schema.get());
+    lhs.SetRidSuffix(lhs_rid);
+    rhs.SetRidSuffix(rhs_rid);
+
+    auto lhs_entry = std::make_tuple(lhs_value, lhs_rid.GetPageId(), lhs_rid.GetSlotNum());
+    auto rhs_entry = std::make_tuple(rhs_value, rhs_rid.GetPageId(), rhs_rid.GetSlotNum());
+    int expected = lhs_entry < rhs_entry ? -1 : (rhs_entry < lhs_entry ? 1 : 0);
+    EXPECT_EQ(expected, comparator(lhs, rhs));
+  }
+
+  // the bounds ScanKey() uses enclose every RID of a key
+  GenericKey<16> low;
+  GenericKey<16> high;
+  GenericKey<16> entry;
+  Tuple key({ValueFactory::GetIntegerValue(0)}, key_schema.get());
+  low.SetFromKey(key, key_schema.get());
+  high = low;
+  entry = low;
+  low.SetRidSuffix(RID(0, 0));
+  high.SetRidSuffix(RID(INVALID_PAGE_ID, UINT32_MAX));
+  entry.SetRidSuffix(RID(INT32_MAX, UINT32_MAX));
+  EXPECT_GT(0, comparator(low, entry));
+  EXPECT_GT(0, comparator(entry, high));
+}
+
+TEST(GenericKeyTest, EncodedColumnsDecodeBack) {
+  auto schema = ParseCreateStatement("a integer,b varchar(8),c double,d bigint");
+  ASSERT_EQ(4 + (3 + 16) + 8 + 8, GenericKey<64>::MaxEncodedSize(schema.get(), 0, 4));
+  // the key columns a and b, then the payload columns c and d after the compared bytes
+  size_t compared_size = GenericKey<64>::MaxEncodedSize(schema.get(), 0, 2);
+  GenericComparator<64> comparator(schema.get(), true, compared_size);
+  EXPECT_EQ(compared_size, comparator.ComparedSize());
+
+  std::vector<std::vector<Value>> rows{
+      {ValueFactory::GetIntegerValue(-7), ValueFactory::GetVarcharValue(std::string("a\0b", 3)),
+       ValueFactory::GetDecimalValue(-2.5), ValueFactory::GetBigIntValue(-1)},
+      {ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue(""), ValueFactory::GetDecimalValue(1e300),
+       ValueFactory::GetBigIntValue(1LL << 40)},
+      {ValueFactory::GetIntegerValue(70000), ValueFactory::GetVarcharValue("abcdefgh"),
+       ValueFactory::GetDecimalValue(0.0), ValueFactory::GetNullValueByType(TypeId::BIGINT)}};
+  for (const auto &row : rows) {
+    Tuple tuple(row, schema.get());
+    GenericKey<64> key;
+    memset(key.data_, 0, sizeof(key.data_));
+    EXPECT_LE(key.EncodeColumns(tuple, schema.get(), 0, 2, 0, compared_size), compared_size);
+    EXPECT_LE(key.EncodeColumns(tuple, schema.get(), 2, 4, compared_size, 64), 64);
+
+    std::vector<Value> values;
+    key.DecodeColumns(schema.get(), 0, 2, 0, &values);
+    key.DecodeColumns(schema.get(), 2, 4, compared_size, &values);
+    ASSERT_EQ(row.size(), values.size());
+    for (size_t i = 0; i < row.size(); i++) {
+      EXPECT_EQ(row[i].IsNull(), values[i].IsNull());
+      if (!row[i].IsNull()) {
+        EXPECT_EQ(CmpBool::CmpTrue, row[i].CompareEquals(values[i])) << row[i].ToString();
+      }
+    }
+
+    // the payload is no part of the key
+    GenericKey<64> other = key;
+    other.data_[63] ^= 1;
+    EXPECT_EQ(0, comparator(key, other));
+    other.data_[0] ^= 1;
+    EXPECT_NE(0, comparator(key, other));
+  }
+}
+
+TEST(GenericKeyTest, StepToAdjacentKeys) {
+  auto key_schema = ParseCreateStatement("a integer");
+  GenericComparator<4> comparator(key_schema.get(), true);
+
+  for (int32_t value : {-256, -1, 0, 255, 65535}) {
+    GenericKey<4> key;
+    GenericKey<4> next;
+    key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(value)}, key_schema.get()), key_schema.get());
+    next.SetFromKey(Tuple({ValueFactory::GetIntegerValue(value + 1)}, key_schema.get()), key_schema.get());
+    GenericKey<4> stepped = key;
+    ASSERT_TRUE(stepped.StepUp());
+    EXPECT_EQ(0, comparator(stepped, next));
+    ASSERT_TRUE(stepped.StepDown());
+    EXPECT_EQ(0, comparator(stepped, key));
+  }
+
+  GenericKey<4> key;
+  memset(key.data_, 0xff, sizeof(key.data_));
+  EXPECT_FALSE(key.StepUp());
+  memset(key.data_, 0, sizeof(key.data_));
+  EXPECT_FALSE(key.StepDown());
+}
+
+}  // namespace bustub
@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store_test.cpp
+//
+// Identification: test/table/version_store_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <vector>
+
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/version_store.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(VersionStoreTest, SnapshotReadTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  Tuple old_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(1)}, &schema};
+  VersionStore versions;
+  RID rid{0, 0};
+
+  // reader0 took its snapshot before writer committed, reader1 after
+  Transaction reader0{0, IsolationLevel::SNAPSHOT_ISOLATION};
+  Transaction writer{1, IsolationLevel::SNAPSHOT_ISOLATION};
+  EXPECT_TRUE(versions.CanWrite(rid, &writer));
+  versions.RecordWrite(rid, &writer, &old_tuple);
+
+  Transaction other{2, IsolationLevel::SNAPSHOT_ISOLATION};
+  EXPECT_FALSE(versions.CanWrite(rid, &other));
+
+  Tuple tuple;
+  bool exists = false;
+  EXPECT_TRUE(versions.Read(rid, &reader0, &tuple, &exists));
+  EXPECT_TRUE(exists);
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  // the writer reads its own image from the page
+  EXPECT_FALSE(versions.Read(rid, &writer, &tuple, &exists));
+
+  versions.Commit(rid, &writer, 1);
+  Transaction reader1{3, IsolationLevel::SNAPSHOT_ISOLATION};
+  reader1.SetReadTs(1);
+  EXPECT_FALSE(versions.Read(rid, &reader1, &tuple, &exists));
+  EXPECT_TRUE(versions.Read(rid, &reader0, &tuple, &exists));
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+
+  // other started before the commit, so it lost the race for rid
+  EXPECT_FALSE(versions.CanWrite(rid, &other));
+  EXPECT_TRUE(versions.CanWrite(rid, &reader1));
+
+  // reader0 still needs the before-image
+  versions.CollectGarbage(0);
+  EXPECT_EQ(versions.VersionCount(), 1);
+  versions.CollectGarbage(1);
+  EXPECT_EQ(versions.VersionCount(), 0);
+}
+
+// NOLINTNEXTLINE
+TEST(VersionStoreTest, AbortTest) {
+  VersionStore versions;
+  RID rid{0, 0};
+  Transaction reader{0, IsolationLevel::SNAPSHOT_ISOLATION};
+  Transaction writer{1, IsolationLevel::SNAPSHOT_ISOLATION};
+
+  // an insert: before it, the slot held nothing
+  versions.RecordWrite(rid, &writer, nullptr);
+  Tuple tuple;
+  bool exists = true;
+  EXPECT_TRUE(versions.Read(rid, &reader, &tuple, &exists));
+  EXPECT_FALSE(exists);
+
+  versions.Abort(rid, &writer);
+  EXPECT_EQ(versions.VersionCount(), 0);
+  EXPECT_FALSE(versions.Read(rid, &reader, &tuple, &exists));
+  Transaction next{2, IsolationLevel::SNAPSHOT_ISOLATION};
+  EXPECT_TRUE(versions.CanWrite(rid, &next));
+}
+
+// NOLINTNEXTLINE
+TEST(VersionStoreTest, GarbageCollectionTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  Tuple old_tuple{std::vector<Value>{ValueFactory::GetIntegerValue(1)}, &schema};
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager);
+  // only the versions of the heap are used, its pages are never read
+  TableHeap table(nullptr, &lock_manager, nullptr, INVALID_PAGE_ID);
+  RID rid{0, 0};
+  auto run_read_only = [&]() {
+    for (int i = 0; i < MVCC_GC_INTERVAL; i++) {
+      Transaction *txn = txn_mgr.Begin();
+      txn_mgr.Commit(txn);
+      delete txn;
+    }
+  };
+
+  Transaction *reader = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  Transaction *writer = txn_mgr.Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  table.GetVersionStore()->RecordWrite(rid, writer, &old_tuple);
+  writer->AppendTableWriteRecord(TableWriteRecord(rid, WType::UPDATE, old_tuple, &table));
+  ASSERT_TRUE(txn_mgr.Commit(writer));
+  delete writer;
+  EXPECT_EQ(table.GetVersionStore()->VersionCount(), 1);
+  EXPECT_EQ(txn_mgr.CommittedWriteCount(), 1);
+
+  // transactions that write nothing sweep the table too, but reader still needs the before-image
+  run_read_only();
+  EXPECT_EQ(table.GetVersionStore()->VersionCount(), 1);
+  txn_mgr.Commit(reader);
+  delete reader;
+  run_read_only();
+  EXPECT_EQ(table.GetVersionStore()->VersionCount(), 0);
+  EXPECT_EQ(txn_mgr.CommittedWriteCount(), 0);
+}
+
+}  // namespace bustub